@@ -0,0 +1,13 @@
+# What every target in bench/ shares: a QtCore console app built on the
+# engine and the feeds.
+
+TEMPLATE = app
+QT = core
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD
+HEADERS += $$PWD/bench_utils.hpp
+
+include($$PWD/../korrelator_engine.pri)
+include($$PWD/../korrelator_feeds.pri)
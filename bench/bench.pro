@@ -0,0 +1,10 @@
+# Console benchmarks and checks of the feeds and the engine, without the
+# widgets. Each prints its numbers; the checks also exit non-zero on a
+# failure.
+
+TEMPLATE = subdirs
+SUBDIRS = frame_scanner \
+  decimal_parser \
+  replay_signals \
+  feed_latency \
+  read_loop_allocations
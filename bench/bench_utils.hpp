@@ -0,0 +1,25 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace korrelator {
+namespace bench {
+
+// summed into by every measured call, so the calls can't be optimized away
+inline volatile double resultSink = 0.0;
+
+// average nanoseconds of `body(index)` over `iterations` calls
+template <typename Body>
+double nanosecondsPerCall(std::size_t const iterations, Body &&body) {
+  auto const start = std::chrono::steady_clock::now();
+  for (std::size_t index = 0; index < iterations; ++index)
+    resultSink = resultSink + body(index);
+  std::chrono::duration<double, std::nano> const elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / double(iterations);
+}
+
+} // namespace bench
+} // namespace korrelator
@@ -0,0 +1,7 @@
+# The decimal parser against atof, stod and QString::toDouble, over the
+# numbers the exchanges send.
+
+TARGET = decimal_parser_bench
+include(../bench.pri)
+
+SOURCES += decimal_parser_bench.cpp
@@ -0,0 +1,65 @@
+#include <QCoreApplication>
+#include <QString>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "decimal_parser.hpp"
+
+using namespace korrelator;
+
+// usage: decimal_parser_bench [iterations]
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  std::size_t const iterations =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+  if (iterations == 0) {
+    std::fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // prices, quantities and sizes as Binance and KuCoin spell them
+  std::vector<std::string> const numbers{
+      "16550.10000000", "0.01200000", "1197.25",    "46.71570000",
+      "0.00001234",     "16549.0",    "0.10915327", "149559637.52063400",
+      "-2.41000000",    "0.0021",     "1",          "27.5"};
+  std::vector<QString> qtNumbers;
+  for (auto const &number : numbers)
+    qtNumbers.push_back(QString::fromStdString(number));
+
+  int mismatches = 0;
+  for (std::size_t i = 0; i < numbers.size(); ++i) {
+    auto const value = stringToDouble(std::string_view(numbers[i]));
+    if (value != std::atof(numbers[i].c_str()) ||
+        value != std::stod(numbers[i]) || value != qtNumbers[i].toDouble() ||
+        value != stringToDouble(qtNumbers[i])) {
+      std::fprintf(stderr, "conversions disagree on %s\n", numbers[i].c_str());
+      ++mismatches;
+    }
+  }
+
+  auto const count = numbers.size();
+  auto const report = [iterations](char const *name, auto &&convert) {
+    std::printf("%-28s %8.2f ns\n", name,
+                bench::nanosecondsPerCall(iterations, convert));
+  };
+  report("parseDouble", [&](std::size_t const i) {
+    return stringToDouble(std::string_view(numbers[i % count]));
+  });
+  report("std::atof", [&](std::size_t const i) {
+    return std::atof(numbers[i % count].c_str());
+  });
+  report("std::stod", [&](std::size_t const i) {
+    return std::stod(numbers[i % count]);
+  });
+  report("QString::toDouble", [&](std::size_t const i) {
+    return qtNumbers[i % count].toDouble();
+  });
+  report("stringToDouble(QString)", [&](std::size_t const i) {
+    return stringToDouble(qtNumbers[i % count]);
+  });
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,7 @@
+# The Binance and KuCoin feeds against server/mock_exchange, reporting each
+# symbol's tick throughput and latency. Start the mock first.
+
+TARGET = feed_latency_bench
+include(../bench.pri)
+
+SOURCES += feed_latency_bench.cpp
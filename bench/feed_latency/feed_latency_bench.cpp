@@ -0,0 +1,139 @@
+#include <QCoreApplication>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "constants.hpp"
+#include "latency_histogram.hpp"
+#include "tick_slot.hpp"
+#include "utils.hpp"
+#include "websocket_manager.hpp"
+
+using namespace korrelator;
+
+namespace {
+
+// one symbol of one exchange, as the graph thread would consume it
+struct feed_t {
+  std::string name;
+  tick_slot_t slot;
+  latency_histogram_t storeToDrain; // slot write -> drained, microseconds
+  std::uint64_t ticks = 0;
+};
+
+void printSummary(char const *label, latency_summary_t const &s) {
+  std::printf("  %-8s %9llu %8llu %8llu %8llu %8llu %10.1f\n", label,
+              static_cast<unsigned long long>(s.count),
+              static_cast<unsigned long long>(s.p50),
+              static_cast<unsigned long long>(s.p99),
+              static_cast<unsigned long long>(s.p999),
+              static_cast<unsigned long long>(s.max), s.mean);
+}
+
+} // namespace
+
+// Subscribes the Binance and KuCoin spot feeds of every symbol to a running
+// mock exchange (server/mock_exchange), drains their slots like the graph
+// thread does and reports the tick latency and throughput of each.
+//
+// usage: feed_latency_bench [seconds] [BTC-USDT,ETH-USDT]
+// with KORRELATOR_EXCHANGE_HOST=host:port when not 127.0.0.1:8443
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  auto hostAndPort = qgetenv("KORRELATOR_EXCHANGE_HOST").toStdString();
+  if (hostAndPort.empty())
+    hostAndPort = "127.0.0.1:8443";
+  auto const colon = hostAndPort.rfind(':');
+  int const seconds = argc > 1 ? std::atoi(argv[1]) : 10;
+  std::string const symbols = argc > 2 ? argv[2] : "BTC-USDT,ETH-USDT";
+  if (colon == std::string::npos || colon == 0 || seconds <= 0) {
+    std::fprintf(stderr, "usage: %s [seconds] [BTC-USDT,ETH-USDT]\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+  // never the real exchanges
+  constants::overrideExchangeHost(hostAndPort.substr(0, colon),
+                                  hostAndPort.substr(colon + 1));
+
+  std::vector<std::unique_ptr<feed_t>> feeds;
+  websocket_manager manager;
+  for (std::size_t first = 0; first < symbols.size();) {
+    auto const last = std::min(symbols.find(',', first), symbols.size());
+    auto const symbol =
+        QString::fromStdString(symbols.substr(first, last - first));
+    first = last + 1;
+    if (symbol.isEmpty())
+      continue;
+    for (auto const exchange :
+         {exchange_name_e::binance, exchange_name_e::kucoin}) {
+      // Binance names the mock's BTC-USDT "BTCUSDT"
+      auto const tokenName = exchange == exchange_name_e::binance
+                                 ? QString(symbol).remove('-')
+                                 : symbol;
+      auto feed = std::make_unique<feed_t>();
+      feed->name = exchangeNameToString(exchange).toStdString() + " " +
+                   tokenName.toStdString();
+      feed->slot.setRing(std::make_unique<tick_ring_t>(
+          tick_ring_t::defaultCapacity, ring_overflow_policy_e::drop_oldest));
+      manager.addSubscription(tokenName, trade_type_e::spot, exchange,
+                              feed->slot, price_source_e::last_trade);
+      feeds.push_back(std::move(feed));
+    }
+  }
+  manager.startWatch();
+
+  auto const start = std::chrono::steady_clock::now();
+  auto const end = start + std::chrono::seconds(seconds);
+  while (std::chrono::steady_clock::now() < end) {
+    for (auto &feed : feeds) {
+      feed->slot.ring()->drain([&feed, now = steadyNowNs()](tick_t const &t) {
+        feed->storeToDrain.record(
+            static_cast<std::uint64_t>(std::max<std::int64_t>(
+                0, (now - t.receiveTimeNs) / 1'000)));
+        ++feed->ticks;
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+  auto const reports = manager.latencyReports();
+  manager.stop();
+
+  // all durations in microseconds
+  std::uint64_t totalTicks = 0, droppedTicks = 0;
+  std::printf("  %-8s %9s %8s %8s %8s %8s %10s\n", "", "count", "p50", "p99",
+              "p99.9", "max", "mean");
+  for (auto const &feed : feeds) {
+    auto const dropped = feed->slot.ring()->dropCount();
+    std::printf("%s: %.1f ticks/s, %llu dropped\n", feed->name.c_str(),
+                double(feed->ticks) / elapsed.count(),
+                static_cast<unsigned long long>(dropped));
+    printSummary("drain", feed->storeToDrain.summary());
+    totalTicks += feed->ticks;
+    droppedTicks += dropped;
+  }
+  for (auto const &report : reports) {
+    std::printf("%s:\n", report.name.toStdString().c_str());
+    printSummary("latency", report.latency);
+    printSummary("gaps", report.gaps);
+  }
+  std::printf("\n%llu ticks in %.1fs, %.1f ticks/s, %llu dropped\n",
+              static_cast<unsigned long long>(totalTicks), elapsed.count(),
+              double(totalTicks) / elapsed.count(),
+              static_cast<unsigned long long>(droppedTicks));
+  // a feed that never ticked means the mock isn't reachable
+  for (auto const &feed : feeds) {
+    if (feed->ticks == 0) {
+      std::fprintf(stderr, "no tick from %s\n", feed->name.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,7 @@
+# The frame scanner against the rapidjson and QJsonDocument parses it
+# replaced, over captured price frames.
+
+TARGET = frame_scanner_bench
+include(../bench.pri)
+
+SOURCES += frame_scanner_bench.cpp
@@ -0,0 +1,246 @@
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <rapidjson/document.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "binance_websocket.hpp"
+#include "frame_replay.hpp"
+#include "kucoin_websocket.hpp"
+
+using namespace korrelator;
+
+namespace {
+
+struct frame_t {
+  std::string name;
+  std::string text;
+  exchange_name_e exchange = exchange_name_e::none;
+  bool isSpot = true;
+};
+
+// price frames as captured from the exchanges
+std::vector<frame_t> capturedFrames() {
+  return {
+      {"Binance aggTrade",
+       R"({"stream":"btcusdt@aggTrade","data":{"e":"aggTrade","E":1672515782136,)"
+       R"("s":"BTCUSDT","a":2345678901,"p":"16550.10000000","q":"0.01200000",)"
+       R"("f":2890000001,"l":2890000003,"T":1672515782134,"m":true,"M":true}})",
+       exchange_name_e::binance, true},
+      {"Binance 24hrTicker",
+       R"({"stream":"ethusdt@ticker","data":{"e":"24hrTicker","E":1672515782201,)"
+       R"("s":"ETHUSDT","p":"-2.41000000","P":"-0.201","w":"1196.35021374",)"
+       R"("x":"1199.66000000","c":"1197.25000000","Q":"0.08350000",)"
+       R"("b":"1197.24000000","B":"46.71570000","a":"1197.25000000",)"
+       R"("A":"4.22160000","o":"1199.66000000","h":"1203.00000000",)"
+       R"("l":"1188.73000000","v":"125013.54730000","q":"149559637.52063400",)"
+       R"("O":1672429382201,"C":1672515782201,"F":1041273919,"L":1041397207,)"
+       R"("n":123289}})",
+       exchange_name_e::binance, true},
+      {"KuCoin spot ticker",
+       R"({"type":"message","topic":"/market/ticker:BTC-USDT",)"
+       R"("subject":"trade.ticker","data":{"bestAsk":"16550.2",)"
+       R"("bestAskSize":"0.10915327","bestBid":"16550.1",)"
+       R"("bestBidSize":"0.51432904","price":"16550.1",)"
+       R"("sequence":"1545896668986","size":"0.0021","time":1672515782136}})",
+       exchange_name_e::kucoin, true},
+      {"KuCoin futures ticker",
+       R"({"type":"message","topic":"/contractMarket/ticker:XBTUSDTM",)"
+       R"("subject":"ticker","data":{"symbol":"XBTUSDTM","sequence":1638646390,)"
+       R"("side":"sell","size":3,"price":16550,"bestBidSize":1223,)"
+       R"("bestBidPrice":"16549.0","bestAskPrice":"16550.0",)"
+       R"("tradeId":"63b0b76ae5e4e40001cbf226","ts":1672515782136000000,)"
+       R"("bestAskSize":95}})",
+       exchange_name_e::kucoin, false}};
+}
+
+// the frames of a session written by `frame_capture_t`, named after their
+// connection
+std::vector<frame_t> framesOfCapture(char const *const directory) {
+  capture_reader_t reader;
+  std::vector<frame_t> result;
+  if (!reader.open(directory))
+    return result;
+  for (auto const &frame : reader.frames()) {
+    auto const iter = reader.connections().find(frame.connectionId);
+    if (iter == reader.connections().end())
+      continue;
+    frame_t f;
+    f.name = iter->second;
+    f.text.assign(frame.data, frame.length);
+    f.exchange = f.name.rfind("Binance ", 0) == 0 ? exchange_name_e::binance
+                                                  : exchange_name_e::kucoin;
+    f.isSpot = f.name.find(" spot ") != std::string::npos;
+    result.push_back(std::move(f));
+  }
+  return result;
+}
+
+// binanceGetCoinPrice before the scanner
+double rapidjsonBinancePrice(char const *str, size_t const size,
+                             std::string &streamName) {
+  rapidjson::Document d;
+  d.Parse(str, size);
+  if (!d.IsObject())
+    return -1.0;
+  auto const streamIter = d.FindMember("stream");
+  auto const iter = d.FindMember("data");
+  if (iter == d.MemberEnd() || streamIter == d.MemberEnd() ||
+      !iter->value.IsObject())
+    return -1.0;
+  streamName.assign(streamIter->value.GetString(),
+                    streamIter->value.GetStringLength());
+  auto const dataObject = iter->value.GetObject();
+  auto const typeIter = dataObject.FindMember("e");
+  if (typeIter == dataObject.MemberEnd())
+    return -1.0;
+  std::string const type = typeIter->value.GetString();
+  bool const is24HrTicker = type == "24hrTicker";
+  if (!is24HrTicker && type != "aggTrade")
+    return -1.0;
+  auto const priceIter = dataObject.FindMember(is24HrTicker ? "c" : "p");
+  if (priceIter == dataObject.MemberEnd() || !priceIter->value.IsString())
+    return -1.0;
+  return std::atof(priceIter->value.GetString());
+}
+
+// kuCoinGetCoinPrice before the scanner
+double rapidjsonKuCoinPrice(char const *str, size_t const size,
+                            bool const isSpot, std::string &tokenName) {
+  rapidjson::Document d;
+  d.Parse(str, size);
+  if (!d.IsObject())
+    return -1.0;
+  auto const iter = d.FindMember("data");
+  auto const topicIter = d.FindMember("topic");
+  if (iter == d.MemberEnd() || !iter->value.IsObject() ||
+      topicIter == d.MemberEnd() || !topicIter->value.IsString())
+    return -1.0;
+  std::string const topic = topicIter->value.GetString();
+  tokenName = topic.substr(topic.find(':') + 1);
+  auto const dataObject = iter->value.GetObject();
+  auto const price = [&dataObject](char const *const key) {
+    auto const priceIter = dataObject.FindMember(key);
+    return priceIter == dataObject.MemberEnd() || !priceIter->value.IsString()
+               ? -1.0
+               : std::stod(priceIter->value.GetString());
+  };
+  if (isSpot)
+    return price("price");
+  auto const bidPrice = price("bestBidPrice");
+  auto const askPrice = price("bestAskPrice");
+  return bidPrice < 0.0 || askPrice < 0.0 ? -1.0 : (bidPrice + askPrice) / 2.0;
+}
+
+// the same with Qt's parser
+double qtBinancePrice(char const *str, size_t const size,
+                      std::string &streamName) {
+  auto const object =
+      QJsonDocument::fromJson(QByteArray::fromRawData(str, int(size)))
+          .object();
+  auto const data = object.value("data").toObject();
+  streamName = object.value("stream").toString().toStdString();
+  auto const type = data.value("e").toString();
+  if (type == "aggTrade")
+    return data.value("p").toString().toDouble();
+  if (type == "24hrTicker")
+    return data.value("c").toString().toDouble();
+  return -1.0;
+}
+
+double qtKuCoinPrice(char const *str, size_t const size, bool const isSpot,
+                     std::string &tokenName) {
+  auto const object =
+      QJsonDocument::fromJson(QByteArray::fromRawData(str, int(size)))
+          .object();
+  auto const data = object.value("data").toObject();
+  auto const topic = object.value("topic").toString();
+  tokenName = topic.mid(topic.indexOf(':') + 1).toStdString();
+  if (isSpot)
+    return data.value("price").toString().toDouble();
+  return (data.value("bestBidPrice").toString().toDouble() +
+          data.value("bestAskPrice").toString().toDouble()) /
+         2.0;
+}
+
+} // namespace
+
+// usage: frame_scanner_bench [iterations] [capture directory]
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  std::size_t const iterations =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+  auto frames = argc > 2 ? framesOfCapture(argv[2]) : capturedFrames();
+
+  std::string name;
+  std::int64_t eventTimeMs = 0, updateId = 0;
+  auto const scanner = [&](frame_t const &f) {
+    return f.exchange == exchange_name_e::binance
+               ? binanceGetCoinPrice(f.text.data(), f.text.size(), name,
+                                     eventTimeMs, updateId)
+               : kuCoinGetCoinPrice(f.text.data(), f.text.size(), f.isSpot,
+                                    name, eventTimeMs, updateId);
+  };
+  // acks, book tickers and depth frames of a capture aren't compared
+  frames.erase(std::remove_if(frames.begin(), frames.end(),
+                              [&scanner](frame_t const &f) {
+                                return scanner(f) == -1.0;
+                              }),
+               frames.end());
+  if (iterations == 0 || frames.empty()) {
+    std::fprintf(stderr, "usage: %s [iterations] [capture directory]\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  auto const rapidjson = [&](frame_t const &f) {
+    return f.exchange == exchange_name_e::binance
+               ? rapidjsonBinancePrice(f.text.data(), f.text.size(), name)
+               : rapidjsonKuCoinPrice(f.text.data(), f.text.size(), f.isSpot,
+                                      name);
+  };
+  auto const qt = [&](frame_t const &f) {
+    return f.exchange == exchange_name_e::binance
+               ? qtBinancePrice(f.text.data(), f.text.size(), name)
+               : qtKuCoinPrice(f.text.data(), f.text.size(), f.isSpot, name);
+  };
+
+  // one line per kind of frame, a capture is measured as a whole
+  std::vector<std::vector<frame_t>> groups;
+  if (argc > 2)
+    groups.push_back(frames);
+  else
+    for (auto const &frame : frames)
+      groups.push_back({frame});
+
+  int mismatches = 0;
+  std::printf("%-24s %12s %12s %12s\n", "ns per frame", "scanner",
+              "rapidjson", "QJsonDoc");
+  for (auto const &group : groups) {
+    for (auto const &frame : group) {
+      // a frame the old paths read differently would skew the comparison
+      auto const price = scanner(frame);
+      if (price != rapidjson(frame) || price != qt(frame)) {
+        std::fprintf(stderr, "parsers disagree on %s\n", frame.text.c_str());
+        ++mismatches;
+      }
+    }
+    auto const measure = [&](auto const &parse) {
+      return bench::nanosecondsPerCall(iterations, [&](std::size_t const i) {
+        return parse(group[i % group.size()]);
+      });
+    };
+    auto const label = argc > 2 ? std::string("capture") : group[0].name;
+    std::printf("%-24s %12.1f %12.1f %12.1f\n", label.c_str(),
+                measure(scanner), measure(rapidjson), measure(qt));
+  }
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
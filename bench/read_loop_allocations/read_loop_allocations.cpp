@@ -0,0 +1,292 @@
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ssl/context.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+#include "binance_websocket.hpp"
+#include "constants.hpp"
+#include "feed_arbiter.hpp"
+#include "frame_journal.hpp"
+#include "kucoin_websocket.hpp"
+#include "mock_exchange.hpp"
+#include "tick_slot.hpp"
+#include "utils.hpp"
+#include "websocket_manager.hpp"
+
+using namespace korrelator;
+
+namespace {
+
+// only the feeds' io thread is counted, and only once the feeds are warm
+thread_local bool isFeedThread = false;
+std::atomic<bool> isCounting{false};
+std::atomic<std::size_t> allocationCount{0};
+
+void countAllocation() {
+  if (isFeedThread && isCounting.load(std::memory_order_relaxed))
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void *allocate(std::size_t const size) {
+  countAllocation();
+  if (void *pointer = std::malloc(size == 0 ? 1 : size))
+    return pointer;
+  throw std::bad_alloc{};
+}
+
+void *allocate(std::size_t size, std::align_val_t const alignment) {
+  countAllocation();
+  auto const align = static_cast<std::size_t>(alignment);
+  size = std::max<std::size_t>(size, 1);
+#ifdef _MSC_VER
+  void *pointer = _aligned_malloc(size, align);
+#else
+  // aligned_alloc wants a multiple of the alignment
+  void *pointer = std::aligned_alloc(align, (size + align - 1) & ~(align - 1));
+#endif
+  if (pointer)
+    return pointer;
+  throw std::bad_alloc{};
+}
+
+void deallocate(void *const pointer) noexcept { std::free(pointer); }
+
+void deallocateAligned(void *const pointer) noexcept {
+#ifdef _MSC_VER
+  _aligned_free(pointer);
+#else
+  std::free(pointer);
+#endif
+}
+
+} // namespace
+
+// The nothrow forms call these, the aligned ones need their own pair
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return allocate(size, alignment);
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return allocate(size, alignment);
+}
+void operator delete(void *pointer) noexcept { deallocate(pointer); }
+void operator delete[](void *pointer) noexcept { deallocate(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept {
+  deallocate(pointer);
+}
+void operator delete[](void *pointer, std::size_t) noexcept {
+  deallocate(pointer);
+}
+void operator delete(void *pointer, std::align_val_t) noexcept {
+  deallocateAligned(pointer);
+}
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+  deallocateAligned(pointer);
+}
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+  deallocateAligned(pointer);
+}
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept {
+  deallocateAligned(pointer);
+}
+
+namespace {
+
+constexpr std::uint64_t warmupTicks = 5'000;
+constexpr std::uint64_t countedTicks = 100'000;
+constexpr auto warmupTimeout = std::chrono::seconds(30);
+// KuCoin pings every 18s on the mock, a ping isn't part of the read loop
+constexpr auto countingTimeout = std::chrono::seconds(12);
+// large enough that no journal rolls over while counting
+constexpr std::size_t journalSegmentSize = 256 * 1024 * 1024;
+
+struct feed_t {
+  tick_slot_t slot;
+};
+
+std::uint64_t drainTicks(std::vector<std::unique_ptr<feed_t>> &feeds,
+                         bool &everyFeedTicked) {
+  std::uint64_t ticks = 0;
+  everyFeedTicked = true;
+  for (auto &feed : feeds) {
+    feed->slot.ring()->drain([](tick_t const &) {});
+    ticks += feed->slot.sequence();
+    everyFeedTicked = everyFeedTicked && feed->slot.sequence() != 0;
+  }
+  return ticks;
+}
+
+// Binance spot with a hot standby and KuCoin spot on one io thread, every
+// connection journaled, half the Binance symbols on bookTicker mids. The
+// depth streams parse with rapidjson and aren't part of this check.
+std::optional<std::size_t>
+countAllocations(std::vector<std::string> const &symbols,
+                 std::filesystem::path const &captureDirectory,
+                 bool const conflate) {
+  net::io_context ioContext{1};
+  auto workGuard = net::make_work_guard(ioContext);
+  feed_arbiter_t arbiter("Binance spot #1");
+  frame_capture_t capture(captureDirectory, journalSegmentSize);
+  std::vector<std::unique_ptr<feed_t>> feeds;
+  auto &sslContext = getSSLContext();
+  auto binance = std::make_unique<binance_ws>(
+      ioContext, sslContext, trade_type_e::spot, &arbiter, 0);
+  auto binanceStandby = std::make_unique<binance_ws>(
+      ioContext, sslContext, trade_type_e::spot, &arbiter, 1);
+  auto kucoin =
+      std::make_unique<kucoin_ws>(ioContext, sslContext, trade_type_e::spot);
+
+  for (std::size_t i = 0; i < symbols.size(); ++i) {
+    auto const symbol = QString::fromStdString(symbols[i]);
+    auto const priceSource =
+        i % 2 ? price_source_e::book_ticker_mid : price_source_e::last_trade;
+    for (bool const isBinance : {true, false}) {
+      auto feed = std::make_unique<feed_t>();
+      feed->slot.setRing(std::make_unique<tick_ring_t>(
+          tick_ring_t::defaultCapacity, ring_overflow_policy_e::drop_oldest));
+      if (isBinance) {
+        // Binance names the mock's S0-USDT "S0USDT"
+        auto const tokenName = QString(symbol).remove('-');
+        binance->addSubscription(tokenName, feed->slot, priceSource);
+        binanceStandby->addSubscription(tokenName, feed->slot, priceSource);
+      } else {
+        kucoin->addSubscription(symbol, feed->slot);
+      }
+      feeds.push_back(std::move(feed));
+    }
+  }
+
+  binance->setJournal(capture.addJournal("Binance spot #1"));
+  binanceStandby->setJournal(capture.addJournal("Binance spot #1 (standby)"));
+  kucoin->setJournal(capture.addJournal("KuCoin spot #1"));
+  capture.start();
+  binance->setConflation(conflate);
+  binanceStandby->setConflation(conflate);
+  kucoin->setConflation(conflate);
+  binance->startFetching();
+  binanceStandby->startFetching();
+  kucoin->startFetching();
+  std::thread ioThread([&ioContext] {
+    isFeedThread = true;
+    ioContext.run();
+  });
+
+  bool everyFeedTicked = false;
+  auto deadline = std::chrono::steady_clock::now() + warmupTimeout;
+  auto ticks = drainTicks(feeds, everyFeedTicked);
+  while ((!everyFeedTicked || ticks < warmupTicks) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ticks = drainTicks(feeds, everyFeedTicked);
+  }
+
+  std::uint64_t counted = 0;
+  if (everyFeedTicked && ticks >= warmupTicks) {
+    allocationCount = 0;
+    isCounting = true;
+    auto const firstTick = ticks;
+    deadline = std::chrono::steady_clock::now() + countingTimeout;
+    while (ticks - firstTick < countedTicks &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      ticks = drainTicks(feeds, everyFeedTicked);
+    }
+    isCounting = false;
+    counted = ticks - firstTick;
+  }
+
+  // like websocket_manager::stop, close frames first, then join
+  std::mutex mutex;
+  std::condition_variable allClosed;
+  int pending = 3;
+  auto const onClosed = [&] {
+    std::lock_guard<std::mutex> lock_g(mutex);
+    if (--pending == 0)
+      allClosed.notify_all();
+  };
+  binance->close(onClosed);
+  binanceStandby->close(onClosed);
+  kucoin->close(onClosed);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    allClosed.wait_for(lock, std::chrono::milliseconds(500),
+                       [&pending] { return pending == 0; });
+  }
+  workGuard.reset();
+  ioContext.stop();
+  ioThread.join();
+
+  if (counted < countedTicks) {
+    std::fprintf(stderr, "the feeds stopped after %llu of %llu ticks\n",
+                 static_cast<unsigned long long>(counted),
+                 static_cast<unsigned long long>(countedTicks));
+    return std::nullopt;
+  }
+  return allocationCount.load();
+}
+
+} // namespace
+
+// Counts the heap allocations of the real Binance and KuCoin read loops over
+// 100k ticks from an in-process mock exchange, with conflation off and on.
+// Once the connections are warm, a frame goes through the scanners, the
+// arbiter, the latency histograms, the journal and the tick rings without
+// touching the heap; any allocation fails the check.
+//
+// usage: read_loop_allocations [port]
+int main(int argc, char *argv[]) {
+  mock::mock_config_t config;
+  config.port = argc > 1 ? static_cast<uint16_t>(std::atoi(argv[1])) : 18443;
+  config.tick_interval = std::chrono::milliseconds(1);
+  config.symbols.clear();
+  for (int i = 0; i < 16; ++i)
+    config.symbols.push_back("S" + std::to_string(i) + "-USDT");
+
+  net::io_context mockContext{1};
+  auto exchange = std::make_shared<mock::mock_exchange_t>(mockContext, config);
+  if (!exchange->run())
+    return EXIT_FAILURE;
+  auto mockGuard = net::make_work_guard(mockContext);
+  std::thread mockThread([&mockContext] { mockContext.run(); });
+  // never the real exchanges
+  constants::overrideExchangeHost("127.0.0.1", std::to_string(config.port));
+
+  auto const captureRoot =
+      std::filesystem::temp_directory_path() / "read_loop_allocations";
+  bool passed = true;
+  for (bool const conflate : {false, true}) {
+    auto const allocations =
+        countAllocations(config.symbols, captureRoot, conflate);
+    if (allocations)
+      std::printf("%s: %zu allocation(s) over %llu ticks\n",
+                  conflate ? "conflated" : "every frame", *allocations,
+                  static_cast<unsigned long long>(countedTicks));
+    passed = passed && allocations == std::size_t(0);
+  }
+
+  mockGuard.reset();
+  mockContext.stop();
+  mockThread.join();
+  std::error_code ec;
+  std::filesystem::remove_all(captureRoot, ec);
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
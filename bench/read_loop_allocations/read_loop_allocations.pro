@@ -0,0 +1,13 @@
+# The real Binance and KuCoin read loops against an in-process
+# server/mock_exchange, failing on any heap allocation once they are warm.
+
+TARGET = read_loop_allocations
+include(../bench.pri)
+
+INCLUDEPATH += $$PWD/../../server $$PWD/../../server/third-party
+
+SOURCES += read_loop_allocations.cpp \
+  ../../server/mock_exchange.cpp \
+  ../../server/utilities.cpp
+HEADERS += ../../server/mock_exchange.hpp \
+  ../../server/utilities.hpp
@@ -0,0 +1,185 @@
+#include <QCoreApplication>
+#include <QDateTime>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "correlator_engine.hpp"
+#include "frame_journal.hpp"
+#include "frame_replay.hpp"
+
+using namespace korrelator;
+
+namespace {
+
+constexpr std::int64_t frameIntervalNs = 50'000'000;
+constexpr int frameCount = 400; // 20s, ETH and BTC taking turns
+constexpr auto timerTick = std::chrono::milliseconds(100);
+constexpr double threshold = 0.1;
+// a crossing each second but the first one
+constexpr std::size_t expectedSignals = frameCount / 20 - 1;
+
+struct signal_t {
+  trade_action_e action = trade_action_e::nothing;
+  double crossPrice = 0.0; // where ETH crossed the ref
+  double price = 0.0;      // where it reached the threshold
+  QString time;
+
+  bool operator==(signal_t const &other) const {
+    return action == other.action && crossPrice == other.crossPrice &&
+           price == other.price && time == other.time;
+  }
+};
+
+// ETH opens at 1000, the ref line, then swings around it with a period of 2s
+// without ever being level with it again, as a crossover needs a strict one
+double ethPrice(int const ethFrame) {
+  if (ethFrame == 0)
+    return 1000.0;
+  auto const phase = (ethFrame - 0.5) * M_PI / 10.0;
+  return std::round((1000.0 + 40.0 * std::sin(phase)) * 100.0) / 100.0;
+}
+
+// The fixed capture: one Binance spot connection with the aggTrade frames
+// of both symbols, written the way the websockets record them.
+std::filesystem::path writeCapture(std::filesystem::path const &root) {
+  frame_capture_t capture(root, 1 << 20);
+  auto journal = capture.addJournal("Binance spot #1");
+  if (journal == nullptr)
+    return {};
+  capture.start();
+  for (int i = 0; i < frameCount; ++i) {
+    bool const isRef = i % 2 == 0;
+    char frame[256]{};
+    auto const length = std::snprintf(
+        frame, sizeof(frame),
+        R"({"stream":"%s@aggTrade","data":{"e":"aggTrade","E":%lld,)"
+        R"("s":"%s","a":%d,"p":"%.2f","q":"0.01000","f":%d,"l":%d,)"
+        R"("T":%lld,"m":false,"M":true}})",
+        isRef ? "btcusdt" : "ethusdt", 1672515782000LL + i * 50LL,
+        isRef ? "BTCUSDT" : "ETHUSDT", i, isRef ? 20000.0 : ethPrice(i / 2), i,
+        i, 1672515782000LL + i * 50LL);
+    journal->append(frame, std::size_t(length), (i + 1) * frameIntervalNs);
+  }
+  return capture.directory();
+}
+
+class signal_recorder_t : public correlator_observer_t {
+public:
+  explicit signal_recorder_t(replay_driver_t const &driver)
+      : m_driver(driver) {}
+
+  void onCrossOverSignal(token_t const &symbol,
+                         cross_over_data_t crossOver) override {
+    signals.push_back({crossOver.action, crossOver.signalPrice,
+                       symbol.realPrice->price(), std::move(crossOver.time)});
+  }
+  void onPriceDeltaSignal(trade_action_e const) override {}
+  // recorded time, so two replays stamp the same
+  QString signalTime() const override {
+    return QDateTime::fromMSecsSinceEpoch(m_driver.wallTimeNs() / 1'000'000)
+        .toString("yyyy-MM-dd hh:mm:ss.zzz");
+  }
+
+  std::vector<signal_t> signals;
+
+private:
+  replay_driver_t const &m_driver;
+};
+
+token_t makeToken(QString const &name) {
+  token_t token;
+  token.symbolName = name;
+  token.exchange = exchange_name_e::binance;
+  token.tradeType = trade_type_e::spot;
+  if (name.length() != 1)
+    token.realPrice = std::make_shared<tick_slot_t>();
+  return token;
+}
+
+// ETHUSDT against the "*" average of BTCUSDT, as the dialog sets it up
+std::vector<signal_t> replay(std::filesystem::path const &capture) {
+  replay_driver_t driver;
+  if (!driver.open(capture))
+    return {};
+
+  correlator_engine_t engine;
+  signal_recorder_t recorder(driver);
+  engine.setObserver(&recorder);
+  auto &settings = engine.settings();
+  settings.hasReferences = true;
+  settings.findingUmbral = true;
+  settings.threshold = threshold;
+  engine.refs().push_back(makeToken("BTCUSDT"));
+  engine.tokens().push_back(makeToken("*"));
+  engine.tokens().push_back(makeToken("ETHUSDT"));
+
+  for (auto *token : {&engine.refs()[0], &engine.tokens()[1]})
+    driver.addSubscription(token->symbolName, token->tradeType,
+                           token->exchange, *token->realPrice,
+                           token->priceSource);
+  engine.attachTickRings();
+  engine.startSignals();
+  driver.setPrimedCallback([&engine] {
+    for (auto *token : {&engine.refs()[0], &engine.tokens()[1]})
+      updateTokenIter(*token);
+    engine.seedRefAverage();
+  });
+  driver.addTimer(timerTick, timerTick, [&engine](double const key) {
+    engine.onNormalizedTimerTick(key, false);
+  });
+  driver.run(0.0);
+  return recorder.signals;
+}
+
+} // namespace
+
+// Replays a fixed capture through the parsers and the engine twice, and
+// checks both runs emit the same, expected crossover signals.
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  auto const root = std::filesystem::temp_directory_path() /
+                    ("korrelator-replay-" +
+                     std::to_string(QCoreApplication::applicationPid()));
+  auto const capture = writeCapture(root);
+  auto const first = replay(capture);
+  auto const second = replay(capture);
+  std::error_code ec;
+  std::filesystem::remove_all(root, ec);
+
+  int failures = 0;
+  if (first.size() != expectedSignals) {
+    std::fprintf(stderr, "%zu signal(s) emitted, %zu expected\n",
+                 first.size(), expectedSignals);
+    ++failures;
+  }
+  if (!(first == second)) {
+    std::fprintf(stderr, "the replays emitted different signals\n");
+    ++failures;
+  }
+
+  // ETH normalizes to 0.5 + 2 * (price / 1000 - 1) against a ref of 0.5, so
+  // a buy reaches the threshold at 1025 and a sell at 977.27. It opens level
+  // with the ref, which misses the first crossing up: sells and buys
+  // alternate from a sell.
+  for (std::size_t i = 0; i < first.size(); ++i) {
+    auto const &signal = first[i];
+    bool const isBuy = signal.action == trade_action_e::buy;
+    bool const isExpected =
+        (i % 2 == 0 ? signal.action == trade_action_e::sell : isBuy) &&
+        (isBuy ? signal.crossPrice > 1000.0 && signal.price >= 1025.0
+               : signal.crossPrice < 1000.0 && signal.price <= 977.27);
+    std::printf("%s %-4s crossed %.2f signalled %.2f\n",
+                signal.time.toStdString().c_str(), isBuy ? "BUY" : "SELL",
+                signal.crossPrice, signal.price);
+    if (!isExpected) {
+      std::fprintf(stderr, "unexpected signal %zu\n", i);
+      ++failures;
+    }
+  }
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
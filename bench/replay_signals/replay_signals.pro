@@ -0,0 +1,7 @@
+# A fixed capture replayed through the parsers and the engine, checking the
+# crossover signals it emits. Needs no network nor display.
+
+TARGET = replay_signals
+include(../bench.pri)
+
+SOURCES += replay_signals.cpp
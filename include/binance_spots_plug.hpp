@@ -5,6 +5,7 @@
 #include <boost/beast/http/string_body.hpp>
 #include <boost/beast/ssl/ssl_stream.hpp>
 
+#include "dns_cache.hpp"
 #include "utils.hpp"
 #include <string>
 #include <optional>
@@ -45,7 +46,7 @@ private:
   [[nodiscard]] bool createRequestData();
   void performSSLHandshake(tcp::resolver::results_type::endpoint_type const &);
   void onHandshook(beast::error_code ec);
-  void onHostResolved(tcp::resolver::results_type const &);
+  void onHostResolved(dns_cache_t::endpoints_t const &);
   void sendHttpsData();
   void onDataSent(beast::error_code, std::size_t const);
   void receiveData();
@@ -3,13 +3,26 @@
 #include <QString>
 
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/beast/core/tcp_stream.hpp>
 #include <boost/beast/ssl/ssl_stream.hpp>
 #include <boost/beast/websocket/stream.hpp>
 
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <optional>
 
 #include "constants.hpp"
+#include "dns_cache.hpp"
+#include "feed_arbiter.hpp"
+#include "frame_conflation.hpp"
+#include "handler_memory.hpp"
+#include "latency_histogram.hpp"
+#include "order_book.hpp"
+#include "reconnect_backoff.hpp"
+#include "tick_slot.hpp"
 #include "utils.hpp"
 
 namespace boost {
@@ -30,21 +43,51 @@ class io_context;
 
 namespace korrelator {
 
+class frame_journal_t;
+
 namespace net = boost::asio;
 namespace beast = boost::beast;
 namespace ip = net::ip;
 
+// a single combined-stream connection that carries every symbol of a market
 class binance_ws {
 
   using resolver_result_type = net::ip::tcp::resolver::results_type;
-  using address_list_t = std::vector<internal_address_t>;
+
+  // one @depth@100ms event, U/u/pu in Binance's terms
+  struct depth_event_t {
+    std::int64_t firstUpdateId = 0;
+    std::int64_t finalUpdateId = 0;
+    std::int64_t previousFinalUpdateId = 0; // futures only
+    std::vector<level_update_t> updates;
+  };
+
+  struct stream_data_t {
+    std::string tokenName; // lowercase symbol, e.g. "btcusdt"
+    // every slot watching the symbol, a ref and a traded token can share it
+    std::vector<tick_slot_t *> priceResults;
+    order_book_t *orderBook = nullptr;
+    price_source_e priceSource = price_source_e::last_trade;
+    // Depth events received while the REST snapshot is in flight, replayed
+    // once it lands: those already covered by its lastUpdateId are dropped
+    // and the first one kept must straddle it. Past 2'000 the oldest go: a
+    // buffer that deep is stale, and a snapshot it no longer reaches back to
+    // is simply requested again.
+    std::vector<depth_event_t> pendingDepth;
+    held_price_t heldPrice; // only with conflation
+    bool snapshotInFlight = false;
+    bool awaitingFirstDepth = false;
+  };
 
 public:
   using resolver = ip::tcp::resolver;
   using results_type = resolver::results_type;
 
+  // in dual-feed mode, two connections share `arbiter` and only the first
+  // copy of every update reaches the price slots
   binance_ws(net::io_context &ioContext, net::ssl::context &sslContext,
-             double &priceResult, trade_type_e const tradeType)
+             trade_type_e const tradeType, feed_arbiter_t *arbiter = nullptr,
+             int const feedIndex = 0)
       : m_host(tradeType == trade_type_e::spot
                    ? constants::binance_ws_spot_url
                    : constants::binance_ws_futures_url),
@@ -52,40 +95,142 @@ public:
                    ? constants::binance_ws_spot_port
                    : constants::binance_ws_futures_port),
         m_ioContext(ioContext), m_sslContext(sslContext),
-        m_priceResult(priceResult) {}
+        m_strand(net::make_strand(ioContext)), m_arbiter(arbiter),
+        m_tradeType(tradeType), m_feedIndex(feedIndex) {}
 
   ~binance_ws();
   void startFetching();
-  void requestStop() { m_requestedToStop = true; }
-  void addSubscription(QString const &tokenName) {
-    m_tokenName = internal_address_t{tokenName, false};
+  // Stops reconnecting and sends a close frame. `onClosed` runs on the
+  // connection's strand once the exchange answered or the connection is gone,
+  // and not at all if the io_context stops first.
+  void close(std::function<void()> onClosed);
+  trade_type_e tradeType() const { return m_tradeType; }
+  int feedIndex() const { return m_feedIndex; } // 0 => primary
+  feed_latency_t const &latency() const { return m_latency; }
+  // raw frames are appended to `journal` when set, before `startFetching`
+  void setJournal(frame_journal_t *journal) { m_journal = journal; }
+  // before `startFetching`, see `held_price_t`
+  void setConflation(bool const enabled) { m_conflating = enabled; }
+  // prices replaced by a newer one before they were stored
+  std::uint64_t conflatedFrames() const {
+    return m_conflatedFrames.load(std::memory_order_relaxed);
   }
 
+  // only valid before `startFetching`, the stream is part of the handshake URL
+  void addSubscription(QString const &tokenName, tick_slot_t &priceResult,
+                       price_source_e const priceSource);
+  // also only valid before `startFetching`, keeps `book` in sync with the
+  // symbol's depth stream
+  void addOrderBook(QString const &tokenName, order_book_t &book);
+
+  // runtime (un)subscription over an already running connection
+  void subscribe(QString const &tokenName, tick_slot_t &priceResult,
+                 price_source_e const priceSource);
+  // the symbol's streams go once its last slot is unsubscribed
+  void unsubscribe(QString const &tokenName, tick_slot_t &priceResult);
+  // recovery for a symbol gone silent on an open connection, no-ops while
+  // the connection is still being set up
+  void resubscribe(QString const &tokenName);
+  void forceReconnect();
+
 private:
   binance_ws *shared_from_this() { return this; }
   void interpretGenericMessages();
-  void websockConnectToResolvedNames(resolver_result_type const &);
+  void interpretDepthMessage(char const *str, size_t const size);
+  void applyDepthEvent(stream_data_t &stream, depth_event_t &&event);
+  void requestDepthSnapshot(stream_data_t &stream);
+  void onDepthSnapshot(std::string const &tokenName, std::string const &body);
+  void resetOrderBooks();
+  void websockConnectToResolvedNames(dns_cache_t::endpoints_t endpoints);
   void websockPerformSslHandshake(resolver_result_type::endpoint_type const &);
   void negotiateWebsocketConnection();
   void performWebsocketHandshake();
   void waitForMessages();
-  void makeSubscription();
+  void scheduleReconnect();
+  void startIdleTimer();
+  void waitForIdleTimer();
+  void onIdleTimerTick(beast::error_code const &ec);
+  bool isFirstCopy(std::int64_t const updateId) {
+    return !m_arbiter ||
+           m_arbiter->accept(m_lastStreamName, updateId, m_feedIndex);
+  }
+  // the depth stream goes along when `withDepth` is set
+  void sendSubscriptionRequest(char const *method, stream_data_t const &stream,
+                               bool const withDepth = false);
+  bool interpretBookTicker(char const *str, size_t const size,
+                           std::int64_t const receiveTimeNs);
+  void writeNextMessage();
+  void updateBookTickerCount();
+  void storePrice(stream_data_t &stream, double const price,
+                  std::int64_t const eventTimeMs,
+                  std::int64_t const receiveTimeNs);
+  void storeHeldPrices();
+  void postHeldPriceFlush();
+  stream_data_t *findStream(std::string const &streamName);
 
 private:
   std::string const m_host;
   std::string const m_port;
   net::io_context &m_ioContext;
   net::ssl::context &m_sslContext;
-  internal_address_t m_tokenName;
+  net::strand<net::io_context::executor_type> m_strand;
+  std::vector<stream_data_t> m_streams;
   std::optional<resolver> m_resolver = std::nullopt;
-  std::optional<beast::websocket::stream<beast::ssl_stream<beast::tcp_stream>>>
+  // reused by every read, pending reads keep it alive past this socket
+  std::shared_ptr<handler_memory_t> m_handlerMemory =
+      std::make_shared<handler_memory_t>();
+  beast::flat_buffer m_readBuffer;
+  std::optional<beast::websocket::stream<beast::ssl_stream<strand_tcp_stream_t>>>
       m_sslWebStream;
-  std::optional<beast::flat_buffer> m_readBuffer;
-  std::string m_writeBuffer;
-  double &m_priceResult;
+  std::optional<net::steady_timer> m_reconnectTimer;
+  // beast's own idle timeout re-arms a timer, and allocates, on every read
+  std::optional<net::steady_timer> m_idleTimer;
+  reconnect_backoff_t m_backoff;
+  feed_latency_t m_latency;
+  frame_journal_t *m_journal = nullptr;
+  feed_arbiter_t *const m_arbiter;
+  std::deque<std::string> m_writeQueue;
+  std::string m_lastStreamName;
+  trade_type_e const m_tradeType;
+  int const m_feedIndex;
+  int m_requestID = 0;
+  size_t m_bookTickerCount = 0;
+  size_t m_heldPriceCount = 0;
+  int m_quietFlushPasses = 0; // see `held_price_t`
+  std::atomic<std::uint64_t> m_conflatedFrames{0};
+  bool m_hasOrderBooks = false;
+  bool m_conflating = false;
+  bool m_framesWaiting = false; // more frames after the current one
+  bool m_heldPriceFlushPosted = false;
+  bool m_readSinceFlushPosted = false;
+  bool m_readSinceIdleCheck = false;
+  bool m_idlePingSent = false;
   bool m_requestedToStop = false;
 };
 
-double binanceGetCoinPrice(char const *str, size_t const size);
+struct book_ticker_t {
+  double bidPrice = 0.0;
+  double bidQuantity = 0.0;
+  double askPrice = 0.0;
+  double askQuantity = 0.0;
+
+  double mid() const { return (bidPrice + askPrice) / 2.0; }
+  // leans towards the side more likely to move, the thinner one
+  double microPrice() const {
+    auto const totalQuantity = bidQuantity + askQuantity;
+    if (totalQuantity <= 0.0)
+      return mid();
+    return (bidPrice * askQuantity + askPrice * bidQuantity) / totalQuantity;
+  }
+};
+
+double binanceGetCoinPrice(char const *str, size_t const size,
+                           std::string &streamName, std::int64_t &eventTimeMs,
+                           std::int64_t &updateId);
+// false if the frame isn't a valid "<symbol>@bookTicker" frame, only the
+// stream name is read in that case
+bool binanceGetBookTicker(char const *str, size_t const size,
+                          std::string &streamName, book_ticker_t &ticker,
+                          std::int64_t &eventTimeMs, std::int64_t &updateId);
 
 } // namespace korrelator
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/tcp_stream.hpp>
+#include <boost/beast/http/empty_body.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <boost/beast/ssl/ssl_stream.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dns_cache.hpp"
+#include "reconnect_backoff.hpp"
+#include "utils.hpp"
+
+namespace korrelator {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+
+// Wall clock in microseconds since the epoch, advanced by the monotonic clock
+// from a single reading taken at startup, so a local clock step never shows.
+std::int64_t localNowUs();
+// `localNowUs()` at the instant `steadyNowNs()` returned `steadyTimeNs`
+std::int64_t steadyToLocalUs(std::int64_t const steadyTimeNs);
+std::int64_t steadyToLocalNs(std::int64_t const steadyTimeNs);
+
+// The exchange's clock as estimated by `clock_sync_t`, the local one until
+// the first sample arrives. Cheap enough to call on every request.
+std::int64_t exchangeNowMs(exchange_name_e const exchange,
+                           trade_type_e const tradeType);
+// exchange time, in microseconds, of a local `steadyNowNs()` reading
+std::int64_t steadyToExchangeUs(exchange_name_e const exchange,
+                                trade_type_e const tradeType,
+                                std::int64_t const steadyTimeNs);
+std::int64_t exchangeClockOffsetUs(exchange_name_e const exchange,
+                                   trade_type_e const tradeType);
+
+// Measures one exchange's clock over a single keep-alive HTTPS connection:
+// a warm-up request, then `sampleCount` timed ones. The sample with the
+// smallest round trip wins and its offset assumes a symmetric path (RTT/2).
+class clock_probe_t : public std::enable_shared_from_this<clock_probe_t> {
+  using resolver = net::ip::tcp::resolver;
+  using strand_t = net::strand<net::io_context::executor_type>;
+
+public:
+  struct sample_t {
+    std::int64_t offsetUs = 0; // exchange minus local
+    std::int64_t roundTripUs = 0;
+  };
+  using callback_t = std::function<void(std::optional<sample_t> const &)>;
+
+  clock_probe_t(strand_t strand, net::ssl::context &sslContext,
+                std::string host, std::string target, int const sampleCount,
+                callback_t callback);
+  void run();
+
+private:
+  void connect(dns_cache_t::endpoints_t const &);
+  void performSslHandshake();
+  void sendRequest();
+  void receiveResponse();
+  void fail(char const *what, beast::error_code const &ec);
+
+  strand_t m_strand;
+  net::ssl::context &m_sslContext;
+  std::string const m_host;
+  std::string const m_target;
+  int const m_sampleCount;
+  int m_requestsDone = 0;
+  std::int64_t m_requestSentUs = 0;
+  std::optional<sample_t> m_bestSample;
+  callback_t m_callback;
+  std::optional<resolver> m_resolver;
+  std::optional<beast::ssl_stream<beast::tcp_stream>> m_sslStream;
+  beast::flat_buffer m_buffer;
+  beast::http::request<beast::http::empty_body> m_request;
+  std::optional<beast::http::response<beast::http::string_body>> m_response;
+};
+
+// Background service that keeps the offset of every exchange clock used by
+// `exchangeNowMs` up to date. Runs on its own thread.
+class clock_sync_t {
+  struct endpoint_t {
+    exchange_name_e exchange;
+    trade_type_e tradeType;
+    std::string host;
+    std::string target;
+    std::unique_ptr<net::steady_timer> timer;
+    reconnect_backoff_t backoff{std::chrono::seconds(2),
+                                std::chrono::minutes(2)};
+    bool hasOffset = false;
+  };
+
+public:
+  explicit clock_sync_t(net::ssl::context &sslContext);
+  ~clock_sync_t();
+  clock_sync_t(clock_sync_t const &) = delete;
+  clock_sync_t &operator=(clock_sync_t const &) = delete;
+
+  void start();
+  void stop();
+
+private:
+  void probe(endpoint_t &endpoint);
+  void onSample(endpoint_t &endpoint,
+                std::optional<clock_probe_t::sample_t> const &sample);
+  void scheduleProbe(endpoint_t &endpoint, std::chrono::milliseconds delay);
+
+  net::io_context m_ioContext{1};
+  std::optional<net::executor_work_guard<net::io_context::executor_type>>
+      m_workGuard;
+  net::strand<net::io_context::executor_type> m_strand;
+  net::ssl::context &m_sslContext;
+  std::vector<endpoint_t> m_endpoints;
+  std::thread m_thread;
+};
+
+} // namespace korrelator
@@ -1,22 +1,23 @@
 #pragma once
 
 #include <cstddef>
+#include <string>
 
 namespace korrelator {
 
 struct constants {
-static char const *const binance_ws_futures_url;
-static char const *const binance_ws_spot_url;
-static char const *const binance_http_spot_host;
-static char const *const binance_http_futures_host;
-static char const *const binance_ws_spot_port;
-static char const *const binance_ws_futures_port;
-
-static char const *const kucoin_https_spot_host;
-static char const *const kucoin_https_spot_port;
-static char const *const kc_spot_http_request;
-static char const *const kc_futures_api_host;
-static char const *const kc_futures_http_request;
+static char const *binance_ws_futures_url;
+static char const *binance_ws_spot_url;
+static char const *binance_http_spot_host;
+static char const *binance_http_futures_host;
+static char const *binance_ws_spot_port;
+static char const *binance_ws_futures_port;
+
+static char const *kucoin_https_spot_host;
+static char const *kucoin_https_spot_port;
+static char const *kc_spot_http_request;
+static char const *kc_futures_api_host;
+static char const *kc_futures_http_request;
 
 static char const * const root_dir;
 static char const * const encrypted_config_filename;
@@ -25,8 +26,18 @@ static char const * const app_json_filename;
 static char const * const old_json_filename;
 static char const * const trade_json_filename;
 
-static size_t const futures_http_request_len;
-static size_t const spot_http_request_len;
+static size_t futures_http_request_len;
+static size_t spot_http_request_len;
+
+// service every HTTPS connection resolves, a port number once overridden
+static char const *https_port;
+static bool exchange_host_overridden;
+// Points every exchange host above at `host:port`, e.g. a local mock
+// exchange. Only before the first connection is made.
+static void overrideExchangeHost(std::string const &host,
+                                 std::string const &port);
+// "https://<host>", with the port appended once overridden
+static std::string httpsOrigin(char const *host);
 };
 
 }
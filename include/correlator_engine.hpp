@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "tokens.hpp"
+
+#define CMAX_DOUBLE_VALUE std::numeric_limits<double>::max()
+
+namespace korrelator {
+
+struct rot_metadata_t {
+  double restartOnTickEntry = 0.0;
+  double percentageEntry = 0.0;
+  double specialEntry = 0.0;
+
+  double afterDivisionPercentageEntry = 0.0;
+  double afterDivisionSpecialEntry = 0.0;
+};
+
+struct rot_t {
+  std::optional<rot_metadata_t> normalLines;
+  std::optional<rot_metadata_t> refLines;
+  std::optional<rot_metadata_t> special;
+};
+
+struct ref_calculation_data_t {
+  bool isResettingRef = false;
+  bool eachTickNormalize = false;
+};
+
+// a tick of one of the symbols in the crossover pair, see drainTickRings
+struct pending_tick_t {
+  token_t *token = nullptr;
+  double price = 0.0;
+  std::int64_t receiveTimeNs = 0;
+};
+
+struct correlator_settings_t {
+  rot_t restartTickValues;
+  double threshold = 0.0;           // amplitude a crossover must reach
+  double maxAverageThreshold = 0.0; // half the width of the price-delta band
+  double averageWindow = 100.0; // seconds of price deltas the band is over
+  std::size_t tickRingCapacity = tick_ring_t::defaultCapacity;
+  ring_overflow_policy_e tickRingPolicy = ring_overflow_policy_e::drop_oldest;
+  bool hasReferences = false; // tokens()[0] is the "*" average of the refs
+  bool findingUmbral = false; // umbral is spanish word for threshold
+  bool doingAutoLDClosure = false; // automatic "line distance" (LD) closure
+  bool doingManualLDClosure = false; // manualInterval LD closure
+  bool eventDrivenSignals = false;   // the band is checked on every tick
+};
+
+struct price_delta_band_t {
+  double average = 0.0;
+  double up = 0.0;
+  double down = 0.0;
+};
+
+// What the engine reports. Only the signals are needed, plotting is left to
+// an observer that wants it.
+class correlator_observer_t {
+public:
+  virtual ~correlator_observer_t() = default;
+
+  // a crossover of `symbol` reached the threshold
+  virtual void onCrossOverSignal(token_t const &symbol,
+                                 cross_over_data_t crossOver) = 0;
+  // the price delta left the band
+  virtual void onPriceDeltaSignal(trade_action_e const futuresAction) = 0;
+  // what signals are stamped with, the local time by default
+  virtual QString signalTime() const;
+
+  virtual void onNormalizedPoint(double const key, token_t const &ref,
+                                 token_t const &symbol,
+                                 bool const updatingMinMax);
+  virtual void onPriceDeltaPoint(double const key, double const delta,
+                                 bool const updatingMinMax);
+};
+
+void updateTokenIter(token_t &value, double const price);
+void updateTokenIter(token_t &value);
+trade_action_e lineCrossedOver(double const prevRef, double const currRef,
+                               double const prevValue, double const currValue);
+
+// Price normalization, the ref average, crossover detection, the LD closure
+// and the price-delta band of one traded symbol, without any widget. It
+// takes ticks from the price slots of its tokens and reports signals to its
+// observer; several can run side by side.
+//
+// Not thread-safe, every call is serialized by the caller.
+class correlator_engine_t {
+public:
+  correlator_engine_t() = default;
+  correlator_engine_t(correlator_engine_t const &) = delete;
+  correlator_engine_t &operator=(correlator_engine_t const &) = delete;
+
+  token_list_t &tokens() { return m_tokens; }
+  token_list_t &refs() { return m_refs; }
+  token_list_t &priceDeltas() { return m_priceDeltas; }
+  correlator_settings_t &settings() { return m_settings; }
+  price_delta_band_t &priceDeltaBand() { return m_priceDeltaBand; }
+  void setObserver(correlator_observer_t *observer) { m_observer = observer; }
+
+  // before any feed writes to the slots
+  void attachTickRings();
+  void attachTickRing(token_t &token) const;
+  // `startRequestedNs` is when Start was pressed, 0 when not measured
+  void startSignals(std::int64_t const startRequestedNs = 0);
+  void reset();
+
+  // the ref line from the refs' normalized prices, once they are seeded
+  void seedRefAverage();
+  void normalizePrices();
+  // a ref was removed, the jump of the average isn't a crossover
+  void refSetChanged() { m_refSetChanged = true; }
+  void drainTickRings();
+  void evaluatePriceDeltaTick();
+  void onNormalizedTimerTick(double const key, bool const updatingMinMax);
+  void onPriceDeltaTimerTick(double const key, bool const updatingMinMax);
+  // the band's average from the deltas of the last `averageWindow` seconds
+  void updatePriceDeltaAverage();
+
+private:
+  double averageRefPrice();
+  ref_calculation_data_t updateRef();
+  void evaluateCrossOver(double const prevRef, double const currentRef,
+                         token_t &value);
+  trade_action_e priceDeltaBandAction(double const result) const;
+  void resetTickerData(bool const resetRefs, bool const resetSymbols);
+  QString signalTime() const;
+
+  token_list_t m_tokens;
+  token_list_t m_refs;
+  token_list_t m_priceDeltas;
+  correlator_settings_t m_settings;
+  price_delta_band_t m_priceDeltaBand;
+  correlator_observer_t *m_observer = nullptr;
+  std::vector<pending_tick_t> m_pendingTicks;
+  // key and value of the price deltas inside `averageWindow`
+  std::deque<std::pair<double, double>> m_priceDeltaWindow;
+  std::int64_t m_startRequestedNs = 0; // until the first signal is evaluated
+  std::uint64_t m_tickRingDrops = 0;
+  std::size_t m_warmRefCount = 0; // refs in the last `averageRefPrice`
+  bool m_refSetChanged = false;   // no crossover across a ref joining/leaving
+  trade_action_e m_lastPriceDeltaAction = trade_action_e::nothing;
+};
+
+} // namespace korrelator
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QString>
+#include <cstdint>
+#include <string_view>
+
+namespace korrelator {
+
+// value = mantissa * 10^exponent, e.g. "0.00123450" => {123450, -8}
+struct decimal_t {
+  std::int64_t mantissa = 0;
+  std::int32_t exponent = 0;
+
+  double toDouble() const;
+};
+
+// Parses "[-+]digits[.digits][(e|E)[-+]digits]" with at most 19 significant
+// digits, eight digits at a time where possible. Locale independent.
+bool parseDecimal(char const *first, char const *const last,
+                  decimal_t &result);
+
+// Exact for the common exchange strings, anything the fast path can't
+// round correctly goes to std::from_chars, or to a stream in the classic
+// locale where that's missing. Infinities and NaNs are rejected.
+bool parseDouble(char const *first, char const *const last, double &result);
+
+inline bool parseDouble(std::string_view const str, double &result) {
+  return parseDouble(str.data(), str.data() + str.size(), result);
+}
+
+// integral values only, e.g. millisecond timestamps
+bool parseInteger(std::string_view const str, std::int64_t &result);
+
+// drop-in replacements for std::atof and QString::toDouble, 0.0 on error
+double stringToDouble(std::string_view const str);
+double stringToDouble(char const *str);
+double stringToDouble(QString const &str, bool *ok = nullptr);
+
+} // namespace korrelator
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/tcp_stream.hpp>
+#include <boost/beast/http/empty_body.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <boost/beast/ssl/ssl_stream.hpp>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "dns_cache.hpp"
+
+namespace boost {
+namespace asio {
+namespace ssl {
+class context;
+}
+class io_context;
+} // namespace asio
+} // namespace boost
+
+namespace korrelator {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+
+// One-shot public HTTPS GET used to fetch order book snapshots. It runs on
+// the strand of the websocket that asked for it, so the callback may touch
+// that websocket's state directly. `body` is empty on failure.
+class depth_snapshot_request_t
+    : public std::enable_shared_from_this<depth_snapshot_request_t> {
+  using resolver = net::ip::tcp::resolver;
+  using strand_t = net::strand<net::io_context::executor_type>;
+
+public:
+  using callback_t = std::function<void(std::string const &body)>;
+
+  depth_snapshot_request_t(strand_t strand, net::ssl::context &sslContext,
+                           std::string host, std::string target,
+                           callback_t callback);
+  void run();
+
+private:
+  void connect(dns_cache_t::endpoints_t const &);
+  void performSslHandshake();
+  void sendRequest();
+  void receiveResponse();
+  void fail(char const *what, beast::error_code const &ec);
+
+  strand_t m_strand;
+  net::ssl::context &m_sslContext;
+  std::string const m_host;
+  std::string const m_target;
+  callback_t m_callback;
+  std::optional<resolver> m_resolver;
+  std::optional<beast::ssl_stream<beast::tcp_stream>> m_sslStream;
+  beast::flat_buffer m_buffer;
+  beast::http::request<beast::http::empty_body> m_request;
+  beast::http::response<beast::http::string_body> m_response;
+};
+
+} // namespace korrelator
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace korrelator {
+
+namespace net = boost::asio;
+
+// Process-wide cache of resolved exchange hosts, so a connection or an order
+// doesn't wait on DNS. Callers look a host up first and only resolve it
+// themselves on a miss, handing the result back with `store`; that way no
+// handler ever crosses into another io_context. Known hosts are re-resolved
+// in the background before they expire.
+//
+// Endpoints come back fastest first, by the connect latency reported through
+// `recordConnect`; addresses never connected to yet are tried before them.
+class dns_cache_t {
+  using clock_t = std::chrono::steady_clock;
+
+public:
+  using endpoint_t = net::ip::tcp::endpoint;
+  using endpoints_t = std::vector<endpoint_t>;
+
+  static dns_cache_t &instance();
+  ~dns_cache_t();
+  dns_cache_t(dns_cache_t const &) = delete;
+  dns_cache_t &operator=(dns_cache_t const &) = delete;
+
+  // resolves `hosts` ({host, service}) on a background thread, then keeps
+  // every cached host fresh until `stop`
+  void prewarm(std::vector<std::pair<std::string, std::string>> hosts);
+  void stop();
+
+  std::optional<endpoints_t> lookup(std::string const &host,
+                                    std::string const &service);
+  endpoints_t store(std::string const &host, std::string const &service,
+                    net::ip::tcp::resolver::results_type const &results);
+  // `started` is when the connect to `endpoint` began
+  void recordConnect(endpoint_t const &endpoint, clock_t::time_point started);
+
+private:
+  struct entry_t {
+    endpoints_t endpoints;
+    clock_t::time_point resolvedAt;
+  };
+  using key_t = std::pair<std::string, std::string>;
+
+  dns_cache_t() = default;
+  endpoints_t ordered(endpoints_t endpoints) const;
+  void refreshAll();
+  void scheduleRefresh();
+
+  std::mutex m_mutex;
+  std::map<key_t, entry_t> m_entries;
+  std::map<endpoint_t, double> m_connectUs; // smoothed
+  net::io_context m_ioContext{1};
+  std::optional<net::executor_work_guard<net::io_context::executor_type>>
+      m_workGuard;
+  std::optional<net::ip::tcp::resolver> m_resolver;
+  std::optional<net::steady_timer> m_refreshTimer;
+  std::thread m_thread;
+};
+
+// every host and port in `constants`, after any override
+void prewarmExchangeHosts();
+
+// The standby feed of a pair (`feedIndex` 1) starts with a different
+// address than the primary, so both feeds don't depend on the same host.
+void rotateForFeed(dns_cache_t::endpoints_t &endpoints, int const feedIndex);
+
+} // namespace korrelator
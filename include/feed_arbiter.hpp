@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace korrelator {
+
+// De-duplicates the two copies of a market's feed in dual-feed mode. Both
+// connections of a pair run on the same io_context, so `accept` is never
+// called concurrently, only the counters are read from other threads.
+class feed_arbiter_t {
+public:
+  static constexpr int feedCount = 2; // primary, standby
+
+  explicit feed_arbiter_t(std::string name) : m_name(std::move(name)) {}
+  feed_arbiter_t(feed_arbiter_t const &) = delete;
+  feed_arbiter_t &operator=(feed_arbiter_t const &) = delete;
+
+  // true if `updateId` of `streamKey` hasn't been seen yet, i.e. `feed`
+  // delivered it first. Updates without an id (0) can't be de-duplicated
+  // and are always accepted.
+  bool accept(std::string const &streamKey, std::int64_t const updateId,
+              int const feed) {
+    if (updateId == 0)
+      return true;
+    auto iter = m_lastUpdateIds.find(streamKey);
+    if (iter == m_lastUpdateIds.end())
+      iter = m_lastUpdateIds.emplace(streamKey, 0).first;
+    if (updateId <= iter->second) {
+      m_duplicates[feed].fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    iter->second = updateId;
+    m_wins[feed].fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  std::string const &name() const { return m_name; }
+  std::uint64_t wins(int const feed) const {
+    return m_wins[feed].load(std::memory_order_relaxed);
+  }
+  std::uint64_t duplicates(int const feed) const {
+    return m_duplicates[feed].load(std::memory_order_relaxed);
+  }
+
+private:
+  std::string const m_name;
+  std::unordered_map<std::string, std::int64_t> m_lastUpdateIds;
+  std::atomic<std::uint64_t> m_wins[feedCount]{};
+  std::atomic<std::uint64_t> m_duplicates[feedCount]{};
+};
+
+} // namespace korrelator
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace korrelator {
+
+class tick_slot_t;
+
+// Spots symbols whose price stopped updating while their connection stays
+// up. Each symbol's normal update interval is learnt from its own slot, so a
+// quiet altcoin isn't held to the pace of BTC. A silent symbol is marked
+// stale and first resubscribed, then its connection is reconnected, with the
+// wait doubling between attempts until a price arrives again.
+//
+// `check`, `addSymbol` and `removeSymbol` are serialized by the caller,
+// `anyStale` is safe from any thread.
+class feed_watchdog_t {
+public:
+  enum class action_e { resubscribe, reconnect };
+  using action_callback_t =
+      std::function<void(std::size_t const symbolIndex, action_e const)>;
+
+  // a symbol is silent after `silenceFactor` times its usual interval,
+  // never less than `minimumSilence` nor more than `maximumSilence`
+  explicit feed_watchdog_t(
+      std::chrono::milliseconds const minimumSilence =
+          std::chrono::seconds(5),
+      std::chrono::milliseconds const maximumSilence =
+          std::chrono::minutes(5),
+      double const silenceFactor = 20.0);
+  feed_watchdog_t(feed_watchdog_t const &) = delete;
+  feed_watchdog_t &operator=(feed_watchdog_t const &) = delete;
+
+  std::size_t addSymbol(std::string name, tick_slot_t const &slot);
+  // the index stays reserved, the symbol is simply never checked again
+  void removeSymbol(std::size_t const symbolIndex);
+  void check(std::int64_t const nowNs, action_callback_t const &onSilence);
+
+  bool anyStale() const {
+    return m_staleCount.load(std::memory_order_acquire) != 0;
+  }
+  std::string const &name(std::size_t const symbolIndex) const {
+    return m_symbols[symbolIndex]->name;
+  }
+
+private:
+  struct symbol_t {
+    std::string name;
+    tick_slot_t const *slot = nullptr;
+    std::uint64_t lastSequence = 0;
+    std::int64_t lastChangeNs = 0;  // 0 => not checked yet
+    double intervalNs = 0.0;        // smoothed, 0 => not learnt yet
+    std::int64_t nextActionNs = 0;  // while stale
+    int attempts = 0;               // actions taken since it went silent
+    std::atomic_bool stale{false};
+  };
+
+  std::int64_t silenceNs(symbol_t const &symbol) const;
+
+  std::int64_t const m_minimumSilenceNs;
+  std::int64_t const m_maximumSilenceNs;
+  double const m_silenceFactor;
+  std::vector<std::unique_ptr<symbol_t>> m_symbols;
+  std::atomic<std::size_t> m_staleCount{0};
+};
+
+} // namespace korrelator
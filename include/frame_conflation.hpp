@@ -0,0 +1,43 @@
+#pragma once
+
+#include <openssl/ssl.h>
+
+#include <boost/beast/core/stream_traits.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstdint>
+
+namespace korrelator {
+
+// With conflation, a connection stores only the newest price per symbol of a
+// burst: while more frames are already waiting, a price is held rather than
+// stored, and a newer one for the same symbol replaces it. Held prices are
+// stored once a frame is done with nothing more waiting, and on a reconnect.
+//
+// What's waiting may also be a control frame or part of a frame still on
+// its way, so a connection holding prices posts a flush too. It stores them
+// once two io_context passes went by without a frame; a frame read out of
+// OpenSSL's buffer needs the second pass to arrive. The flush is posted to
+// the io_context: queued on the running strand instead, the strand would
+// reschedule itself with asio's own handler memory, which allocates.
+struct held_price_t {
+  double price = 0.0;
+  std::int64_t eventTimeMs = 0;
+  std::int64_t receiveTimeNs = 0;
+  bool isHeld = false;
+};
+
+// Bytes of later frames already in OpenSSL or the kernel. Beast's own read
+// buffer is small and not visible, so the last few frames of a burst are
+// still stored one by one.
+template <typename SslWebsocketStream>
+bool moreFramesWaiting(SslWebsocketStream &stream) {
+  if (SSL_has_pending(stream.next_layer().native_handle()))
+    return true;
+  boost::system::error_code ec;
+  auto const bytes =
+      boost::beast::get_lowest_layer(stream).socket().available(ec);
+  return !ec && bytes > 0;
+}
+
+} // namespace korrelator
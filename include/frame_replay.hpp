@@ -0,0 +1,163 @@
+#pragma once
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <QString>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "feed_arbiter.hpp"
+#include "utils.hpp"
+
+namespace korrelator {
+
+class tick_slot_t;
+
+struct replay_frame_t {
+  char const *data = nullptr;
+  std::uint32_t length = 0;
+  std::uint32_t connectionId = 0;
+  std::int64_t monotonicNs = 0;
+  std::int64_t wallNs = 0;
+};
+
+// Read-only view of a session written by `frame_capture_t`: every segment is
+// mapped and the frames of all connections are merged in the order they were
+// read, ties broken by connection id, so two reads give the same sequence.
+class capture_reader_t {
+  struct segment_t {
+    boost::interprocess::file_mapping file;
+    boost::interprocess::mapped_region region;
+  };
+
+public:
+  capture_reader_t() = default;
+  capture_reader_t(capture_reader_t const &) = delete;
+  capture_reader_t &operator=(capture_reader_t const &) = delete;
+
+  bool open(std::filesystem::path const &directory);
+  std::vector<replay_frame_t> const &frames() const { return m_frames; }
+  // connection id -> name, as listed in "connections.txt"
+  std::map<std::uint32_t, std::string> const &connections() const {
+    return m_connections;
+  }
+
+private:
+  void readSegment(segment_t const &segment);
+
+  std::vector<std::unique_ptr<segment_t>> m_segments;
+  std::vector<replay_frame_t> m_frames;
+  std::map<std::uint32_t, std::string> m_connections;
+};
+
+// Feeds a capture through the same parsers the websockets use and stores the
+// prices in the subscribed slots, with the recorded read time as the receive
+// time. Timers fire on recorded time rather than the local clock, so a replay
+// produces the same signals whatever the speed it runs at.
+class replay_driver_t {
+  struct connection_t {
+    exchange_name_e exchange = exchange_name_e::none;
+    trade_type_e tradeType = trade_type_e::unknown;
+    int feedIndex = 0;
+    feed_arbiter_t *arbiter = nullptr; // only if the capture had a standby
+  };
+
+  struct subscription_t {
+    std::string tokenName; // as the exchange spells it in its frames
+    exchange_name_e exchange;
+    trade_type_e tradeType;
+    price_source_e priceSource;
+    tick_slot_t *priceResult = nullptr;
+    bool hasPrice = false;
+  };
+
+public:
+  using timer_callback_t = std::function<void(double const key)>;
+
+  struct statistics_t {
+    std::uint64_t frames = 0;
+    std::uint64_t ticks = 0;
+    double recordedSeconds = 0.0;
+    double elapsedSeconds = 0.0;
+    double ticksPerSecond() const {
+      return elapsedSeconds > 0.0 ? double(ticks) / elapsedSeconds : 0.0;
+    }
+  };
+
+  replay_driver_t() = default;
+  replay_driver_t(replay_driver_t const &) = delete;
+  replay_driver_t &operator=(replay_driver_t const &) = delete;
+
+  bool open(std::filesystem::path const &directory);
+  void addSubscription(QString const &tokenName, trade_type_e const tradeType,
+                       exchange_name_e const exchange, tick_slot_t &priceResult,
+                       price_source_e const priceSource);
+
+  // called once, when every subscription has received its first price.
+  // Timers count from that frame on, with keys in seconds since it.
+  void setPrimedCallback(std::function<void()> callback) {
+    m_primedCallback = std::move(callback);
+  }
+  // after every frame that stored a price, once primed
+  void setTickCallback(std::function<void()> callback) {
+    m_tickCallback = std::move(callback);
+  }
+  // `interval` of zero fires only once
+  void addTimer(std::chrono::milliseconds const firstDue,
+                std::chrono::milliseconds const interval,
+                timer_callback_t callback);
+
+  // `speed` 1.0 keeps the recorded pace, 2.0 twice as fast and 0.0 doesn't
+  // wait at all. Blocks until the capture ends or `requestStop` is called.
+  statistics_t run(double const speed);
+  void requestStop() { m_stopRequested.store(true, std::memory_order_relaxed); }
+  // recorded wall clock, in nanoseconds, of the frame or timer being handled
+  std::int64_t wallTimeNs() const {
+    return m_wallTimeNs.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct replay_timer_t {
+    std::int64_t dueNs = 0; // relative to the primed frame
+    std::int64_t intervalNs = 0;
+    timer_callback_t callback;
+  };
+
+  void mapConnections();
+  bool interpretFrame(replay_frame_t const &frame);
+  bool interpretBinanceFrame(connection_t const &connection,
+                             replay_frame_t const &frame);
+  bool interpretKuCoinFrame(connection_t const &connection,
+                            replay_frame_t const &frame);
+  subscription_t *findSubscription(exchange_name_e const exchange,
+                                   trade_type_e const tradeType,
+                                   std::string const &tokenName);
+  void storePrice(subscription_t const &subscription, double const price,
+                  std::int64_t const eventTimeMs,
+                  std::int64_t const receiveTimeNs);
+  void fireTimers(std::int64_t const untilNs, replay_frame_t const &frame);
+
+  capture_reader_t m_reader;
+  std::map<std::uint32_t, connection_t> m_connections;
+  std::map<std::string, std::unique_ptr<feed_arbiter_t>> m_arbiters;
+  std::vector<subscription_t> m_subscriptions;
+  std::vector<replay_timer_t> m_timers;
+  std::function<void()> m_primedCallback;
+  std::function<void()> m_tickCallback;
+  std::string m_lastStreamName;
+  std::size_t m_subscriptionsWithoutPrice = 0;
+  std::int64_t m_primedNs = -1; // recorded monotonic time, -1 => not yet
+  std::atomic<std::int64_t> m_wallTimeNs{0};
+  std::atomic_bool m_stopRequested{false};
+};
+
+} // namespace korrelator
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace korrelator {
+
+enum class scan_result_e { found, missing, malformed };
+
+struct json_field_t {
+  std::string_view key;
+  std::string_view value; // without the quotes, points into the frame
+  bool found = false;
+};
+
+// Looks up `count` fields of a JSON text in a single pass, without building
+// a DOM and without allocating. Nesting is ignored so every requested key
+// must be unique within the frame, the first occurrence wins. Strings with
+// escape sequences are reported as malformed, callers should then fall
+// back to a full parser, their slow path. On return, `first` points past the
+// last field read. Callers keep the values they need by assigning them to
+// strings they own, whose capacity is reused from frame to frame.
+scan_result_e scanJsonFields(char const *&first, char const *const last,
+                             json_field_t *fields, std::size_t const count);
+
+template <std::size_t N>
+scan_result_e scanJsonFields(char const *&first, char const *const last,
+                             json_field_t (&fields)[N]) {
+  return scanJsonFields(first, last, fields, N);
+}
+
+// returns the first '"' or '\\' in [first, last), or `last` if none
+char const *findQuoteOrEscape(char const *first, char const *const last);
+
+} // namespace korrelator
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core/tcp_stream.hpp>
+
+namespace korrelator {
+
+// A TCP stream bound to a concrete strand type. `beast::tcp_stream` keeps
+// its strand in an `any_io_executor`, which heap-allocates a copy of it on
+// every operation a websocket read goes through.
+using strand_tcp_stream_t =
+    boost::beast::basic_stream<boost::asio::ip::tcp,
+                               boost::asio::strand<
+                                   boost::asio::io_context::executor_type>>;
+
+// Recycled storage for the completion handlers of one connection, so a
+// steady stream of frames doesn't hit the heap. Asio frees an operation's
+// memory before calling its handler, so a read loop keeps reusing the same
+// few blocks; larger requests, or more than `slotCount` at once, fall back
+// to the heap. Not thread-safe: every operation using it must run on the
+// connection's strand, or after its io_context's threads are joined.
+//
+// Handlers and their allocators share ownership of it, so operations still
+// pending when the connection is deleted can be destroyed with their
+// io_context later on.
+class handler_memory_t {
+public:
+  static constexpr std::size_t slotSize = 1024;
+  static constexpr std::size_t slotCount = 4;
+
+  handler_memory_t() = default;
+  handler_memory_t(handler_memory_t const &) = delete;
+  handler_memory_t &operator=(handler_memory_t const &) = delete;
+
+  void *allocate(std::size_t const size) {
+    if (size <= slotSize) {
+      for (std::size_t i = 0; i < slotCount; ++i) {
+        if (!m_inUse[i]) {
+          m_inUse[i] = true;
+          return &m_slots[i];
+        }
+      }
+    }
+    return ::operator new(size);
+  }
+
+  void deallocate(void *const pointer) {
+    for (std::size_t i = 0; i < slotCount; ++i) {
+      if (pointer == &m_slots[i]) {
+        m_inUse[i] = false;
+        return;
+      }
+    }
+    ::operator delete(pointer);
+  }
+
+private:
+  std::array<std::aligned_storage_t<slotSize>, slotCount> m_slots;
+  std::array<bool, slotCount> m_inUse{};
+};
+
+template <typename T> class handler_allocator_t {
+public:
+  using value_type = T;
+
+  explicit handler_allocator_t(
+      std::shared_ptr<handler_memory_t> memory) noexcept
+      : m_memory(std::move(memory)) {}
+  template <typename U>
+  handler_allocator_t(handler_allocator_t<U> const &other) noexcept
+      : m_memory(other.m_memory) {}
+
+  T *allocate(std::size_t const n) const {
+    return static_cast<T *>(m_memory->allocate(sizeof(T) * n));
+  }
+  void deallocate(T *const pointer, std::size_t) const {
+    m_memory->deallocate(pointer);
+  }
+
+  bool operator==(handler_allocator_t const &other) const noexcept {
+    return m_memory == other.m_memory;
+  }
+  bool operator!=(handler_allocator_t const &other) const noexcept {
+    return m_memory != other.m_memory;
+  }
+
+private:
+  template <typename> friend class handler_allocator_t;
+  std::shared_ptr<handler_memory_t> m_memory;
+};
+
+// a completion handler whose associated allocator is `handler_memory_t`
+template <typename Handler> class recycling_handler_t {
+public:
+  using allocator_type = handler_allocator_t<Handler>;
+
+  recycling_handler_t(std::shared_ptr<handler_memory_t> memory,
+                      Handler handler)
+      : m_memory(std::move(memory)), m_handler(std::move(handler)) {}
+
+  allocator_type get_allocator() const noexcept {
+    return allocator_type(m_memory);
+  }
+
+  template <typename... Args> void operator()(Args &&...args) {
+    m_handler(std::forward<Args>(args)...);
+  }
+
+private:
+  std::shared_ptr<handler_memory_t> m_memory;
+  Handler m_handler;
+};
+
+template <typename Handler>
+recycling_handler_t<std::decay_t<Handler>>
+makeRecyclingHandler(std::shared_ptr<handler_memory_t> const &memory,
+                     Handler &&handler) {
+  return recycling_handler_t<std::decay_t<Handler>>(
+      memory, std::forward<Handler>(handler));
+}
+
+} // namespace korrelator
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace korrelator {
+
+namespace net = boost::asio;
+
+// One io_context per thread, so every connection's handlers run on a
+// single thread with no reactor contention. Connections are handed out
+// round-robin and threads can optionally be pinned to CPUs.
+class io_context_pool_t {
+  using work_guard_t =
+      net::executor_work_guard<net::io_context::executor_type>;
+
+public:
+  // `cpuAffinity[i]` is the CPU of the i-th thread, threads without an
+  // entry (or with a negative one) are left to the scheduler
+  explicit io_context_pool_t(std::size_t threadCount,
+                             std::vector<int> cpuAffinity = {});
+  ~io_context_pool_t();
+  io_context_pool_t(io_context_pool_t const &) = delete;
+  io_context_pool_t &operator=(io_context_pool_t const &) = delete;
+
+  net::io_context &nextIOContext();
+  std::size_t size() const { return m_ioContexts.size(); }
+
+  void run();
+  // stops every context and joins the threads, handlers never run after it
+  void stop();
+
+private:
+  std::vector<std::unique_ptr<net::io_context>> m_ioContexts;
+  std::vector<std::optional<work_guard_t>> m_workGuards;
+  std::vector<std::thread> m_threads;
+  std::vector<int> const m_cpuAffinity;
+  std::size_t m_nextIOContext = 0;
+};
+
+} // namespace korrelator
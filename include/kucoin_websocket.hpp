@@ -7,8 +7,23 @@
 #include <boost/beast/ssl/ssl_stream.hpp>
 #include <boost/beast/websocket/stream.hpp>
 #include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
 
+#include <chrono>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <optional>
+#include "dns_cache.hpp"
+#include "feed_arbiter.hpp"
+#include "frame_conflation.hpp"
+#include "handler_memory.hpp"
+#include "latency_histogram.hpp"
+#include "order_book.hpp"
+#include "reconnect_backoff.hpp"
+#include "tick_slot.hpp"
 #include "uri.hpp"
 
 namespace boost {
@@ -21,6 +36,9 @@ class io_context;
 }
 
 namespace korrelator {
+
+class frame_journal_t;
+
 namespace net = boost::asio;
 namespace ssl = net::ssl;
 namespace beast = boost::beast;
@@ -30,7 +48,8 @@ namespace ip = net::ip;
 enum class trade_type_e;
 enum class exchange_name_e;
 
-// kucoin websocket
+// kucoin websocket, one connection carries up to `maxTopicsPerConnection`
+// ticker topics of the same market
 class kucoin_ws {
 
   struct instance_server_data_t {
@@ -39,55 +58,171 @@ class kucoin_ws {
     int pingTimeoutMs = 0;
     int encryptProtocol = 0; // bool encrypt or not
   };
+
+  // the bullet-public token is shared by every connection of a market
+  // and reused until it expires
+  struct bullet_token_t {
+    std::string token;
+    std::vector<instance_server_data_t> instanceServers;
+    std::chrono::steady_clock::time_point expiresAt;
+  };
+
+  struct depth_change_t {
+    level_update_t level;
+    std::int64_t sequence = 0;
+  };
+
+  // one level2 message, futures messages carry a single change
+  struct depth_event_t {
+    std::int64_t sequenceStart = 0;
+    std::int64_t sequenceEnd = 0;
+    std::vector<depth_change_t> changes;
+  };
+
+  struct topic_data_t {
+    std::string tokenName; // uppercase symbol, e.g. "BTC-USDT"
+    // every slot watching the symbol, a ref and a traded token can share it
+    std::vector<tick_slot_t *> priceResults;
+    order_book_t *orderBook = nullptr;
+    // Level2 messages received while the REST snapshot is in flight. Once it
+    // lands, changes up to its sequence are skipped and the rest applied from
+    // sequence + 1; a gap past it forces a new snapshot. Past 5'000 the oldest
+    // go, level2 is busier than Binance's 100ms depth and needs the room.
+    std::vector<depth_event_t> pendingDepth;
+    held_price_t heldPrice; // only with conflation
+    bool snapshotInFlight = false;
+  };
+
   using resolver = ip::tcp::resolver;
   using results_type = resolver::results_type;
 
 public:
+  static constexpr size_t maxTopicsPerRequest = 100;
+  static constexpr size_t maxTopicsPerConnection = 300;
+  // levels per side of the public spot level2 snapshot
+  static constexpr size_t spotSnapshotDepth = 100;
+
+  // in dual-feed mode, two connections share `arbiter` and only the first
+  // copy of every ticker update reaches the price slots
   kucoin_ws(net::io_context &ioContext, ssl::context &sslContext,
-            double& result, trade_type_e const);
+            trade_type_e const, feed_arbiter_t *arbiter = nullptr,
+            int const feedIndex = 0);
   ~kucoin_ws();
-  void addSubscription(QString const &);
+  void addSubscription(QString const &, tick_slot_t &priceResult);
+  // keeps `book` in sync with the symbol's level2 topic
+  void addOrderBook(QString const &, order_book_t &book);
   void startFetching() { restApiInitiateConnection(); }
-  void requestStop() { m_requestedToStop = true; }
+  // runtime (un)subscription over an already running connection
+  void subscribe(QString const &tokenName, tick_slot_t &priceResult);
+  // the ticker topic goes once the symbol's last slot is unsubscribed
+  void unsubscribe(QString const &tokenName, tick_slot_t &priceResult);
+  // recovery for a topic gone silent on an open connection, no-ops while
+  // the connection is still being set up
+  void resubscribe(QString const &tokenName);
+  void forceReconnect();
+  // Stops reconnecting and pinging and sends a close frame. `onClosed` runs
+  // on the connection's strand once the exchange answered or the connection
+  // is gone, and not at all if the io_context stops first.
+  void close(std::function<void()> onClosed);
+  trade_type_e tradeType() const { return m_tradeType; }
+  int feedIndex() const { return m_feedIndex; } // 0 => primary
+  feed_latency_t const &latency() const { return m_latency; }
+  // raw frames are appended to `journal` when set, before `startFetching`
+  void setJournal(frame_journal_t *journal) { m_journal = journal; }
+  // before `startFetching`, see `held_price_t`
+  void setConflation(bool const enabled) { m_conflating = enabled; }
+  // prices replaced by a newer one before they were stored
+  std::uint64_t conflatedFrames() const {
+    return m_conflatedFrames.load(std::memory_order_relaxed);
+  }
+  // read by the manager while topics change on the connection's strand
+  bool canAddSubscription() const {
+    return m_topicCount.load(std::memory_order_relaxed) <
+           maxTopicsPerConnection;
+  }
 
 private:
   void restApiSendRequest();
   void restApiReceiveResponse();
   void restApiInitiateConnection();
-  void restApiConnectToResolvedNames(results_type const &);
+  void restApiConnectToResolvedNames(dns_cache_t::endpoints_t const &);
   void restApiPerformSSLHandshake();
   void restApiInterpretHttpResponse();
 
   void negotiateWebsocketConnection();
   void initiateWebsocketConnection();
   void websockPerformSSLHandshake();
-  void websockConnectToResolvedNames(results_type const &);
+  void websockConnectToResolvedNames(dns_cache_t::endpoints_t endpoints);
   void performWebsocketHandshake();
   void waitForMessages();
+  void scheduleReconnect();
   void interpretGenericMessages();
+  void interpretDepthMessage(char const *str, size_t const size);
+  void applyDepthEvent(topic_data_t &topic, depth_event_t &&event);
+  void requestDepthSnapshot(topic_data_t &topic);
+  void onDepthSnapshot(std::string const &tokenName, std::string const &body);
+  void resetOrderBooks();
   void makeSubscription();
   void startPingTimer();
   void resetPingTimer();
   void onPingTimerTick(boost::system::error_code const &);
+  void writeNextMessage();
+  void queueTopicRequest(char const *type, std::string const &tokenName);
+  bool loadCachedBulletToken();
+  void storeBulletToken();
+  void invalidateBulletToken();
+  topic_data_t *findTopic(std::string const &tokenName);
+  void storePrice(topic_data_t &topic, double const price,
+                  std::int64_t const eventTimeMs,
+                  std::int64_t const receiveTimeNs);
+  void storeHeldPrices();
+  void postHeldPriceFlush();
+
+  static std::mutex s_bulletTokenMutex;
+  static bullet_token_t s_bulletTokens[2]; // [spot, futures]
 
   net::io_context &m_ioContext;
   ssl::context &m_sslContext;
-  double& m_priceResult;
+  net::strand<net::io_context::executor_type> m_strand;
+  std::vector<topic_data_t> m_topics;
   std::optional<resolver> m_resolver;
-  std::optional<ws::stream<beast::ssl_stream<beast::tcp_stream>>>
+  // reused by every read, pending reads keep it alive past this socket
+  std::shared_ptr<handler_memory_t> m_handlerMemory =
+      std::make_shared<handler_memory_t>();
+  beast::flat_buffer m_readWriteBuffer;
+  std::optional<ws::stream<beast::ssl_stream<strand_tcp_stream_t>>>
       m_sslWebStream;
   std::optional<beast::http::response<beast::http::string_body>> m_response;
-  std::optional<beast::flat_buffer> m_readWriteBuffer;
   std::optional<net::deadline_timer> m_pingTimer;
+  std::optional<net::steady_timer> m_reconnectTimer;
+  reconnect_backoff_t m_backoff;
+  feed_latency_t m_latency;
+  frame_journal_t *m_journal = nullptr;
+  feed_arbiter_t *const m_arbiter;
   std::vector<instance_server_data_t> m_instanceServers;
   std::string m_websocketToken;
-  std::string m_subscriptionString;
-  QString m_tokenList;
+  std::deque<std::string> m_writeQueue;
+  std::string m_lastTokenName;
   korrelator::uri m_uri;
   trade_type_e const m_tradeType;
+  int const m_feedIndex;
   bool const m_isSpotTrade;
+  size_t m_orderBookCount = 0;
+  // tickers plus level2s, as requested by the manager
+  std::atomic<size_t> m_topicCount{0};
+  size_t m_heldPriceCount = 0;
+  int m_quietFlushPasses = 0; // see `held_price_t`
+  std::atomic<std::uint64_t> m_conflatedFrames{0};
   bool m_tokensSubscribedFor = false;
+  bool m_conflating = false;
+  bool m_framesWaiting = false; // more frames after the current one
+  bool m_heldPriceFlushPosted = false;
+  bool m_readSinceFlushPosted = false;
   bool m_requestedToStop = false;
 };
 
+double kuCoinGetCoinPrice(char const *str, size_t const size,
+                          bool const isSpot, std::string &tokenName,
+                          std::int64_t &eventTimeMs, std::int64_t &updateId);
+
 } // namespace korrelator
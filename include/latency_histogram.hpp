@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace korrelator {
+
+struct latency_summary_t {
+  std::uint64_t count = 0;
+  std::uint64_t p50 = 0;
+  std::uint64_t p99 = 0;
+  std::uint64_t p999 = 0;
+  std::uint64_t max = 0;
+  double mean = 0.0;
+};
+
+// HDR-style log-linear histogram: every power of two is split into 32
+// buckets, so any recorded value is reported within ~3% of itself. There is
+// a single writer; readers on other threads only see relaxed counters, which
+// is good enough for monitoring and never blocks the writer.
+class latency_histogram_t {
+public:
+  static constexpr int subBucketBits = 5;
+  static constexpr std::uint64_t subBucketCount = std::uint64_t(1)
+                                                  << subBucketBits;
+  // values above 2^41 - 1 are clamped, i.e. ~25 days in microseconds
+  static constexpr int maxMagnitude = 40;
+  static constexpr std::size_t bucketCount =
+      (maxMagnitude - subBucketBits + 2) * subBucketCount;
+
+  latency_histogram_t() = default;
+  latency_histogram_t(latency_histogram_t const &) = delete;
+  latency_histogram_t &operator=(latency_histogram_t const &) = delete;
+
+  // single writer only, hence plain load/store instead of read-modify-write
+  void record(std::uint64_t const value) {
+    auto &bucket = m_counts[bucketIndex(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+    m_count.store(m_count.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+    m_sum.store(m_sum.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+    if (value > m_max.load(std::memory_order_relaxed))
+      m_max.store(value, std::memory_order_relaxed);
+  }
+
+  latency_summary_t summary() const;
+
+  static std::size_t bucketIndex(std::uint64_t value) {
+    if (value < subBucketCount)
+      return static_cast<std::size_t>(value);
+    auto magnitude = mostSignificantBit(value);
+    if (magnitude > maxMagnitude) {
+      magnitude = maxMagnitude;
+      value = (std::uint64_t(1) << (maxMagnitude + 1)) - 1;
+    }
+    auto const shift = magnitude - subBucketBits;
+    return static_cast<std::size_t>((shift + 1) * subBucketCount +
+                                    (value >> shift) - subBucketCount);
+  }
+  // largest value that lands in bucket `index`
+  static std::uint64_t bucketUpperBound(std::size_t const index);
+
+private:
+  static int mostSignificantBit(std::uint64_t const value) {
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+  }
+
+  std::array<std::atomic<std::uint64_t>, bucketCount> m_counts{};
+  std::atomic<std::uint64_t> m_count{0};
+  std::atomic<std::uint64_t> m_sum{0};
+  std::atomic<std::uint64_t> m_max{0};
+};
+
+// Staleness of one websocket connection, in microseconds: how old each tick
+// is by the time it's read (receive time on the exchange's clock minus the
+// event time) and the gap between consecutive frames. Written by the
+// connection's io thread only.
+class feed_latency_t {
+public:
+  void onFrame(std::int64_t const receiveTimeNs) {
+    if (m_lastReceiveTimeNs != 0 && receiveTimeNs >= m_lastReceiveTimeNs)
+      m_gaps.record(static_cast<std::uint64_t>(
+          (receiveTimeNs - m_lastReceiveTimeNs) / 1'000));
+    m_lastReceiveTimeNs = receiveTimeNs;
+  }
+
+  // `receiveTimeUs` is the exchange-clock time the frame was read at
+  void onTick(std::int64_t const eventTimeMs,
+              std::int64_t const receiveTimeUs) {
+    if (eventTimeMs == 0)
+      return;
+    auto const latencyUs = receiveTimeUs - eventTimeMs * 1'000;
+    if (latencyUs < 0) {
+      // the exchange's clock is ahead of ours
+      m_aheadOfLocalClock.store(
+          m_aheadOfLocalClock.load(std::memory_order_relaxed) + 1,
+          std::memory_order_relaxed);
+      return m_latency.record(0);
+    }
+    m_latency.record(static_cast<std::uint64_t>(latencyUs));
+  }
+
+  latency_histogram_t const &latency() const { return m_latency; }
+  latency_histogram_t const &gaps() const { return m_gaps; }
+  std::uint64_t aheadOfLocalClock() const {
+    return m_aheadOfLocalClock.load(std::memory_order_relaxed);
+  }
+
+private:
+  latency_histogram_t m_latency;
+  latency_histogram_t m_gaps;
+  std::atomic<std::uint64_t> m_aheadOfLocalClock{0};
+  std::int64_t m_lastReceiveTimeNs = 0;
+};
+
+} // namespace korrelator
@@ -6,10 +6,12 @@
 #include <QNetworkAccessManager>
 #include <QTimer>
 #include <QElapsedTimer>
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <filesystem>
 
+#include "correlator_engine.hpp"
 #include "order_model.hpp"
 #include "settingsdialog.hpp"
 #include "sthread.hpp"
@@ -17,8 +19,6 @@
 #include "container.hpp"
 #include "plug_data.hpp"
 
-#define CMAX_DOUBLE_VALUE std::numeric_limits<double>::max()
-
 QT_BEGIN_NAMESPACE
 namespace Ui {
 class MainDialog;
@@ -31,6 +31,9 @@ class QCustomPlot;
 
 namespace korrelator {
 
+class clock_sync_t;
+class feed_watchdog_t;
+class replay_driver_t;
 class websocket_manager;
 
 struct graph_updater_t {
@@ -43,11 +46,11 @@ struct price_updater_t {
   cthread_ptr thread = nullptr;
 };
 
-struct ref_calculation_data_t {
-  bool isResettingRef = false;
-  bool eachTickNormalize = false;
-  double minValue = CMAX_DOUBLE_VALUE;
-  double maxValue = - (CMAX_DOUBLE_VALUE);
+struct signal_evaluator_t {
+  worker_ptr worker = nullptr;
+  cthread_ptr thread = nullptr;
+  std::shared_ptr<tick_notifier_t> notifier = nullptr;
+  std::atomic_bool stopRequested{false};
 };
 
 struct watchable_data_t {
@@ -72,27 +75,13 @@ struct symbol_fetcher_t {
   ~symbol_fetcher_t();
 };
 
-struct rot_metadata_t {
-  double restartOnTickEntry = 0.0;
-  double percentageEntry = 0.0;
-  double specialEntry = 0.0;
-
-  double afterDivisionPercentageEntry = 0.0;
-  double afterDivisionSpecialEntry = 0.0;
-};
-
-struct rot_t {
-  std::optional<rot_metadata_t> normalLines;
-  std::optional<rot_metadata_t> refLines;
-  std::optional<rot_metadata_t> special;
-};
-
 } // namespace korrelator
 
 using korrelator::exchange_name_e;
 using korrelator::trade_type_e;
 
-class MainDialog final: public QDialog {
+class MainDialog final: public QDialog,
+                        private korrelator::correlator_observer_t {
   Q_OBJECT
 
   using callback_t =
@@ -132,10 +121,9 @@ private:
   void newItemAdded(QString const &token, trade_type_e const,
                     exchange_name_e const);
   void tokenRemoved(QString const &text);
-  void onNormalizedGraphTimerTick(bool const minMaxNeedsUpdate);
-  void onPriceDeltaGraphTimerTick(bool const minMaxNeedsUpdate);
   void takeBackToFactoryReset();
   void onOKButtonClicked();
+  void onReplayButtonClicked();
   void onStartVerificationSuccessful();
   void stopGraphPlotting(bool const requestConfirmation);
   void saveAppConfigToFile();
@@ -149,9 +137,15 @@ private:
   void resetGraphComponents();
   void setupNormalizedGraphData();
   void setupPriceDeltaGraphData();
-  void resetTickerData(bool const resetRefs, bool const resetSymbols);
+  // the feeds start with Start, the signal engine once the REST snapshot
+  // has seeded the normalization
   void startWebsocket();
+  void startSignalEngine();
+  void startReplay();
+  void forEachPriceSubscription(
+      std::function<void(korrelator::token_t &)> const &subscribe);
   void priceLaunchImpl();
+  bool ordersHeldByStaleFeed() const;
   void getInitialTokenPrices();
   void populateUIComponents();
   void connectAllUISignals();
@@ -162,7 +156,7 @@ private:
   int  getTimerTickMilliseconds() const;
   std::optional<double> getIntegralValue(QLineEdit *lineEdit);
   double getMaxPlotsInVisibleRegion() const;
-  void updateGraphData(double const key, bool const);
+  void onGraphClockTick(double const key);
   void setupOrderTableModel();
   void calculateAveragePriceDifference();
   void updateTradeConfigurationPrecisions();
@@ -171,18 +165,32 @@ private:
                           exchange_name_e const,
                           trade_type_e const,
                           korrelator::order_origin_e const origin);
-  void calculatePriceNormalization();
+  // while running: a ref joins after a warm-up, the other symbols untouched
+  void addRefWhileRunning(QString const &tokenName, trade_type_e const tt,
+                          exchange_name_e const exchange);
+  bool removeRefWhileRunning(QString const &widgetText);
+  void watchPricesWhileRunning(std::function<void()> request);
+  void attachSignalNotifier();
+  void startSignalEvaluator();
+  void stopSignalEvaluator();
+  void detachSignalNotifier();
+  void evaluateSignalsOnTick();
+  void evaluatePendingSignals();
+  // correlator_observer_t, from the graph or the evaluator thread
+  QString signalTime() const override;
+  void onCrossOverSignal(korrelator::token_t const &symbol,
+                         korrelator::cross_over_data_t crossOver) override;
+  void onPriceDeltaSignal(
+      korrelator::trade_action_e const futuresAction) override;
+  void onNormalizedPoint(double const key, korrelator::token_t const &ref,
+                         korrelator::token_t const &symbol,
+                         bool const updatingMinMax) override;
+  void onPriceDeltaPoint(double const key, double const delta,
+                         bool const updatingMinMax) override;
   Qt::Alignment getLegendAlignment() const;
   list_iterator find(korrelator::token_list_t &container, QString const &,
                      trade_type_e const, exchange_name_e const);
   list_iterator find(korrelator::token_list_t &container, QString const &);
-  korrelator::trade_action_e lineCrossedOver(double const prevRef,
-                                             double const currRef,
-                                             double const prevValue,
-                                             double const currValue);
-  korrelator::ref_calculation_data_t updateRefGraph(double const keyStart,
-                                                    double const keyEnd,
-                                                    bool const updateGraph);
 
   void sendExchangeRequest(korrelator::model_data_t &,
                            exchange_name_e const, trade_type_e const tradeType,
@@ -204,6 +212,7 @@ private:
   void makePriceAverageOrder(korrelator::trade_action_e const tradeAction,
                              korrelator::trade_type_e const tradeType);
   void onExportButtonClicked();
+  void onFeedLatencyButtonClicked();
   void OnTradeAverageRadioToggled(bool const);
   void OnTradeBothAverageNormalToggled(bool const);
   void OnTradeNormalizedPriceToggled(bool const);
@@ -240,14 +249,31 @@ private:
   QTimer *m_averagePriceDifferenceTimer = nullptr;
   QNetworkAccessManager m_networkManager;
   std::unique_ptr<korrelator::websocket_manager> m_websocket;
+  // exchange clock offsets, used to sign requests and to measure feed lag
+  std::unique_ptr<korrelator::clock_sync_t> m_clockSync;
+  // notices live symbols whose price stopped moving, see `m_staleFeedGate`
+  std::shared_ptr<korrelator::feed_watchdog_t> m_feedWatchdog;
+  // set while a capture is replayed instead of the live feeds
+  std::unique_ptr<korrelator::replay_driver_t> m_replay;
+  double m_replaySpeed = 1.0; // 0 => as fast as possible
   std::unique_ptr<korrelator::order_model> m_model = nullptr;
   QMap<int, korrelator::watchable_data_t> m_watchables;
   SettingsDialog::api_data_map_t m_apiTradeApiMap;
-  korrelator::token_list_t m_tokens;
-  korrelator::token_list_t m_refs;
-  korrelator::token_list_t m_priceDeltas;
+  korrelator::correlator_engine_t m_engine;
+  // the engine's, under `m_signalMutex` while running
+  korrelator::token_list_t &m_tokens;
+  korrelator::token_list_t &m_refs;
+  korrelator::token_list_t &m_priceDeltas;
+  korrelator::correlator_settings_t &m_settings;
   korrelator::graph_updater_t m_graphUpdater;
   korrelator::price_updater_t m_priceUpdater;
+  korrelator::signal_evaluator_t m_signalEvaluator;
+  std::mutex m_signalMutex; // tokens' signal state, when event-driven
+  std::int64_t m_startRequestedNs = 0; // when Start was pressed
+  // REST price snapshots still in flight; a Stop bumps the generation so
+  // the answers of an earlier run are dropped
+  std::size_t m_pendingSnapshotRequests = 0;
+  std::uint64_t m_snapshotGeneration = 0;
   korrelator::symbol_fetcher_t m_symbolUpdater;
   std::unique_ptr<QCPLayoutGrid> m_legendLayout;
   korrelator::waitable_container_t<korrelator::plug_data_t> m_tokenPlugs;
@@ -255,32 +281,37 @@ private:
   QTimer m_timerPlot;
   QTimer m_maxVisibleTimeTimer;
   QElapsedTimer m_elapsedTime;
-  korrelator::rot_t m_restartTickValues;
   std::filesystem::path const m_configDirectory;
   std::optional<normalized_order_data_t> m_normalizationOrderData = std::nullopt;
   std::optional<average_order_data_t> m_priceAverageOrderData = std::nullopt;
+  // slots of refs removed while running, the feed may still write to them
+  std::vector<std::shared_ptr<korrelator::tick_slot_t>> m_retiredPriceSlots;
   double m_lastGraphPoint = 0.0;
-  double m_threshold = 0.0;
   double m_maxVisiblePlot = 100.0;
   double m_lastKeyUsed = 0.0;
-  double m_lastPriceAverage = 0.0;
-  double m_maxAverageThreshold = 0.0;
-  double m_averageUp = 0.0;
-  double m_averageDown = 0.0;
 
   int m_maxOrderRetries = 10;
   int m_expectedTradeCount = 1; // max 2
   korrelator::order_origin_e m_orderOrigin = korrelator::order_origin_e::from_none;
 
-  bool m_doingAutoLDClosure = false; // automatic "line distance" (LD) closure
-  bool m_doingManualLDClosure = false; // manualInterval LD closure
   bool m_programIsRunning = false;
   bool m_firstRun = true;
-  bool m_findingUmbral = false; // umbral is spanish word for threshold
-  bool m_hasReferences = false;
   bool m_tradeOpened = false;
   bool m_calculatingNormalPrice = true;
   bool m_calculatingPriceAverage = false;
+  bool m_orderBookDepth = false; // keep a local order book per symbol
+  std::size_t m_ioThreadCount = 1; // websocket threads, one io_context each
+  std::vector<int> m_ioThreadAffinity; // CPU per websocket thread, -1 => any
+  bool m_dualFeed = false; // redundant connection per price stream
+  bool m_conflateFrames = false; // newest price per symbol of a burst only
+  bool m_verifyCertificates = false; // of every exchange connection
+  int m_refWarmUpSeconds = 30; // before a ref added while running counts
+  bool m_staleFeedGate = true; // no new orders while any feed is silent
+  int m_staleFeedSeconds = 5;  // shortest silence counted as stale
+  bool m_frameCapture = false; // journal raw websocket frames to disk
+  std::size_t m_frameCaptureSegmentMB = 64;
+  // "priceSource" of the saved tokens, keyed like the token list widgets
+  std::map<QString, korrelator::price_source_e> m_priceSources;
   bool& m_warnOnExit;
 };
 
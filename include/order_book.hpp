@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace korrelator {
+
+enum class book_side_e { bid, ask };
+
+struct price_level_t {
+  double price = 0.0;
+  double quantity = 0.0;
+};
+
+struct level_update_t {
+  book_side_e side = book_side_e::bid;
+  double price = 0.0;
+  double quantity = 0.0; // 0 removes the level
+};
+
+// Local copy of one symbol's order book, rebuilt from a REST snapshot and
+// kept current by the exchange's incremental depth stream. Each side is a
+// flat array sorted best-first, so the top of book is always element 0 and a
+// VWAP walk touches contiguous memory only. Written by the websocket strand,
+// read by the graph/trading threads.
+class order_book_t {
+public:
+  order_book_t() = default;
+  order_book_t(order_book_t const &) = delete;
+  order_book_t &operator=(order_book_t const &) = delete;
+
+  // replaces both sides, `sequence` is the snapshot's last update id.
+  // A snapshot of only the top `depthLimit` levels (0 => the whole book)
+  // says nothing of the levels below, so each side is trimmed to that depth
+  // after every update. Its deepest levels may still miss some the snapshot
+  // didn't cover once the top of book moves away from them.
+  void applySnapshot(std::vector<price_level_t> bids,
+                     std::vector<price_level_t> asks,
+                     std::int64_t const sequence,
+                     std::size_t const depthLimit = 0);
+  // applies the changes of one depth event and records its last update id
+  void applyUpdates(std::vector<level_update_t> const &updates,
+                    std::int64_t const sequence);
+  // drops the book until the next snapshot, e.g. after a sequence gap
+  void invalidate();
+
+  bool isSynced() const;
+  std::int64_t sequence() const;
+  std::uint64_t resyncCount() const;
+
+  // 0.0 while the book is not synced or the side is empty
+  double bestBid() const;
+  double bestAsk() const;
+  double mid() const;
+  // average price paid (ask side) or received (bid side) when taking
+  // `quantity` off the book, 0.0 if the book isn't deep enough
+  double vwap(book_side_e const side, double const quantity) const;
+  std::vector<price_level_t> topLevels(book_side_e const side,
+                                       std::size_t const count) const;
+
+private:
+  static void applyLevel(std::vector<price_level_t> &levels,
+                         bool const descending, double const price,
+                         double const quantity);
+
+  mutable std::mutex m_mutex;
+  std::vector<price_level_t> m_bids; // descending by price
+  std::vector<price_level_t> m_asks; // ascending by price
+  std::int64_t m_sequence = 0;
+  std::uint64_t m_resyncCount = 0;
+  std::size_t m_depthLimit = 0;
+  bool m_synced = false;
+};
+
+} // namespace korrelator
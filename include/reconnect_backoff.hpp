@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace korrelator {
+
+// Exponential reconnect delay with "equal jitter": half of the current step
+// is fixed and the other half random, so a burst of dropped connections
+// doesn't reconnect in lockstep.
+class reconnect_backoff_t {
+public:
+  reconnect_backoff_t(
+      std::chrono::milliseconds const initialDelay =
+          std::chrono::milliseconds(250),
+      std::chrono::milliseconds const maxDelay = std::chrono::seconds(30))
+      : m_initialDelay(initialDelay), m_maxDelay(maxDelay),
+        m_randomEngine(std::random_device{}()) {}
+
+  std::chrono::milliseconds nextDelay() {
+    auto const step = std::min<std::chrono::milliseconds::rep>(
+        m_maxDelay.count(), m_initialDelay.count() << std::min(m_attempt, 16));
+    ++m_attempt;
+    std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter(
+        0, step / 2);
+    return std::chrono::milliseconds(step - step / 2 + jitter(m_randomEngine));
+  }
+
+  // after a connection made it all the way to receiving data
+  void reset() { m_attempt = 0; }
+  int attempt() const { return m_attempt; }
+
+private:
+  std::chrono::milliseconds const m_initialDelay;
+  std::chrono::milliseconds const m_maxDelay;
+  std::minstd_rand m_randomEngine;
+  int m_attempt = 0;
+};
+
+} // namespace korrelator
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace korrelator {
+
+// Wakes the signal evaluator whenever any subscribed symbol ticks. The
+// websocket threads only take the mutex when the evaluator is asleep.
+class tick_notifier_t {
+public:
+  void notify() {
+    m_generation.fetch_add(1, std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_seq_cst)) {
+      std::lock_guard<std::mutex> lock_g(m_mutex);
+      m_cv.notify_one();
+    }
+  }
+
+  // returns the current generation once it differs from `lastSeen`, on
+  // timeout or after `stop`, whichever comes first
+  std::uint64_t wait(std::uint64_t const lastSeen,
+                     std::chrono::milliseconds const timeout) {
+    auto generation = m_generation.load(std::memory_order_acquire);
+    if (generation != lastSeen)
+      return generation;
+
+    std::unique_lock<std::mutex> u_lock(m_mutex);
+    m_sleeping.store(true, std::memory_order_seq_cst);
+    m_cv.wait_for(u_lock, timeout, [&] {
+      return m_stopped ||
+             m_generation.load(std::memory_order_seq_cst) != lastSeen;
+    });
+    m_sleeping.store(false, std::memory_order_relaxed);
+    return m_generation.load(std::memory_order_acquire);
+  }
+
+  void stop() {
+    std::lock_guard<std::mutex> lock_g(m_mutex);
+    m_stopped = true;
+    m_cv.notify_all();
+  }
+
+  bool stopped() const {
+    std::lock_guard<std::mutex> lock_g(m_mutex);
+    return m_stopped;
+  }
+
+private:
+  std::atomic<std::uint64_t> m_generation{0};
+  std::atomic<bool> m_sleeping{false};
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_stopped = false;
+};
+
+} // namespace korrelator
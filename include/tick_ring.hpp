@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace korrelator {
+
+inline std::int64_t steadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct tick_t {
+  double price = 0.0;
+  std::int64_t eventTimeMs = 0;   // exchange time, 0 when not sent
+  std::int64_t receiveTimeNs = 0; // steadyNowNs() when the frame was read
+  std::uint64_t sequence = 0;     // number of writes so far, 0 => never set
+};
+
+enum class ring_overflow_policy_e {
+  drop_oldest, // a full ring overwrites its oldest unread tick
+  conflate     // a full ring replaces its newest unread tick
+};
+
+// Bounded single-producer/single-consumer queue of every tick of a symbol.
+// The producer (websocket thread) never waits; the consumer (graph thread)
+// drains it in batches and counts whatever the producer had to drop.
+class tick_ring_t {
+  struct alignas(64) slot_t {
+    std::atomic<std::uint64_t> version{0}; // odd while being written
+    std::atomic<std::uint64_t> index{0};   // position stored in this slot
+    std::atomic<double> price{0.0};
+    std::atomic<std::int64_t> eventTimeMs{0};
+    std::atomic<std::int64_t> receiveTimeNs{0};
+    std::atomic<std::uint64_t> sequence{0};
+  };
+
+public:
+  static constexpr std::size_t defaultCapacity = 1024;
+
+  tick_ring_t(std::size_t const capacity, ring_overflow_policy_e const policy)
+      : m_capacity(roundUpToPowerOfTwo(capacity)), m_mask(m_capacity - 1),
+        m_policy(policy), m_slots(new slot_t[m_capacity]) {}
+  tick_ring_t(tick_ring_t const &) = delete;
+  tick_ring_t &operator=(tick_ring_t const &) = delete;
+
+  std::size_t capacity() const { return m_capacity; }
+  ring_overflow_policy_e policy() const { return m_policy; }
+  std::uint64_t dropCount() const {
+    return m_dropCount.load(std::memory_order_relaxed);
+  }
+
+  // producer only
+  void push(tick_t const &tick) {
+    auto const tail = m_tail.load(std::memory_order_relaxed);
+    if (m_policy == ring_overflow_policy_e::conflate && tail != 0 &&
+        tail - m_head.load(std::memory_order_acquire) >= m_capacity) {
+      writeSlot(tail - 1, tick);
+      m_dropCount.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    writeSlot(tail, tick);
+    m_tail.store(tail + 1, std::memory_order_release);
+  }
+
+  // consumer only, calls `func(tick_t const &)` for at most `maxCount` ticks
+  // in the order they were pushed. Returns the number of ticks delivered.
+  template <typename Func>
+  std::size_t drain(Func &&func, std::size_t const maxCount = SIZE_MAX) {
+    auto head = m_head.load(std::memory_order_relaxed);
+    auto tail = m_tail.load(std::memory_order_acquire);
+    std::size_t count = 0;
+    tick_t tick;
+    while (head != tail && count < maxCount) {
+      if (tail - head > m_capacity) { // lapped by the producer
+        m_dropCount.fetch_add(tail - head - m_capacity,
+                              std::memory_order_relaxed);
+        head = tail - m_capacity;
+      }
+      if (readSlot(head, tick)) {
+        func(tick);
+        ++head;
+        ++count;
+      } else {
+        tail = m_tail.load(std::memory_order_acquire);
+      }
+    }
+    m_head.store(head, std::memory_order_release);
+    return count;
+  }
+
+private:
+  static std::size_t roundUpToPowerOfTwo(std::size_t const value) {
+    std::size_t result = 2;
+    while (result < value)
+      result <<= 1;
+    return result;
+  }
+
+  void writeSlot(std::uint64_t const index, tick_t const &tick) {
+    auto &slot = m_slots[index & m_mask];
+    auto const version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.index.store(index, std::memory_order_relaxed);
+    slot.price.store(tick.price, std::memory_order_relaxed);
+    slot.eventTimeMs.store(tick.eventTimeMs, std::memory_order_relaxed);
+    slot.receiveTimeNs.store(tick.receiveTimeNs, std::memory_order_relaxed);
+    slot.sequence.store(tick.sequence, std::memory_order_relaxed);
+    slot.version.store(version + 2, std::memory_order_release);
+  }
+
+  // false when the slot no longer holds `index`, i.e. it was overwritten
+  bool readSlot(std::uint64_t const index, tick_t &tick) const {
+    auto const &slot = m_slots[index & m_mask];
+    std::uint64_t before = 0, after = 0, storedIndex = 0;
+    do {
+      before = slot.version.load(std::memory_order_acquire);
+      storedIndex = slot.index.load(std::memory_order_relaxed);
+      tick.price = slot.price.load(std::memory_order_relaxed);
+      tick.eventTimeMs = slot.eventTimeMs.load(std::memory_order_relaxed);
+      tick.receiveTimeNs = slot.receiveTimeNs.load(std::memory_order_relaxed);
+      tick.sequence = slot.sequence.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = slot.version.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return storedIndex == index;
+  }
+
+  std::size_t const m_capacity;
+  std::size_t const m_mask;
+  ring_overflow_policy_e const m_policy;
+  std::unique_ptr<slot_t[]> m_slots;
+  alignas(64) std::atomic<std::uint64_t> m_tail{0};
+  alignas(64) std::atomic<std::uint64_t> m_head{0};
+  std::atomic<std::uint64_t> m_dropCount{0};
+};
+
+} // namespace korrelator
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "tick_notifier.hpp"
+#include "tick_ring.hpp"
+
+namespace korrelator {
+
+// Latest price of one symbol, written by its websocket and read by the
+// graph/signal code. Writes use a seqlock, so a reader never sees a torn
+// tick and only retries while a write is in flight. Each slot has its own
+// cache line so neighbouring symbols don't invalidate each other.
+class alignas(64) tick_slot_t {
+public:
+  tick_slot_t() = default;
+  tick_slot_t(tick_slot_t const &) = delete;
+  tick_slot_t &operator=(tick_slot_t const &) = delete;
+
+  // single writer only
+  void store(double const price, std::int64_t const eventTimeMs = 0,
+             std::int64_t const receiveTimeNs = steadyNowNs()) {
+    auto const version = m_version.load(std::memory_order_relaxed);
+    m_version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_price.store(price, std::memory_order_relaxed);
+    m_eventTimeMs.store(eventTimeMs, std::memory_order_relaxed);
+    m_receiveTimeNs.store(receiveTimeNs, std::memory_order_relaxed);
+    m_version.store(version + 2, std::memory_order_release);
+    if (m_ring)
+      m_ring->push({price, eventTimeMs, receiveTimeNs, version / 2 + 1});
+    if (m_notifier)
+      m_notifier->notify();
+  }
+
+  // zeroes the slot without queueing a tick, only while the writer is idle
+  void clear() {
+    auto ring = std::move(m_ring);
+    auto notifier = std::move(m_notifier);
+    store(0.0, 0, 0);
+    m_ring = std::move(ring);
+    m_notifier = std::move(notifier);
+  }
+
+  tick_t load() const {
+    tick_t tick;
+    std::uint64_t before = 0, after = 0;
+    do {
+      before = m_version.load(std::memory_order_acquire);
+      tick.price = m_price.load(std::memory_order_relaxed);
+      tick.eventTimeMs = m_eventTimeMs.load(std::memory_order_relaxed);
+      tick.receiveTimeNs = m_receiveTimeNs.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = m_version.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    tick.sequence = before / 2;
+    return tick;
+  }
+
+  double price() const { return load().price; }
+  std::uint64_t sequence() const {
+    return m_version.load(std::memory_order_acquire) / 2;
+  }
+
+  // every stored tick is also queued here; set it before the writer starts
+  void setRing(std::unique_ptr<tick_ring_t> ring) { m_ring = std::move(ring); }
+  tick_ring_t *ring() const { return m_ring.get(); }
+  // woken on every store; set it before the writer starts, clear it after
+  // the writer is gone
+  void setNotifier(std::shared_ptr<tick_notifier_t> notifier) {
+    m_notifier = std::move(notifier);
+  }
+
+private:
+  std::atomic<std::uint64_t> m_version{0}; // odd while a write is in progress
+  std::atomic<double> m_price{0.0};
+  std::atomic<std::int64_t> m_eventTimeMs{0};
+  std::atomic<std::int64_t> m_receiveTimeNs{0};
+  std::unique_ptr<tick_ring_t> m_ring;
+  std::shared_ptr<tick_notifier_t> m_notifier;
+};
+
+} // namespace korrelator
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "latency_histogram.hpp"
+
+typedef struct ssl_st SSL;
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_session_st SSL_SESSION;
+
+namespace korrelator {
+
+struct tls_handshake_report_t {
+  std::uint64_t full = 0;
+  std::uint64_t resumed = 0;
+  latency_summary_t fullUs;
+  latency_summary_t resumedUs;
+};
+
+// Client-side TLS sessions, keyed by the SNI host name, so a reconnect or a
+// new order connection resumes the previous session (ticket or ID) instead of
+// doing a full handshake. Works with any connection using a context passed
+// to `enable`, on any thread.
+//
+//   auto const started = tls_session_cache_t::instance().beforeHandshake(ssl);
+//   ... async_handshake ...
+//   tls_session_cache_t::instance().afterHandshake(ssl, started);
+class tls_session_cache_t {
+public:
+  using time_point_t = std::chrono::steady_clock::time_point;
+
+  static tls_session_cache_t &instance();
+  tls_session_cache_t(tls_session_cache_t const &) = delete;
+  tls_session_cache_t &operator=(tls_session_cache_t const &) = delete;
+
+  void enable(SSL_CTX *context);
+  // Verify the server's certificate and host name on every connection from
+  // now on. Sessions made before are dropped, since they were never verified.
+  void setPeerVerification(bool const verify);
+
+  // after the SNI host name is set, returns when the handshake started
+  time_point_t beforeHandshake(SSL *ssl);
+  // on a successful handshake only
+  void afterHandshake(SSL *ssl, time_point_t const started);
+  tls_handshake_report_t report() const;
+
+private:
+  tls_session_cache_t() = default;
+  static int onNewSession(SSL *ssl, SSL_SESSION *session);
+
+  mutable std::mutex m_mutex;
+  std::map<std::string, std::shared_ptr<SSL_SESSION>> m_sessions;
+  // written under `m_mutex`, handshakes come from several threads
+  latency_histogram_t m_fullHandshakes;
+  latency_histogram_t m_resumedHandshakes;
+  std::atomic_bool m_verifyPeer{false};
+};
+
+} // namespace korrelator
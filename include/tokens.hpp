@@ -1,5 +1,7 @@
 #pragma once
 
+#include "order_book.hpp"
+#include "tick_slot.hpp"
 #include "utils.hpp"
 #include <QString>
 #include <map>
@@ -41,17 +43,23 @@ public:
   double baseMinSize = 0.0; // The minimum quantity requried to place an order
   double quoteMinSize = 0.0; // The minimum funds required to place a market order
   qint64 graphPointsDrawnCount = 0;
-  std::shared_ptr<double> realPrice;
+  // a ref added while running joins the ref average once its first price
+  // is in and `steadyNowNs()` reaches this
+  std::int64_t warmUpEndNs = 0;
+  std::shared_ptr<tick_slot_t> realPrice;
+  std::shared_ptr<order_book_t> orderBook; // only with "orderBookDepth"
   QCPGraph *graph = nullptr;
 
   std::optional<cross_over_data_t> crossOver;
   trade_type_e tradeType;
   exchange_name_e exchange = exchange_name_e::none;
+  price_source_e priceSource = price_source_e::last_trade;
 
   QString baseCurrency;
   QString quoteCurrency;
   QString symbolName;
   QString legendName;
+  // detaches `graph` without clearing its points, the plot owns those
   void reset();
 };
 
@@ -11,12 +11,14 @@ public:
 
   std::string path() const;
   std::string host() const;
+  std::string port() const; // empty unless the url names one
   std::string target() const;
   std::string protocol() const;
 
 private:
   void parse(std::string const &);
   std::string m_host;
+  std::string m_port;
   std::string m_path;
   std::string m_protocol;
   std::string m_query;
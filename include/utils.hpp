@@ -9,6 +9,8 @@ enum class trade_type_e { spot, futures, unknown };
 enum class exchange_name_e { binance, kucoin, none };
 enum class trade_action_e { buy, sell, nothing };
 enum class market_type_e { market, limit, unknown };
+// what a symbol's price line follows, only Binance offers a choice
+enum class price_source_e { last_trade, book_ticker_mid, micro_price };
 enum tick_line_type_e { normal, ref, all, special };
 
 struct api_data_t {
@@ -59,6 +61,8 @@ QString exchangeNameToString(korrelator::exchange_name_e const ex);
 exchange_name_e stringToExchangeName(QString const &name);
 market_type_e stringToMarketType(QString const &marketName);
 QString marketTypeToString(market_type_e const);
+price_source_e stringToPriceSource(QString const &name);
+QString priceSourceToString(price_source_e const);
 char get_random_char();
 std::string get_random_string(std::size_t);
 std::size_t get_random_integer();
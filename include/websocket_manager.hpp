@@ -1,10 +1,15 @@
 #pragma once
 
 #include <QString>
+#include <filesystem>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <variant>
 #include <vector>
 
+#include "latency_histogram.hpp"
+
 namespace boost {
 
 namespace asio {
@@ -15,8 +20,6 @@ class context;
 
 } // ssl
 
-class io_context;
-
 } // namespace asio
 
 } // namespace boost
@@ -26,13 +29,35 @@ namespace korrelator {
 namespace net = boost::asio;
 
 class binance_ws;
+class feed_arbiter_t;
+class feed_watchdog_t;
+class frame_capture_t;
+class io_context_pool_t;
 class kucoin_ws;
+class order_book_t;
+class tick_slot_t;
 
 enum class trade_type_e;
 enum class exchange_name_e;
+enum class price_source_e;
 
 net::ssl::context &getSSLContext();
 
+struct feed_statistics_t {
+  QString name;
+  std::uint64_t wins[2] = {0, 0}; // updates delivered first, [primary, standby]
+  std::uint64_t duplicates[2] = {0, 0}; // updates that arrived second
+};
+
+// all durations in microseconds
+struct feed_latency_report_t {
+  QString name;
+  latency_summary_t latency; // exchange event time -> local receive time
+  latency_summary_t gaps;    // between consecutive frames
+  std::uint64_t aheadOfLocalClock = 0; // ticks stamped in our future
+  std::uint64_t conflatedFrames = 0;   // prices superseded before stored
+};
+
 class websocket_manager {
 
   struct exchange_trade_pair {
@@ -41,17 +66,104 @@ class websocket_manager {
   };
 
   using socket_variant = std::variant<binance_ws*, kucoin_ws*>;
+
+  // a primary connection and its hot standby, both on one io_context
+  struct feed_pair_t {
+    socket_variant primary;
+    socket_variant standby;
+    std::unique_ptr<feed_arbiter_t> arbiter;
+  };
+
+  // the connections feeding one price slot, both twins in dual-feed mode
+  struct price_subscription_t {
+    QString tokenName;
+    QString connectionName;
+    tick_slot_t *slot = nullptr;
+    std::vector<socket_variant> sockets; // empty once unsubscribed
+  };
+
+  struct watchdog_runner_t;
+
 public:
-  websocket_manager();
+  // `ioThreadCount` threads run the connections, optionally pinned to the
+  // CPUs listed in `cpuAffinity`. With `dualFeed`, every price connection
+  // gets a redundant twin and the first copy of each update wins.
+  explicit websocket_manager(std::size_t const ioThreadCount = 1,
+                             std::vector<int> cpuAffinity = {},
+                             bool const dualFeed = false);
   ~websocket_manager();
   void addSubscription(QString const &tokenName, trade_type_e const tradeType,
-                       exchange_name_e const exchange, double& result);
+                       exchange_name_e const exchange, tick_slot_t &result,
+                       price_source_e const priceSource);
+  // depth stream plus REST snapshot, kept in sync until the manager goes away
+  void addOrderBook(QString const &tokenName, trade_type_e const tradeType,
+                    exchange_name_e const exchange, order_book_t &book);
+  // before `startWatch` only: every connection's raw frames are journaled
+  // under a new session directory in `rootDirectory`
+  void enableFrameCapture(std::filesystem::path rootDirectory,
+                          std::size_t const segmentSize);
+  // before `startWatch` only: every price subscription is registered with
+  // `watchdog`, which is checked every second from an io thread. A silent
+  // symbol is resubscribed, then only its own connection is reconnected.
+  void setFeedWatchdog(std::shared_ptr<feed_watchdog_t> watchdog);
+  // before the first subscription: within a burst of frames, every
+  // connection stores only the newest price per symbol. For when CPU matters
+  // more than every trade reaching the price slots.
+  void setConflation(bool const enabled) { m_conflateFrames = enabled; }
   void startWatch();
+  // After `startWatch`, from one thread at a time: the symbol joins its
+  // market's live connection, or a new one if there is none or it's full,
+  // without touching the other symbols. New connections are journaled too
+  // when frame capture is on.
+  void subscribe(QString const &tokenName, trade_type_e const tradeType,
+                 exchange_name_e const exchange, tick_slot_t &result,
+                 price_source_e const priceSource);
+  // only `result` leaves, other slots of the same symbol keep their ticks
+  void unsubscribe(QString const &tokenName, trade_type_e const tradeType,
+                   exchange_name_e const exchange, tick_slot_t &result);
+  // Closes every connection with a close frame, giving the exchanges
+  // `closeTimeout` to answer, then joins the io threads. A new manager can
+  // be started right after; the destructor calls it too.
+  void stop();
+  std::vector<feed_statistics_t> feedStatistics() const;
+  // one entry per connection, safe to call while the feeds are running
+  std::vector<feed_latency_report_t> latencyReports() const;
 
 private:
+  binance_ws *getBinanceSocket(trade_type_e const tradeType);
+  kucoin_ws *getKuCoinSocket(trade_type_e const tradeType);
+  template <typename Socket>
+  Socket *addSocket(trade_type_e const tradeType, net::ssl::context &sslContext,
+                    char const *exchangeName);
+  template <typename Socket> Socket *standbyOf(Socket *primary) const;
+  // display names, in the same order as `m_sockets`
+  std::vector<QString> connectionNames() const;
+  void addJournals(std::size_t const firstSocket);
+  price_subscription_t makeSubscription(QString const &tokenName,
+                                        trade_type_e const tradeType,
+                                        exchange_name_e const exchange,
+                                        tick_slot_t &result,
+                                        price_source_e const priceSource,
+                                        bool const isRunning);
+  void watchSubscription(std::size_t const subscriptionIndex);
+  void scheduleWatchdogCheck();
+  void onSilentFeed(std::size_t const subscriptionIndex, bool const reconnect);
+
   net::ssl::context &m_sslContext;
-  std::unique_ptr<net::io_context> m_ioContext;
+  // sockets and subscriptions change at runtime, see `subscribe`
+  mutable std::mutex m_mutex;
+  std::unique_ptr<io_context_pool_t> m_ioContextPool;
   std::vector<socket_variant> m_sockets;
+  std::vector<feed_pair_t> m_feedPairs;
+  std::vector<price_subscription_t> m_priceSubscriptions;
+  std::shared_ptr<feed_watchdog_t> m_feedWatchdog;
+  std::unique_ptr<watchdog_runner_t> m_watchdogRunner;
+  std::optional<std::pair<std::filesystem::path, std::size_t>>
+      m_frameCaptureConfig;
+  std::unique_ptr<frame_capture_t> m_frameCapture;
+  bool const m_dualFeed;
+  bool m_conflateFrames = false;
+  bool m_isWatching = false;
 };
 
 } // namespace korrelator
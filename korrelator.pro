@@ -66,21 +66,16 @@ SOURCES += main.cpp \
   src/binance_futures_plug.cpp \
   src/binance_spots_plug.cpp \
   src/binance_https_request.cpp \
-  src/binance_websocket.cpp \
-  src/constants.cpp \
   src/crypto.cpp \
   src/kucoin_futures_plug.cpp \
   src/kucoin_spots_plug.cpp \
   src/kucoin_https_request.cpp \
   src/kucoin_symbols.cpp \
-  src/kucoin_websocket.cpp \
   src/settingsdialog.cpp \
   src/maindialog.cpp \
   src/order_model.cpp \
   src/qcustomplot.cpp \
   src/single_trader.cpp \
-  src/uri.cpp \
-  src/websocket_manager.cpp \
   src/windows_specifics.cpp
 
 HEADERS += include/binance_symbols.hpp \
@@ -90,24 +85,17 @@ HEADERS += include/binance_symbols.hpp \
   include/binance_futures_plug.hpp \
   include/binance_https_request.hpp \
   include/binance_spots_plug.hpp \
-  include/binance_websocket.hpp \
-  include/constants.hpp \
   include/container.hpp \
   include/crypto.hpp \
   include/kucoin_futures_plug.hpp \
   include/kucoin_https_request.hpp \
   include/kucoin_spots_plug.hpp \
-  include/kucoin_websocket.hpp \
   include/maindialog.hpp \
   include/order_model.hpp \
   include/plug_data.hpp \
   include/qcustomplot.h \
   include/single_trader.hpp \
   include/sthread.hpp \
-  include/uri.hpp \
-  include/utils.hpp \
-  include/tokens.hpp \
-  include/websocket_manager.hpp \
   include/settingsdialog.hpp \
   include/kucoin_symbols.hpp \
   include/mainwindow.hpp
@@ -125,3 +113,6 @@ elsD: unix:!android: target.path = /opt/$${TARGET}/bin
 
 RESOURCES += resources/image_resouce.qrc \
   resources/help.qrc
+
+include(korrelator_engine.pri)
+include(korrelator_feeds.pri)
@@ -0,0 +1,18 @@
+# The correlator engine and what it needs, QtCore only: normalization, the
+# ref average, crossovers, the LD closure and the price-delta band. Used by
+# the app and by korrelator_engine.pro, which builds it without the GUI.
+
+INCLUDEPATH += $$PWD/include
+
+SOURCES += $$PWD/src/correlator_engine.cpp \
+  $$PWD/src/order_book.cpp \
+  $$PWD/src/tokens.cpp \
+  $$PWD/src/utils.cpp
+
+HEADERS += $$PWD/include/correlator_engine.hpp \
+  $$PWD/include/order_book.hpp \
+  $$PWD/include/tick_notifier.hpp \
+  $$PWD/include/tick_ring.hpp \
+  $$PWD/include/tick_slot.hpp \
+  $$PWD/include/tokens.hpp \
+  $$PWD/include/utils.hpp
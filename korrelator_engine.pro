@@ -0,0 +1,9 @@
+# Static library of the headless correlator engine, for running it without
+# the widgets, several per process, or faster than the GUI plots.
+
+TEMPLATE = lib
+TARGET = korrelator_engine
+QT = core
+CONFIG += staticlib c++17
+
+include(korrelator_engine.pri)
@@ -0,0 +1,45 @@
+# The exchange feeds, QtCore, Boost and OpenSSL only: the websockets and
+# their frame parsers, the connection pool, the frame journal and its
+# replay. Used by the app and by the console targets in bench/.
+
+INCLUDEPATH += $$PWD/include
+
+unix: LIBS += -lssl -lcrypto
+
+SOURCES += $$PWD/src/binance_websocket.cpp \
+  $$PWD/src/clock_sync.cpp \
+  $$PWD/src/constants.cpp \
+  $$PWD/src/decimal_parser.cpp \
+  $$PWD/src/depth_snapshot.cpp \
+  $$PWD/src/dns_cache.cpp \
+  $$PWD/src/feed_watchdog.cpp \
+  $$PWD/src/frame_journal.cpp \
+  $$PWD/src/frame_replay.cpp \
+  $$PWD/src/frame_scanner.cpp \
+  $$PWD/src/io_context_pool.cpp \
+  $$PWD/src/kucoin_websocket.cpp \
+  $$PWD/src/latency_histogram.cpp \
+  $$PWD/src/tls_session_cache.cpp \
+  $$PWD/src/uri.cpp \
+  $$PWD/src/websocket_manager.cpp
+
+HEADERS += $$PWD/include/binance_websocket.hpp \
+  $$PWD/include/clock_sync.hpp \
+  $$PWD/include/constants.hpp \
+  $$PWD/include/decimal_parser.hpp \
+  $$PWD/include/depth_snapshot.hpp \
+  $$PWD/include/dns_cache.hpp \
+  $$PWD/include/feed_arbiter.hpp \
+  $$PWD/include/feed_watchdog.hpp \
+  $$PWD/include/frame_conflation.hpp \
+  $$PWD/include/frame_journal.hpp \
+  $$PWD/include/frame_replay.hpp \
+  $$PWD/include/frame_scanner.hpp \
+  $$PWD/include/handler_memory.hpp \
+  $$PWD/include/io_context_pool.hpp \
+  $$PWD/include/kucoin_websocket.hpp \
+  $$PWD/include/latency_histogram.hpp \
+  $$PWD/include/reconnect_backoff.hpp \
+  $$PWD/include/tls_session_cache.hpp \
+  $$PWD/include/uri.hpp \
+  $$PWD/include/websocket_manager.hpp
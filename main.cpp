@@ -6,6 +6,9 @@
 #include <QStandardPaths>
 #include <QDir>
 
+#include "constants.hpp"
+#include "dns_cache.hpp"
+
 static char const *kRunLogic = "run__correlator__program";
 static char const *kRunLogicValue = "run__correlator__program";
 static char const *kWindowsHKey = "HKEY_LOCAL_MACHINE";
@@ -17,7 +20,22 @@ namespace korrelator {
   bool addKeyToRegistryPath(char const * const parentPath, char const * const newPath);
 }
 
+// KORRELATOR_EXCHANGE_HOST=127.0.0.1:8443 points every exchange connection
+// at a local mock exchange
+static void overrideExchangeHostFromEnvironment() {
+  auto const hostAndPort = qgetenv("KORRELATOR_EXCHANGE_HOST").toStdString();
+  auto const colon = hostAndPort.rfind(':');
+  if (colon == std::string::npos || colon == 0)
+    return;
+  korrelator::constants::overrideExchangeHost(hostAndPort.substr(0, colon),
+                                              hostAndPort.substr(colon + 1));
+  qDebug() << "Exchange host overridden by" << hostAndPort.c_str();
+}
+
 static int runCorrelatorProgram(int &argc, char **argv) {
+  overrideExchangeHostFromEnvironment();
+  // resolved while the UI loads, before the first feed or order needs them
+  korrelator::prewarmExchangeHosts();
   QApplication a(argc, argv);
   MainWindow w;
   w.showMaximized();
@@ -0,0 +1,854 @@
+#include "mock_exchange.hpp"
+#include "utilities.hpp"
+
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace korrelator {
+namespace mock {
+// a feed session that far behind loses frames rather than memory
+static constexpr std::size_t max_queued_frames = 8'192;
+
+static int64_t now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+static std::string decimal(double const value, int const precision = 8) {
+  return fmt::format("{:.{}f}", value, precision);
+}
+
+// the plugs send sizes as strings or numbers depending on the order type
+static double json_number(json const &object, char const *key) {
+  auto const iter = object.find(key);
+  if (iter == object.end())
+    return 0.0;
+  if (iter->is_number())
+    return iter->get<double>();
+  if (iter->is_string())
+    return std::strtod(iter->get<std::string>().c_str(), nullptr);
+  return 0.0;
+}
+
+static std::map<std::string, std::string>
+split_query(boost::string_view const &target) {
+  std::map<std::string, std::string> result{};
+  auto const parts = utilities::split_string_view(target, "?");
+  if (parts.size() < 2)
+    return result;
+  for (auto const &q : utilities::split_string_view(parts[1], "&")) {
+    auto split = utilities::split_string_view(q, "=");
+    if (split.size() < 2)
+      continue;
+    result.emplace(utilities::view_to_string(split[0]),
+                   utilities::decode_url(split[1]));
+  }
+  return result;
+}
+
+symbol_t make_symbol(std::string const &name, double const price) {
+  symbol_t symbol{};
+  auto const dash = name.find('-');
+  symbol.base = name.substr(0, dash);
+  symbol.quote = dash == std::string::npos ? "USDT" : name.substr(dash + 1);
+  symbol.binance_name = symbol.base + symbol.quote;
+  symbol.stream_name = symbol.binance_name;
+  std::transform(symbol.stream_name.begin(), symbol.stream_name.end(),
+                 symbol.stream_name.begin(),
+                 [](char c) { return (char)std::tolower(c); });
+  symbol.kucoin_spot_name = symbol.base + "-" + symbol.quote;
+  symbol.kucoin_futures_name =
+      (symbol.base == "BTC" ? std::string("XBT") : symbol.base) +
+      symbol.quote + "M";
+  symbol.price = price;
+  return symbol;
+}
+
+market_t::market_t(asio::io_context &context, mock_config_t const &config)
+    : timer_{asio::make_strand(context)}, config_{config},
+      engine_{config.seed} {
+  std::uniform_real_distribution<double> start_price{10.0, 50'000.0};
+  for (auto const &name : config_.symbols)
+    symbols_.push_back(make_symbol(name, start_price(engine_)));
+}
+
+void market_t::run() { schedule_tick(); }
+
+void market_t::subscribe(std::weak_ptr<feed_session_t> session) {
+  std::lock_guard<std::mutex> lock_{mutex_};
+  subscribers_.push_back(std::move(session));
+}
+
+std::vector<symbol_t> market_t::snapshot() {
+  std::lock_guard<std::mutex> lock_{mutex_};
+  return symbols_;
+}
+
+std::optional<symbol_t> market_t::find(std::string const &name) {
+  std::lock_guard<std::mutex> lock_{mutex_};
+  for (auto const &symbol : symbols_) {
+    if (name == symbol.binance_name || name == symbol.kucoin_spot_name ||
+        name == symbol.kucoin_futures_name || name == symbol.stream_name)
+      return symbol;
+  }
+  return std::nullopt;
+}
+
+void market_t::schedule_tick() {
+  timer_.expires_after(config_.tick_interval);
+  timer_.async_wait(
+      beast::bind_front_handler(&market_t::on_tick, shared_from_this()));
+}
+
+void market_t::on_tick(beast::error_code const &ec) {
+  if (ec)
+    return;
+
+  auto tick = std::make_shared<market_tick_t>();
+  std::vector<std::shared_ptr<feed_session_t>> sessions{};
+  {
+    std::lock_guard<std::mutex> lock_{mutex_};
+    for (auto &symbol : symbols_) {
+      symbol.price *= std::exp(step_(engine_));
+      ++symbol.trade_id;
+    }
+    tick->time_ms = now_ms();
+    tick->sequence = ++sequence_;
+    tick->symbols = symbols_;
+
+    for (auto iter = subscribers_.begin(); iter != subscribers_.end();) {
+      if (auto session = iter->lock()) {
+        sessions.push_back(std::move(session));
+        ++iter;
+      } else {
+        iter = subscribers_.erase(iter);
+      }
+    }
+  }
+
+  std::shared_ptr<market_tick_t const> const shared_tick = std::move(tick);
+  for (auto &session : sessions)
+    session->on_market_tick(shared_tick);
+  schedule_tick();
+}
+
+order_t order_book_t::place(std::string symbol, std::string client_id,
+                            double const size, double const price,
+                            double const fill_ratio) {
+  std::lock_guard<std::mutex> lock_{mutex_};
+  order_t order{};
+  order.symbol = std::move(symbol);
+  order.binance_id = ++next_id_;
+  order.kucoin_id = fmt::format("{:024x}", order.binance_id);
+  order.client_id = client_id.empty() ? "mock" + order.kucoin_id
+                                      : std::move(client_id);
+  order.size = size;
+  order.filled = size * std::clamp(fill_ratio, 0.0, 1.0);
+  order.price = price;
+  kucoin_ids_[order.kucoin_id] = order.client_id;
+  binance_ids_[order.binance_id] = order.client_id;
+  orders_[order.client_id] = order;
+  return order;
+}
+
+std::optional<order_t> order_book_t::complete(std::string const &client_id,
+                                              std::string const &kucoin_id,
+                                              int64_t const binance_id) {
+  std::lock_guard<std::mutex> lock_{mutex_};
+  auto id = client_id;
+  if (auto iter = kucoin_ids_.find(kucoin_id); iter != kucoin_ids_.end())
+    id = iter->second;
+  else if (auto iter = binance_ids_.find(binance_id);
+           iter != binance_ids_.end())
+    id = iter->second;
+  auto iter = orders_.find(id);
+  if (iter == orders_.end())
+    return std::nullopt;
+  iter->second.filled = iter->second.size;
+  return iter->second;
+}
+
+bool rate_limiter_t::allow() {
+  if (limit_ == 0)
+    return true;
+  auto const second = now_ms() / 1'000;
+  std::lock_guard<std::mutex> lock_{mutex_};
+  if (second != window_) {
+    window_ = second;
+    count_ = 0;
+  }
+  return ++count_ <= limit_;
+}
+
+static string_response json_response(http::status const status,
+                                     json const &body,
+                                     string_request const &request) {
+  string_response response{status, request.version()};
+  response.set(http::field::server, "korrelator-mock");
+  response.set(http::field::content_type, "application/json");
+  response.keep_alive(request.keep_alive());
+  response.body() = body.dump();
+  response.prepare_payload();
+  return response;
+}
+
+static string_response kucoin_success(json data,
+                                      string_request const &request) {
+  return json_response(http::status::ok,
+                       json{{"code", "200000"}, {"data", std::move(data)}},
+                       request);
+}
+
+http_session_t::http_session_t(asio::ip::tcp::socket &&socket,
+                               ssl::context &ssl_context,
+                               exchange_state_t &state)
+    : stream_{std::move(socket), ssl_context},
+      latency_timer_{stream_.get_executor()}, state_{state} {}
+
+void http_session_t::run() {
+  beast::get_lowest_layer(stream_).expires_after(std::chrono::seconds(30));
+  stream_.async_handshake(
+      ssl::stream_base::server,
+      beast::bind_front_handler(&http_session_t::on_handshake,
+                                shared_from_this()));
+}
+
+void http_session_t::on_handshake(beast::error_code const &ec) {
+  if (ec) {
+    spdlog::error("TLS handshake failed: {}", ec.message());
+    return;
+  }
+  read_request();
+}
+
+void http_session_t::read_request() {
+  parser_.emplace();
+  parser_->body_limit(1'024 * 1'024);
+  beast::get_lowest_layer(stream_).expires_after(std::chrono::minutes(2));
+  http::async_read(stream_, buffer_, *parser_,
+                   beast::bind_front_handler(&http_session_t::on_request_read,
+                                             shared_from_this()));
+}
+
+void http_session_t::on_request_read(beast::error_code ec, std::size_t) {
+  if (ec == http::error::end_of_stream)
+    return shutdown();
+  if (ec) {
+    if (ec != beast::error::timeout && ec != asio::ssl::error::stream_truncated)
+      spdlog::error("read failed: {}", ec.message());
+    return;
+  }
+
+  if (websocket::is_upgrade(parser_->get())) {
+    auto const target = parser_->get().target();
+    auto const type = target.starts_with("/kucoin") ? feed_type_e::kucoin
+                                                    : feed_type_e::binance;
+    beast::get_lowest_layer(stream_).expires_never();
+    return std::make_shared<feed_session_t>(std::move(stream_), type, state_)
+        ->run(parser_->release());
+  }
+
+  ++state_.requests;
+  auto response = handle_request(parser_->get());
+  if (state_.config.response_latency.count() == 0)
+    return send_response(std::move(response));
+
+  response_.emplace(std::move(response));
+  latency_timer_.expires_after(state_.config.response_latency);
+  latency_timer_.async_wait(
+      [self = shared_from_this()](beast::error_code const &) {
+        self->send_response(std::move(*self->response_));
+      });
+}
+
+void http_session_t::send_response(string_response &&response) {
+  response_.emplace(std::move(response));
+  bool const close = response_->need_eof();
+  http::async_write(stream_, *response_,
+                    beast::bind_front_handler(
+                        &http_session_t::on_response_written,
+                        shared_from_this(), close));
+}
+
+void http_session_t::on_response_written(bool const close,
+                                         beast::error_code ec, std::size_t) {
+  if (ec) {
+    spdlog::error("write failed: {}", ec.message());
+    return;
+  }
+  if (close)
+    return shutdown();
+  response_.reset();
+  read_request();
+}
+
+void http_session_t::shutdown() {
+  beast::get_lowest_layer(stream_).expires_after(std::chrono::seconds(5));
+  stream_.async_shutdown(
+      [self = shared_from_this()](beast::error_code const &) {});
+}
+
+string_response http_session_t::handle_request(string_request const &request) {
+  auto const target = request.target();
+  auto const path_view = utilities::split_string_view(target, "?")[0];
+  std::string const path = utilities::view_to_string(path_view);
+  bool const is_kucoin = path_view.starts_with("/api/v1/");
+
+  if (!state_.limiter.allow()) {
+    ++state_.throttled;
+    return is_kucoin
+               ? json_response(http::status::too_many_requests,
+                               json{{"code", "429000"},
+                                    {"msg", "Too Many Requests"}},
+                               request)
+               : json_response(http::status::too_many_requests,
+                               json{{"code", -1003},
+                                    {"msg", "Too many requests."}},
+                               request);
+  }
+
+  if (path == "/api/v3/order" || path == "/fapi/v1/order")
+    return binance_order(request, path == "/api/v3/order");
+  if (path == "/fapi/v1/leverage") {
+    auto const query = split_query(target);
+    auto const iter = query.find("leverage");
+    int const leverage =
+        iter == query.end() ? 1 : std::atoi(iter->second.c_str());
+    return json_response(http::status::ok,
+                         json{{"leverage", leverage},
+                              {"maxNotionalValue", "1000000"},
+                              {"symbol", query.count("symbol")
+                                             ? query.at("symbol")
+                                             : std::string{}}},
+                         request);
+  }
+  if (path == "/api/v1/orders" && request.method() == http::verb::post)
+    return kucoin_order(request);
+  if (path_view.starts_with("/api/v1/orders/"))
+    return kucoin_order_status(request, path.substr(15));
+  if (path == "/api/v1/fills")
+    return kucoin_fills(request);
+  if (path == "/api/v1/bullet-public")
+    return bullet_public(request);
+
+  if (path == "/api/v3/time" || path == "/fapi/v1/time")
+    return json_response(http::status::ok, json{{"serverTime", now_ms()}},
+                         request);
+  if (path == "/api/v1/timestamp")
+    return kucoin_success(now_ms(), request);
+
+  if (path == "/api/v3/ticker/price" || path == "/fapi/v1/ticker/price") {
+    json list = json::array();
+    for (auto const &symbol : state_.market->snapshot())
+      list.push_back({{"symbol", symbol.binance_name},
+                      {"price", decimal(symbol.price, 2)}});
+    return json_response(http::status::ok, list, request);
+  }
+  if (path == "/api/v3/exchangeInfo" || path == "/fapi/v1/exchangeInfo")
+    return exchange_info(request, path == "/api/v3/exchangeInfo");
+  if (path == "/api/v1/symbols" || path == "/api/v1/market/allTickers" ||
+      path == "/api/v1/contracts/active")
+    return kucoin_symbols(request, path);
+
+  return json_response(http::status::not_found,
+                       json{{"code", "404000"}, {"msg", "Not Found"}},
+                       request);
+}
+
+string_response http_session_t::binance_order(string_request const &request,
+                                              bool const is_spot) {
+  auto const query = split_query(request.target());
+  auto const value = [&query](char const *key) {
+    auto const iter = query.find(key);
+    return iter == query.end() ? std::string{} : iter->second;
+  };
+
+  std::optional<order_t> order{};
+  if (request.method() == http::verb::post) {
+    auto const symbol = state_.market->find(value("symbol"));
+    if (!symbol)
+      return json_response(http::status::bad_request,
+                           json{{"code", -1121}, {"msg", "Invalid symbol."}},
+                           request);
+    auto const price = symbol->price;
+    auto size = std::strtod(value("quantity").c_str(), nullptr);
+    if (auto const quote = value("quoteOrderQty"); !quote.empty())
+      size = std::strtod(quote.c_str(), nullptr) / price;
+    order = state_.orders.place(symbol->binance_name,
+                                value("newClientOrderId"), size, price,
+                                state_.config.fill_ratio);
+  } else {
+    order = state_.orders.complete(value("origClientOrderId"), {},
+                                   std::atoll(value("orderId").c_str()));
+    if (!order)
+      return json_response(http::status::bad_request,
+                           json{{"code", -2013},
+                                {"msg", "Order does not exist."}},
+                           request);
+  }
+
+  char const *status = order->filled <= 0.0 ? "NEW"
+                       : order->filled < order->size ? "PARTIALLY_FILLED"
+                                                     : "FILLED";
+  json body{{"symbol", order->symbol},
+            {"orderId", order->binance_id},
+            {"clientOrderId", order->client_id},
+            {"status", status},
+            {"type", "MARKET"},
+            {"side", value("side")},
+            {"origQty", decimal(order->size)},
+            {"executedQty", decimal(order->filled)},
+            {"cummulativeQuoteQty", decimal(order->filled * order->price)},
+            {"avgPrice", decimal(order->price, 2)},
+            {"updateTime", now_ms()}};
+  if (is_spot) {
+    body["fills"] = json::array();
+    if (order->filled > 0.0)
+      body["fills"].push_back({{"price", decimal(order->price, 2)},
+                               {"qty", decimal(order->filled)},
+                               {"commission", "0"},
+                               {"commissionAsset", "BNB"},
+                               {"tradeId", order->binance_id}});
+  }
+  return json_response(http::status::ok, body, request);
+}
+
+string_response http_session_t::kucoin_order(string_request const &request) {
+  auto const body = json::parse(request.body(), nullptr, false);
+  if (body.is_discarded() || !body.is_object())
+    return json_response(http::status::bad_request,
+                         json{{"code", "400000"}, {"msg", "Bad Request"}},
+                         request);
+
+  auto const symbol =
+      state_.market->find(body.value("symbol", std::string{}));
+  if (!symbol)
+    return json_response(http::status::ok,
+                         json{{"code", "400100"}, {"msg", "Invalid symbol"}},
+                         request);
+
+  auto const price = symbol->price;
+  auto size = json_number(body, "size");
+  if (auto const funds = json_number(body, "funds"); funds > 0.0)
+    size = funds / price;
+  auto const order = state_.orders.place(
+      body.value("symbol", std::string{}), body.value("clientOid", std::string{}), size,
+      price, state_.config.fill_ratio);
+  return kucoin_success(json{{"orderId", order.kucoin_id}}, request);
+}
+
+string_response
+http_session_t::kucoin_order_status(string_request const &request,
+                                    std::string const &order_id) {
+  auto const order = state_.orders.complete({}, order_id, 0);
+  if (!order)
+    return json_response(http::status::not_found,
+                         json{{"code", "404000"}, {"msg", "order not exist"}},
+                         request);
+  return kucoin_success(
+      json{{"id", order->kucoin_id},
+           {"symbol", order->symbol},
+           {"clientOid", order->client_id},
+           {"status", "done"},
+           {"isActive", false},
+           {"filledSize", std::llround(order->filled)},
+           {"filledValue", decimal(order->filled * order->price)}},
+      request);
+}
+
+string_response http_session_t::kucoin_fills(string_request const &request) {
+  auto const query = split_query(request.target());
+  auto const iter = query.find("orderId");
+  json items = json::array();
+  if (iter != query.end()) {
+    if (auto const order = state_.orders.complete({}, iter->second, 0)) {
+      auto const symbol = state_.market->find(order->symbol);
+      items.push_back({{"orderId", order->kucoin_id},
+                       {"symbol", order->symbol},
+                       {"price", decimal(order->price, 2)},
+                       {"size", decimal(order->filled)},
+                       {"funds", decimal(order->filled * order->price)},
+                       {"fee", "0"},
+                       {"feeCurrency",
+                        symbol ? symbol->quote : std::string("USDT")}});
+    }
+  }
+  return kucoin_success(json{{"currentPage", 1},
+                             {"pageSize", 50},
+                             {"totalNum", items.size()},
+                             {"totalPage", 1},
+                             {"items", std::move(items)}},
+                        request);
+}
+
+string_response http_session_t::bullet_public(string_request const &request) {
+  // the client dials back whatever host it reached us on
+  auto const host = utilities::view_to_string(request[http::field::host]);
+  json server{{"endpoint", "wss://" + host + "/kucoin"},
+              {"protocol", "websocket"},
+              {"encrypt", true},
+              {"pingInterval", 18'000},
+              {"pingTimeout", 10'000}};
+  return kucoin_success(
+      json{{"token", "mock" + std::to_string(now_ms())},
+           {"instanceServers", json::array({std::move(server)})}},
+      request);
+}
+
+string_response http_session_t::exchange_info(string_request const &request,
+                                              bool const is_spot) {
+  json symbols = json::array();
+  for (auto const &symbol : state_.market->snapshot()) {
+    symbols.push_back(
+        {{"symbol", symbol.binance_name},
+         {"pair", symbol.binance_name},
+         {"status", "TRADING"},
+         {"baseAsset", symbol.base},
+         {"quoteAsset", symbol.quote},
+         {"pricePrecision", 2},
+         {"quantityPrecision", 5},
+         {"baseAssetPrecision", 8},
+         {"quotePrecision", 8},
+         {"filters", json::array({{{"filterType", "LOT_SIZE"},
+                                   {"stepSize", "0.00001"}},
+                                  {{"filterType", "MIN_NOTIONAL"},
+                                   {"minNotional", is_spot ? "10" : "5"}}})}});
+  }
+  return json_response(http::status::ok,
+                       json{{"serverTime", now_ms()}, {"symbols", symbols}},
+                       request);
+}
+
+string_response http_session_t::kucoin_symbols(string_request const &request,
+                                               std::string const &path) {
+  json list = json::array();
+  for (auto const &symbol : state_.market->snapshot()) {
+    if (path == "/api/v1/contracts/active") {
+      list.push_back({{"symbol", symbol.kucoin_futures_name},
+                      {"baseCurrency", symbol.base},
+                      {"quoteCurrency", symbol.quote},
+                      {"lastTradePrice", symbol.price},
+                      {"multiplier", 0.001},
+                      {"tickSize", 0.01}});
+    } else if (path == "/api/v1/market/allTickers") {
+      list.push_back({{"symbol", symbol.kucoin_spot_name},
+                      {"last", decimal(symbol.price, 2)}});
+    } else {
+      list.push_back({{"symbol", symbol.kucoin_spot_name},
+                      {"baseCurrency", symbol.base},
+                      {"quoteCurrency", symbol.quote},
+                      {"baseMinSize", "0.00001"},
+                      {"quoteMinSize", "0.1"},
+                      {"baseIncrement", "0.00000001"},
+                      {"quoteIncrement", "0.000001"},
+                      {"enableTrading", true}});
+    }
+  }
+  if (path == "/api/v1/market/allTickers")
+    return kucoin_success(json{{"time", now_ms()}, {"ticker", list}},
+                          request);
+  return kucoin_success(list, request);
+}
+
+feed_session_t::feed_session_t(ssl_stream_t &&stream, feed_type_e const type,
+                               exchange_state_t &state)
+    : stream_{std::move(stream)}, type_{type}, state_{state} {}
+
+void feed_session_t::run(string_request request) {
+  auto const query = split_query(request.target());
+  if (type_ == feed_type_e::binance) {
+    // "/stream?streams=btcusdt@aggTrade/btcusdt@ticker"
+    if (auto const iter = query.find("streams"); iter != query.end()) {
+      for (auto const &name :
+           utilities::split_string_view(iter->second, "/"))
+        streams_.insert(utilities::view_to_string(name));
+    }
+  } else if (auto const iter = query.find("connectId"); iter != query.end()) {
+    connect_id_ = iter->second;
+  }
+
+  stream_.text(true);
+  stream_.set_option(
+      websocket::stream_base::timeout::suggested(beast::role_type::server));
+  stream_.async_accept(request,
+                       beast::bind_front_handler(&feed_session_t::on_accept,
+                                                 shared_from_this()));
+}
+
+void feed_session_t::on_accept(beast::error_code const &ec) {
+  if (ec) {
+    spdlog::error("websocket accept failed: {}", ec.message());
+    return;
+  }
+  state_.market->subscribe(weak_from_this());
+  if (type_ == feed_type_e::kucoin)
+    send(json{{"id", connect_id_}, {"type", "welcome"}}.dump());
+  read_message();
+}
+
+void feed_session_t::read_message() {
+  stream_.async_read(buffer_,
+                     beast::bind_front_handler(&feed_session_t::on_message,
+                                               shared_from_this()));
+}
+
+void feed_session_t::on_message(beast::error_code const &ec, std::size_t) {
+  if (ec) {
+    closed_ = true;
+    if (dropped_ != 0)
+      spdlog::info("feed closed, {} frames dropped", dropped_);
+    return;
+  }
+  auto const message =
+      json::parse(beast::buffers_to_string(buffer_.data()), nullptr, false);
+  buffer_.consume(buffer_.size());
+  if (!message.is_discarded() && message.is_object()) {
+    if (type_ == feed_type_e::binance)
+      binance_message(message);
+    else
+      kucoin_message(message);
+  }
+  read_message();
+}
+
+// {"method": "SUBSCRIBE", "params": ["btcusdt@aggTrade"], "id": 1}
+void feed_session_t::binance_message(json const &message) {
+  auto const method = message.value("method", std::string{});
+  auto const params = message.find("params");
+  if (params != message.end() && params->is_array()) {
+    for (auto const &param : *params) {
+      if (!param.is_string())
+        continue;
+      if (method == "SUBSCRIBE")
+        streams_.insert(param.get<std::string>());
+      else if (method == "UNSUBSCRIBE")
+        streams_.erase(param.get<std::string>());
+    }
+  }
+  json reply{{"result", nullptr}, {"id", message.value("id", json{})}};
+  if (method == "LIST_SUBSCRIPTIONS")
+    reply["result"] = streams_;
+  send(reply.dump());
+}
+
+// {"id": 1, "type": "subscribe", "topic": "/market/ticker:BTC-USDT,ETH-USDT"}
+void feed_session_t::kucoin_message(json const &message) {
+  auto const type = message.value("type", std::string{});
+  auto const id = message.value("id", json{});
+  if (type == "ping")
+    return send(json{{"id", id}, {"type", "pong"}}.dump());
+  if (type != "subscribe" && type != "unsubscribe")
+    return;
+
+  auto const topic = message.value("topic", std::string{});
+  auto const colon = topic.find(':');
+  if (colon != std::string::npos) {
+    auto const channel = topic.substr(0, colon);
+    auto &tickers = channel == "/market/ticker" ? spot_tickers_
+                    : channel == "/contractMarket/ticker"
+                        ? futures_tickers_
+                        : streams_; // level2 and the rest are acked only
+    for (auto const &name : utilities::split_string_view(
+             boost::string_view(topic).substr(colon + 1), ",")) {
+      if (&tickers == &streams_)
+        break;
+      if (type == "subscribe")
+        tickers.insert(utilities::view_to_string(name));
+      else
+        tickers.erase(utilities::view_to_string(name));
+    }
+  }
+  send(json{{"id", id}, {"type", "ack"}}.dump());
+}
+
+void feed_session_t::on_market_tick(
+    std::shared_ptr<market_tick_t const> tick) {
+  asio::post(stream_.get_executor(),
+             [self = shared_from_this(), tick = std::move(tick)] {
+               self->publish(*tick);
+             });
+}
+
+void feed_session_t::publish(market_tick_t const &tick) {
+  if (closed_)
+    return;
+
+  for (auto const &symbol : tick.symbols) {
+    auto const price = decimal(symbol.price, 2);
+    if (type_ == feed_type_e::binance) {
+      auto const &name = symbol.stream_name;
+      if (streams_.count(name + "@aggTrade"))
+        send(fmt::format(
+            R"({{"stream":"{0}@aggTrade","data":{{"e":"aggTrade","E":{1},)"
+            R"("s":"{2}","a":{3},"p":"{4}","q":"0.01000","f":{3},"l":{3},)"
+            R"("T":{1},"m":false,"M":true}}}})",
+            name, tick.time_ms, symbol.binance_name, symbol.trade_id, price));
+      if (streams_.count(name + "@ticker"))
+        send(fmt::format(
+            R"({{"stream":"{0}@ticker","data":{{"e":"24hrTicker","E":{1},)"
+            R"("s":"{2}","c":"{3}","L":{4}}}}})",
+            name, tick.time_ms, symbol.binance_name, price,
+            symbol.trade_id));
+      if (streams_.count(name + "@bookTicker"))
+        send(fmt::format(
+            R"({{"stream":"{0}@bookTicker","data":{{"u":{1},"s":"{2}",)"
+            R"("b":"{3}","B":"1.00000","a":"{4}","A":"1.00000","E":{5}}}}})",
+            name, tick.sequence, symbol.binance_name,
+            decimal(symbol.price * 0.9999, 2),
+            decimal(symbol.price * 1.0001, 2), tick.time_ms));
+      continue;
+    }
+
+    // field order follows what `kuCoinGetCoinPrice` scans for
+    if (spot_tickers_.count(symbol.kucoin_spot_name))
+      send(fmt::format(
+          R"({{"type":"message","topic":"/market/ticker:{0}",)"
+          R"("subject":"trade.ticker","data":{{"price":"{1}","time":{2},)"
+          R"("sequence":"{3}","size":"0.01000"}}}})",
+          symbol.kucoin_spot_name, price, tick.time_ms, tick.sequence));
+    if (futures_tickers_.count(symbol.kucoin_futures_name))
+      send(fmt::format(
+          R"({{"type":"message","topic":"/contractMarket/ticker:{0}",)"
+          R"("subject":"ticker","data":{{"bestBidPrice":"{1}",)"
+          R"("bestAskPrice":"{2}","ts":{3},"sequence":{4}}}}})",
+          symbol.kucoin_futures_name, decimal(symbol.price * 0.9999, 2),
+          decimal(symbol.price * 1.0001, 2), tick.time_ms * 1'000'000,
+          tick.sequence));
+  }
+}
+
+void feed_session_t::send(std::string message) {
+  if (write_queue_.size() >= max_queued_frames) {
+    ++dropped_;
+    return;
+  }
+  write_queue_.push_back(
+      std::make_shared<std::string const>(std::move(message)));
+  if (write_queue_.size() == 1)
+    write_next();
+}
+
+void feed_session_t::write_next() {
+  stream_.async_write(
+      asio::buffer(*write_queue_.front()),
+      [self = shared_from_this()](beast::error_code const &ec, std::size_t) {
+        if (ec) {
+          self->closed_ = true;
+          self->write_queue_.clear();
+          return;
+        }
+        self->write_queue_.pop_front();
+        if (!self->write_queue_.empty())
+          self->write_next();
+      });
+}
+
+bool use_self_signed_certificate(ssl::context &context) {
+  std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)> key_context{
+      EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr), &EVP_PKEY_CTX_free};
+  EVP_PKEY *raw_key = nullptr;
+  if (!key_context || EVP_PKEY_keygen_init(key_context.get()) <= 0 ||
+      EVP_PKEY_CTX_set_ec_paramgen_curve_nid(key_context.get(),
+                                             NID_X9_62_prime256v1) <= 0 ||
+      EVP_PKEY_keygen(key_context.get(), &raw_key) <= 0)
+    return false;
+  std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key{raw_key,
+                                                          &EVP_PKEY_free};
+
+  std::unique_ptr<X509, decltype(&X509_free)> certificate{X509_new(),
+                                                          &X509_free};
+  if (!certificate)
+    return false;
+  X509_set_version(certificate.get(), 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(certificate.get()), 1);
+  X509_gmtime_adj(X509_getm_notBefore(certificate.get()), 0);
+  X509_gmtime_adj(X509_getm_notAfter(certificate.get()), 60L * 60 * 24 * 365);
+  X509_set_pubkey(certificate.get(), key.get());
+  auto const name = X509_get_subject_name(certificate.get());
+  X509_NAME_add_entry_by_txt(
+      name, "CN", MBSTRING_ASC,
+      reinterpret_cast<unsigned char const *>("localhost"), -1, -1, 0);
+  X509_set_issuer_name(certificate.get(), name);
+  if (X509_sign(certificate.get(), key.get(), EVP_sha256()) <= 0)
+    return false;
+  return SSL_CTX_use_certificate(context.native_handle(),
+                                 certificate.get()) == 1 &&
+         SSL_CTX_use_PrivateKey(context.native_handle(), key.get()) == 1;
+}
+
+mock_exchange_t::mock_exchange_t(asio::io_context &context,
+                                 mock_config_t const &config)
+    : io_context_{context}, acceptor_{asio::make_strand(io_context_)},
+      state_{config, std::make_shared<market_t>(context, config), {},
+             rate_limiter_t{config.rate_limit}} {
+  if (!use_self_signed_certificate(ssl_context_)) {
+    spdlog::error("Could not create a TLS certificate");
+    return;
+  }
+
+  asio::ip::tcp::endpoint const endpoint{asio::ip::make_address("127.0.0.1"),
+                                         config.port};
+  beast::error_code ec{};
+  acceptor_.open(endpoint.protocol(), ec);
+  if (ec) {
+    spdlog::error("Could not open socket: {}", ec.message());
+    return;
+  }
+  acceptor_.set_option(asio::socket_base::reuse_address(true), ec);
+  acceptor_.bind(endpoint, ec);
+  if (ec) {
+    spdlog::error("binding failed: {}", ec.message());
+    return;
+  }
+  acceptor_.listen(asio::socket_base::max_listen_connections, ec);
+  if (ec) {
+    spdlog::error("not able to listen: {}", ec.message());
+    return;
+  }
+  is_open_ = true;
+}
+
+bool mock_exchange_t::run() {
+  if (!is_open_)
+    return false;
+  state_.market->run();
+  accept_connections();
+  return true;
+}
+
+std::size_t mock_exchange_t::requests_served() const {
+  return state_.requests;
+}
+
+std::size_t mock_exchange_t::requests_throttled() const {
+  return state_.throttled;
+}
+
+void mock_exchange_t::on_connection_accepted(beast::error_code const &ec,
+                                             asio::ip::tcp::socket socket) {
+  if (ec) {
+    spdlog::error("error on connection: {}", ec.message());
+  } else {
+    asio::ip::tcp::no_delay const no_delay{true};
+    beast::error_code option_ec{};
+    socket.set_option(no_delay, option_ec);
+    std::make_shared<http_session_t>(std::move(socket), ssl_context_, state_)
+        ->run();
+  }
+  accept_connections();
+}
+
+void mock_exchange_t::accept_connections() {
+  acceptor_.async_accept(
+      asio::make_strand(io_context_),
+      beast::bind_front_handler(&mock_exchange_t::on_connection_accepted,
+                                shared_from_this()));
+}
+} // namespace mock
+} // namespace korrelator
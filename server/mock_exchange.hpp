@@ -0,0 +1,236 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// A stand-in for the Binance and KuCoin endpoints the korrelator client
+// talks to, served over TLS on a single port. Start the client with
+// KORRELATOR_EXCHANGE_HOST=127.0.0.1:<port> to point every connection here.
+namespace korrelator {
+namespace mock {
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace ssl = asio::ssl;
+namespace websocket = beast::websocket;
+using nlohmann::json;
+
+struct mock_config_t {
+  std::size_t thread_count{1};
+  uint16_t port{8443};
+  std::chrono::milliseconds tick_interval{100};
+  // added before every REST response
+  std::chrono::milliseconds response_latency{0};
+  // share of an order filled when it is placed, the rest fills when the
+  // client asks for the order's status
+  double fill_ratio{1.0};
+  // REST requests per second before 429s, 0 => unlimited
+  std::size_t rate_limit{0};
+  uint32_t seed{42};
+  std::vector<std::string> symbols{"BTC-USDT", "ETH-USDT"};
+};
+
+struct symbol_t {
+  std::string base;
+  std::string quote;
+  std::string binance_name; // "BTCUSDT"
+  std::string stream_name;  // "btcusdt"
+  std::string kucoin_spot_name;    // "BTC-USDT"
+  std::string kucoin_futures_name; // "XBTUSDTM"
+  double price{};
+  int64_t trade_id{};
+};
+
+// one step of the random walk, shared by every feed session
+struct market_tick_t {
+  int64_t time_ms{};
+  int64_t sequence{};
+  std::vector<symbol_t> symbols;
+};
+
+class feed_session_t;
+
+class market_t : public std::enable_shared_from_this<market_t> {
+  asio::steady_timer timer_;
+  mock_config_t const &config_;
+  std::mt19937_64 engine_;
+  std::normal_distribution<double> step_{0.0, 0.0005};
+  std::mutex mutex_;
+  std::vector<symbol_t> symbols_;
+  int64_t sequence_{};
+  std::list<std::weak_ptr<feed_session_t>> subscribers_;
+
+public:
+  market_t(asio::io_context &context, mock_config_t const &config);
+  void run();
+  void subscribe(std::weak_ptr<feed_session_t> session);
+  std::vector<symbol_t> snapshot();
+  // by any of its spellings, with the current price
+  std::optional<symbol_t> find(std::string const &name);
+
+private:
+  void schedule_tick();
+  void on_tick(beast::error_code const &ec);
+};
+
+struct order_t {
+  std::string symbol;
+  std::string client_id;
+  std::string kucoin_id;
+  int64_t binance_id{};
+  double size{};
+  double filled{};
+  double price{};
+};
+
+class order_book_t {
+  std::mutex mutex_;
+  std::map<std::string, order_t> orders_; // by client id
+  std::map<std::string, std::string> kucoin_ids_;
+  std::map<int64_t, std::string> binance_ids_;
+  int64_t next_id_{1'000'000};
+
+public:
+  order_t place(std::string symbol, std::string client_id, double size,
+                double price, double fill_ratio);
+  // the client polls an order until done, fill what's left on the way
+  std::optional<order_t> complete(std::string const &client_id,
+                                  std::string const &kucoin_id,
+                                  int64_t binance_id);
+};
+
+class rate_limiter_t {
+  std::mutex mutex_;
+  std::size_t const limit_;
+  int64_t window_{};
+  std::size_t count_{};
+
+public:
+  explicit rate_limiter_t(std::size_t limit) : limit_{limit} {}
+  bool allow();
+};
+
+struct exchange_state_t {
+  mock_config_t const &config;
+  std::shared_ptr<market_t> market;
+  order_book_t orders;
+  rate_limiter_t limiter;
+  std::atomic<std::size_t> requests{};
+  std::atomic<std::size_t> throttled{};
+};
+
+using ssl_stream_t = beast::ssl_stream<beast::tcp_stream>;
+using string_request = http::request<http::string_body>;
+using string_response = http::response<http::string_body>;
+
+// TLS handshake, then REST requests until the client upgrades to websocket
+class http_session_t : public std::enable_shared_from_this<http_session_t> {
+  ssl_stream_t stream_;
+  beast::flat_buffer buffer_{};
+  std::optional<http::request_parser<http::string_body>> parser_{};
+  std::optional<string_response> response_{};
+  asio::steady_timer latency_timer_;
+  exchange_state_t &state_;
+
+public:
+  http_session_t(asio::ip::tcp::socket &&socket, ssl::context &ssl_context,
+                 exchange_state_t &state);
+  void run();
+
+private:
+  void on_handshake(beast::error_code const &ec);
+  void read_request();
+  void on_request_read(beast::error_code ec, std::size_t);
+  void send_response(string_response &&response);
+  void on_response_written(bool close, beast::error_code ec, std::size_t);
+  void shutdown();
+
+  string_response handle_request(string_request const &request);
+  string_response binance_order(string_request const &request,
+                                bool is_spot);
+  string_response kucoin_order(string_request const &request);
+  string_response kucoin_order_status(string_request const &request,
+                                      std::string const &order_id);
+  string_response kucoin_fills(string_request const &request);
+  string_response bullet_public(string_request const &request);
+  string_response exchange_info(string_request const &request, bool is_spot);
+  string_response kucoin_symbols(string_request const &request,
+                                 std::string const &path);
+};
+
+enum class feed_type_e { binance, kucoin };
+
+// A websocket of either exchange, fed from `market_t`. Frames are queued
+// per session and dropped once the client falls too far behind.
+class feed_session_t : public std::enable_shared_from_this<feed_session_t> {
+  websocket::stream<ssl_stream_t> stream_;
+  beast::flat_buffer buffer_{};
+  feed_type_e const type_;
+  exchange_state_t &state_;
+  std::string connect_id_;
+  std::set<std::string> streams_;         // binance, "btcusdt@aggTrade"
+  std::set<std::string> spot_tickers_;    // kucoin, "BTC-USDT"
+  std::set<std::string> futures_tickers_; // kucoin, "XBTUSDTM"
+  std::deque<std::shared_ptr<std::string const>> write_queue_;
+  std::size_t dropped_{};
+  bool closed_{false};
+
+public:
+  feed_session_t(ssl_stream_t &&stream, feed_type_e type,
+                 exchange_state_t &state);
+  void run(string_request request);
+  void on_market_tick(std::shared_ptr<market_tick_t const> tick);
+
+private:
+  void on_accept(beast::error_code const &ec);
+  void read_message();
+  void on_message(beast::error_code const &ec, std::size_t);
+  void binance_message(json const &message);
+  void kucoin_message(json const &message);
+  void publish(market_tick_t const &tick);
+  void send(std::string message);
+  void write_next();
+};
+
+class mock_exchange_t : public std::enable_shared_from_this<mock_exchange_t> {
+  asio::io_context &io_context_;
+  asio::ip::tcp::acceptor acceptor_;
+  ssl::context ssl_context_{ssl::context::tlsv12_server};
+  exchange_state_t state_;
+  bool is_open_{false};
+
+public:
+  mock_exchange_t(asio::io_context &context, mock_config_t const &config);
+  bool run();
+  std::size_t requests_served() const;
+  std::size_t requests_throttled() const;
+
+private:
+  void accept_connections();
+  void on_connection_accepted(beast::error_code const &ec,
+                              asio::ip::tcp::socket socket);
+};
+
+// "BTC-USDT" => base BTC, quote USDT, with the names every feed uses
+symbol_t make_symbol(std::string const &name, double price);
+bool use_self_signed_certificate(ssl::context &context);
+} // namespace mock
+} // namespace korrelator
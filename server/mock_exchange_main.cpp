@@ -0,0 +1,84 @@
+#include "mock_exchange.hpp"
+#include "utilities.hpp"
+#include <spdlog/spdlog.h>
+#include <thread>
+
+using korrelator::mock::mock_config_t;
+
+static void print_usage(char const *program) {
+  spdlog::info("usage: {} [--port 8443] [--threads 1] [--tick-ms 100] "
+               "[--latency-ms 0] [--fill-ratio 1.0] [--rate-limit 0] "
+               "[--seed 42] [--symbols BTC-USDT,ETH-USDT]",
+               program);
+}
+
+static bool parse_arguments(int argc, char *argv[], mock_config_t &config) {
+  for (int i = 1; i < argc; ++i) {
+    std::string const option = argv[i];
+    if (i + 1 >= argc)
+      return false;
+    std::string const value = argv[++i];
+    if (option == "--port") {
+      config.port = static_cast<uint16_t>(std::stoul(value));
+    } else if (option == "--threads") {
+      config.thread_count = std::max<std::size_t>(1, std::stoul(value));
+    } else if (option == "--tick-ms") {
+      config.tick_interval =
+          std::chrono::milliseconds(std::max<long>(1, std::stol(value)));
+    } else if (option == "--latency-ms") {
+      config.response_latency = std::chrono::milliseconds(std::stol(value));
+    } else if (option == "--fill-ratio") {
+      config.fill_ratio = std::stod(value);
+    } else if (option == "--rate-limit") {
+      config.rate_limit = std::stoul(value);
+    } else if (option == "--seed") {
+      config.seed = static_cast<uint32_t>(std::stoul(value));
+    } else if (option == "--symbols") {
+      config.symbols.clear();
+      for (auto const &name :
+           korrelator::utilities::split_string_view(value, ","))
+        config.symbols.push_back(korrelator::utilities::view_to_string(name));
+    } else {
+      return false;
+    }
+  }
+  return !config.symbols.empty();
+}
+
+int main(int argc, char *argv[]) {
+  mock_config_t config{};
+  try {
+    if (!parse_arguments(argc, argv, config)) {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  } catch (std::exception const &e) {
+    spdlog::error("invalid argument: {}", e.what());
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  korrelator::mock::asio::io_context context{
+      static_cast<int>(config.thread_count)};
+  auto exchange =
+      std::make_shared<korrelator::mock::mock_exchange_t>(context, config);
+  if (!exchange->run())
+    return EXIT_FAILURE;
+  spdlog::info("mock exchange listening on 127.0.0.1:{}, {} symbol(s)",
+               config.port, config.symbols.size());
+
+  korrelator::mock::asio::signal_set signals{context, SIGINT, SIGTERM};
+  signals.async_wait([&](auto const &, int) { context.stop(); });
+
+  std::vector<std::thread> threads{};
+  threads.reserve(config.thread_count - 1);
+  for (std::size_t counter = 1; counter < config.thread_count; ++counter)
+    threads.emplace_back([&] { context.run(); });
+  context.run();
+  for (auto &thread : threads)
+    thread.join();
+
+  spdlog::info("served {} REST requests, {} throttled",
+               exchange->requests_served(), exchange->requests_throttled());
+  return EXIT_SUCCESS;
+}
@@ -13,8 +13,11 @@
 #include <sstream>
 #endif
 
+#include "clock_sync.hpp"
 #include "constants.hpp"
 #include "crypto.hpp"
+#include "decimal_parser.hpp"
+#include "tls_session_cache.hpp"
 
 namespace korrelator {
 
@@ -57,29 +60,36 @@ void binance_futures_plug::doConnect() {
   if (!createRequestData())
     return;
 
+  if (auto endpoints = dns_cache_t::instance().lookup(
+          constants::binance_http_futures_host, constants::https_port))
+    return onHostResolved(*endpoints);
+
   m_resolver.async_resolve(
-      constants::binance_http_futures_host, "https",
+      constants::binance_http_futures_host, constants::https_port,
       [this](auto const &errorCode, resolver::results_type const &results) {
         if (errorCode) {
           qDebug() << errorCode.message().c_str();
           return;
         }
-        onHostResolved(results);
+        onHostResolved(dns_cache_t::instance().store(
+            constants::binance_http_futures_host, constants::https_port, results));
       });
 }
 
 void binance_futures_plug::startConnect() { doConnect(); }
 
 void binance_futures_plug::onHostResolved(
-    tcp::resolver::results_type const &result) {
+    dns_cache_t::endpoints_t const &result) {
   m_tcpStream.emplace(m_ioContext, m_sslContext);
   beast::get_lowest_layer(*m_tcpStream).expires_after(std::chrono::seconds(30));
   beast::get_lowest_layer(*m_tcpStream)
-      .async_connect(result, [this](auto const &errorCode, auto const &result) {
+      .async_connect(result, [this, started = std::chrono::steady_clock::now()](
+                                 auto const &errorCode, auto const &result) {
         if (errorCode) {
           qDebug() << errorCode.message().c_str();
           return;
         }
+        dns_cache_t::instance().recordConnect(result, started);
         performSSLHandshake(result);
       });
 }
@@ -93,7 +103,9 @@ bool binance_futures_plug::createLeverageRequest() {
   QString query =
       "symbol=" + m_tradeConfig->symbol.toUpper() +
       "&leverage=" + QString::number(m_tradeConfig->leverage) +
-      "&recvWindow=5000&timestamp=" + QString::number(getGMTTimeMs());
+      "&recvWindow=5000&timestamp=" +
+      QString::number(
+          exchangeNowMs(exchange_name_e::binance, trade_type_e::futures));
   auto const signature =
       hmac256_encode(query.toStdString(), m_apiSecret.toStdString(), true);
   query +=
@@ -150,8 +162,9 @@ bool binance_futures_plug::createRequestData() {
     query += QString::number(m_price, 'f', m_tradeConfig->pricePrecision);
   }
 
-  query +=
-      QString("&recvWindow=5000&timestamp=") + QString::number(getGMTTimeMs());
+  query += QString("&recvWindow=5000&timestamp=") +
+           QString::number(
+               exchangeNowMs(exchange_name_e::binance, trade_type_e::futures));
 
   auto const signature =
       hmac256_encode(query.toStdString(), m_apiSecret.toStdString(), true);
@@ -187,14 +200,18 @@ void binance_futures_plug::performSSLHandshake(
     return;
   }
 
-  m_tcpStream->async_handshake(ssl::stream_base::client,
-                               [this](beast::error_code const ec) {
-                                 if (ec) {
-                                   qDebug() << ec.message().c_str();
-                                   return;
-                                 }
-                                 return sendHttpsData();
-                               });
+  auto const started =
+      tls_session_cache_t::instance().beforeHandshake(m_tcpStream->native_handle());
+  m_tcpStream->async_handshake(
+      ssl::stream_base::client, [this, started](beast::error_code const ec) {
+        if (ec) {
+          qDebug() << ec.message().c_str();
+          return;
+        }
+        tls_session_cache_t::instance().afterHandshake(m_tcpStream->native_handle(),
+                                                 started);
+        return sendHttpsData();
+      });
 }
 
 binance_futures_plug::binance_futures_plug(net::io_context &ioContext,
@@ -298,12 +315,14 @@ void binance_futures_plug::processOrderResponse(char const *str,
       auto const executedQtyIter = jsonRoot.FindMember("executedQty");
       if (avgPriceIter != jsonRoot.MemberEnd() &&
           avgPriceIter->value.IsString()) {
-        m_averagePriceExecuted += std::stod(avgPriceIter->value.GetString());
+        m_averagePriceExecuted +=
+            stringToDouble(avgPriceIter->value.GetString());
       }
 
       if (executedQtyIter != jsonRoot.MemberEnd() &&
           executedQtyIter->value.IsString()) {
-        m_finalSizePurchased += std::stod(executedQtyIter->value.GetString());
+        m_finalSizePurchased +=
+            stringToDouble(executedQtyIter->value.GetString());
       }
     }
 
@@ -351,7 +370,9 @@ void binance_futures_plug::createMonitoringRequest() {
   else
     urlQuery += "&origClientOrderId=" + m_userOrderID;
 
-  urlQuery += "&timestamp=" + QString::number(getGMTTimeMs());
+  urlQuery += "&timestamp=" +
+              QString::number(exchangeNowMs(exchange_name_e::binance,
+                                            trade_type_e::futures));
   auto const signature =
       hmac256_encode(urlQuery.toStdString(), m_apiSecret.toStdString(), true);
   urlQuery +=
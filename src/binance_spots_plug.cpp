@@ -13,8 +13,11 @@
 #include <sstream>
 #endif
 
+#include "clock_sync.hpp"
 #include "constants.hpp"
 #include "crypto.hpp"
+#include "decimal_parser.hpp"
+#include "tls_session_cache.hpp"
 
 namespace korrelator {
 
@@ -50,29 +53,36 @@ void binance_spots_plug::doConnect() {
 
   if (!createRequestData())
     return;
+  if (auto endpoints = dns_cache_t::instance().lookup(
+          constants::binance_http_spot_host, constants::https_port))
+    return onHostResolved(*endpoints);
+
   m_resolver.async_resolve(
-      constants::binance_http_spot_host, "https",
+      constants::binance_http_spot_host, constants::https_port,
       [this](auto const &errorCode, resolver::results_type const &results) {
         if (errorCode) {
           qDebug() << errorCode.message().c_str();
           return;
         }
-        onHostResolved(results);
+        onHostResolved(dns_cache_t::instance().store(
+            constants::binance_http_spot_host, constants::https_port, results));
       });
 }
 
 void binance_spots_plug::startConnect() { doConnect(); }
 
 void binance_spots_plug::onHostResolved(
-    tcp::resolver::results_type const &result) {
+    dns_cache_t::endpoints_t const &result) {
   m_tcpStream.emplace(m_ioContext, m_sslContext);
   beast::get_lowest_layer(*m_tcpStream).expires_after(std::chrono::seconds(30));
   beast::get_lowest_layer(*m_tcpStream)
-      .async_connect(result, [this](auto const &errorCode, auto const &result) {
+      .async_connect(result, [this, started = std::chrono::steady_clock::now()](
+                                 auto const &errorCode, auto const &result) {
         if (errorCode) {
           qDebug() << errorCode.message().c_str();
           return;
         }
+        dns_cache_t::instance().recordConnect(result, started);
         performSSLHandshake(result);
       });
 }
@@ -133,8 +143,9 @@ bool binance_spots_plug::createRequestData() {
     query += QString::number(m_price, 'f', m_tradeConfig->pricePrecision);
   }
 
-  query +=
-      QString("&recvWindow=5000&timestamp=") + QString::number(getGMTTimeMs());
+  query += QString("&recvWindow=5000&timestamp=") +
+           QString::number(
+               exchangeNowMs(exchange_name_e::binance, trade_type_e::spot));
 
   auto const signature =
       hmac256_encode(query.toStdString(), m_apiSecret.toStdString(), true);
@@ -166,14 +177,18 @@ void binance_spots_plug::performSSLHandshake(
     return;
   }
 
-  m_tcpStream->async_handshake(ssl::stream_base::client,
-                               [this](beast::error_code const ec) {
-                                 if (ec) {
-                                   qDebug() << ec.message().c_str();
-                                   return;
-                                 }
-                                 return sendHttpsData();
-                               });
+  auto const started =
+      tls_session_cache_t::instance().beforeHandshake(m_tcpStream->native_handle());
+  m_tcpStream->async_handshake(
+      ssl::stream_base::client, [this, started](beast::error_code const ec) {
+        if (ec) {
+          qDebug() << ec.message().c_str();
+          return;
+        }
+        tls_session_cache_t::instance().afterHandshake(m_tcpStream->native_handle(),
+                                                 started);
+        return sendHttpsData();
+      });
 }
 
 binance_spots_plug::binance_spots_plug(net::io_context &ioContext,
@@ -266,11 +281,13 @@ void binance_spots_plug::processOrderResponse(char const *str,
           auto const newInsert =
               m_fillsTradeIds.insert(tradeIDIter->value.GetInt64());
           if (newInsert.second) { // insertion was successful
-            m_averagePriceExecuted += std::stod(priceIter->value.GetString());
-            m_finalSizePurchased += std::stod(qtyIter->value.GetString());
+            m_averagePriceExecuted +=
+                stringToDouble(priceIter->value.GetString());
+            m_finalSizePurchased += stringToDouble(qtyIter->value.GetString());
             if (baseCurrency.compare(commissionAssetIter->value.GetString(),
                                      Qt::CaseInsensitive) == 0) {
-              totalCommission += std::stod(commissionIter->value.GetString());
+              totalCommission +=
+                  stringToDouble(commissionIter->value.GetString());
             }
           }
         }
@@ -287,7 +304,7 @@ void binance_spots_plug::processOrderResponse(char const *str,
               jsonRoot.FindMember("cummulativeQuoteQty");
           if (cummulativeQuoteQtyIter != jsonRoot.MemberEnd()) {
             otherSide->quoteAmount =
-                std::stod(cummulativeQuoteQtyIter->value.GetString());
+                stringToDouble(cummulativeQuoteQtyIter->value.GetString());
             otherSide->quoteAmount -= totalCommission;
           }
           otherSide->size = 0.0;
@@ -346,7 +363,9 @@ void binance_spots_plug::createMonitoringRequest() {
   else
     urlQuery += "&origClientOrderId=" + m_userOrderID;
 
-  urlQuery += "&timestamp=" + QString::number(getGMTTimeMs());
+  urlQuery += "&timestamp=" +
+              QString::number(exchangeNowMs(exchange_name_e::binance,
+                                            trade_type_e::spot));
   auto const signature =
       hmac256_encode(urlQuery.toStdString(), m_apiSecret.toStdString(), true);
   urlQuery +=
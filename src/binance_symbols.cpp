@@ -1,16 +1,16 @@
 #include "binance_symbols.hpp"
+#include "decimal_parser.hpp"
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 
-static auto const binance_futures_tokens_url =
-    QString("https://") + korrelator::constants::binance_http_futures_host +
-    "/fapi/v1/ticker/price";
-static auto const binance_spot_tokens_url =
-    QString("https://") + korrelator::constants::binance_http_spot_host +
-    "/api/v3/ticker/price";
+// built on every call, the hosts may be overridden at startup
+static QString httpsUrl(char const *host, char const *target) {
+  return QString::fromStdString(korrelator::constants::httpsOrigin(host)) +
+         target;
+}
 
 namespace korrelator {
 
@@ -21,14 +21,16 @@ binance_symbols::binance_symbols(QNetworkAccessManager& networkManager)
 
 void binance_symbols::getFuturesSymbols(
     success_callback_t onSuccess, error_callback_t onError) {
-  return sendNetworkRequest(binance_futures_tokens_url, trade_type_e::futures,
-                            onSuccess, onError);
+  auto const url =
+      httpsUrl(constants::binance_http_futures_host, "/fapi/v1/ticker/price");
+  return sendNetworkRequest(url, trade_type_e::futures, onSuccess, onError);
 }
 
 void binance_symbols::getSpotsSymbols(
     success_callback_t onSuccess, error_callback_t onError) {
-  return sendNetworkRequest(binance_spot_tokens_url, trade_type_e::spot,
-                            onSuccess, onError);
+  auto const url =
+      httpsUrl(constants::binance_http_spot_host, "/api/v3/ticker/price");
+  return sendNetworkRequest(url, trade_type_e::spot, onSuccess, onError);
 }
 
 void binance_symbols::sendNetworkRequest(
@@ -65,8 +67,9 @@ void binance_symbols::sendNetworkRequest(
     for (int i = 0; i < list.size(); ++i) {
       auto const tokenObject = list[i].toObject();
       korrelator::token_t t;
-      t.realPrice = std::make_shared<double>(
-            tokenObject.value("price").toString().toDouble());
+      t.realPrice = std::make_shared<tick_slot_t>();
+      t.realPrice->store(
+          stringToDouble(tokenObject.value("price").toString()));
       t.symbolName = tokenObject.value("symbol").toString().toLower();
       t.exchange = exchange_name_e::binance;
       t.tradeType = tradeType;
@@ -86,9 +89,8 @@ void binance_symbols::getFuturesExchangeInfo(
     token_list_t *futuresContainerPtr,
     exchange_info_callback_t successCallback,
     error_callback_t onError) {
-  auto const fullUrl = QString("https://") +
-      korrelator::constants::binance_http_futures_host +
-      QString("/fapi/v1/exchangeInfo");
+  auto const fullUrl = httpsUrl(constants::binance_http_futures_host,
+                                "/fapi/v1/exchangeInfo");
   QNetworkRequest request(fullUrl);
   request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader,
                     "application/json");
@@ -139,11 +141,11 @@ void binance_symbols::getFuturesExchangeInfo(
           auto const filterType = filterObject.value("filterType").toString();
           if (filterType.compare("LOT_SIZE", Qt::CaseInsensitive) == 0) {
             iter->tickSize =
-                filterObject.value("stepSize").toString().toDouble();
+                stringToDouble(filterObject.value("stepSize").toString());
           } else if (filterType.compare("MIN_NOTIONAL", Qt::CaseInsensitive) ==
                      0) {
             iter->quoteMinSize =
-                filterObject.value("minNotional").toString().toDouble();
+                stringToDouble(filterObject.value("minNotional").toString());
           }
         }
       }
@@ -159,9 +161,8 @@ void binance_symbols::getSpotsExchangeInfo(
     token_list_t* spotsContainerPtr,
     exchange_info_callback_t successCallback,
     error_callback_t onError) {
-  auto const fullUrl = QString("https://") +
-      korrelator::constants::binance_http_spot_host +
-      QString("/api/v3/exchangeInfo");
+  auto const fullUrl = httpsUrl(constants::binance_http_spot_host,
+                                "/api/v3/exchangeInfo");
   QNetworkRequest request(fullUrl);
   request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader,
                     "application/json");
@@ -211,11 +212,11 @@ void binance_symbols::getSpotsExchangeInfo(
           auto const filterType = filterObject.value("filterType").toString();
           if (filterType.compare("LOT_SIZE", Qt::CaseInsensitive) == 0) {
             iter->tickSize =
-                filterObject.value("stepSize").toString().toDouble();
+                stringToDouble(filterObject.value("stepSize").toString());
           } else if (filterType.compare("MIN_NOTIONAL", Qt::CaseInsensitive) ==
                      0) {
             iter->quoteMinSize =
-                filterObject.value("minNotional").toString().toDouble();
+                stringToDouble(filterObject.value("minNotional").toString());
           }
         }
       }
@@ -7,48 +7,231 @@
 
 #include <rapidjson/document.h>
 
+#include "clock_sync.hpp"
+#include "decimal_parser.hpp"
+#include "depth_snapshot.hpp"
+#include "frame_journal.hpp"
+#include "frame_scanner.hpp"
+#include "tls_session_cache.hpp"
+
 namespace korrelator {
 
 binance_ws::~binance_ws() {
+  m_reconnectTimer.reset();
+  m_idleTimer.reset();
   m_resolver.reset();
   m_sslWebStream.reset();
-  m_readBuffer.reset();
-  m_writeBuffer.clear();
+  m_writeQueue.clear();
+  m_streams.clear();
+}
+
+// the streams a symbol's price line needs, depth is handled separately
+static void appendPriceStreams(std::vector<std::string> &streamNames,
+                               std::string const &tokenName,
+                               price_source_e const priceSource) {
+  if (priceSource == price_source_e::last_trade) {
+    streamNames.push_back(tokenName + "@aggTrade");
+    streamNames.push_back(tokenName + "@ticker");
+  } else {
+    streamNames.push_back(tokenName + "@bookTicker");
+  }
+}
+
+void binance_ws::addSubscription(QString const &tokenName,
+                                 tick_slot_t &priceResult,
+                                 price_source_e const priceSource) {
+  auto const name = tokenName.toLower().toStdString();
+  auto stream = findStream(name);
+  if (stream == nullptr) {
+    m_streams.push_back(stream_data_t{name});
+    stream = &m_streams.back();
+  }
+  auto &slots = stream->priceResults;
+  if (std::find(slots.begin(), slots.end(), &priceResult) == slots.end())
+    slots.push_back(&priceResult);
+  stream->priceSource = priceSource;
+  updateBookTickerCount();
+}
+
+void binance_ws::addOrderBook(QString const &tokenName, order_book_t &book) {
+  auto const name = tokenName.toLower().toStdString();
+  auto stream = findStream(name);
+  if (stream == nullptr) {
+    m_streams.push_back(stream_data_t{name});
+    stream = &m_streams.back();
+  }
+  stream->orderBook = &book;
+  m_hasOrderBooks = true;
+}
+
+void binance_ws::subscribe(QString const &tokenName, tick_slot_t &priceResult,
+                           price_source_e const priceSource) {
+  net::post(m_strand, [self = shared_from_this(),
+                       name = tokenName.toLower().toStdString(),
+                       price = &priceResult, priceSource]() mutable {
+    // when not connected, the new stream is part of the next handshake
+    bool const isConnected =
+        self->m_sslWebStream && self->m_sslWebStream->is_open();
+    auto stream = self->findStream(name);
+    if (stream == nullptr) {
+      self->m_streams.push_back(stream_data_t{name});
+      stream = &self->m_streams.back();
+    } else if (!stream->priceResults.empty() &&
+               stream->priceSource != priceSource && isConnected) {
+      self->sendSubscriptionRequest("UNSUBSCRIBE", *stream);
+    }
+
+    auto &slots = stream->priceResults;
+    bool const isNewSource =
+        slots.empty() || stream->priceSource != priceSource;
+    if (std::find(slots.begin(), slots.end(), price) == slots.end())
+      slots.push_back(price);
+    stream->priceSource = priceSource;
+    self->updateBookTickerCount();
+    if (isNewSource && isConnected)
+      self->sendSubscriptionRequest("SUBSCRIBE", *stream);
+  });
+}
+
+void binance_ws::unsubscribe(QString const &tokenName,
+                             tick_slot_t &priceResult) {
+  net::post(m_strand, [self = shared_from_this(),
+                       name = tokenName.toLower().toStdString(),
+                       price = &priceResult] {
+    auto &streams = self->m_streams;
+    auto iter = std::find_if(
+        streams.begin(), streams.end(),
+        [&name](stream_data_t const &s) { return s.tokenName == name; });
+    if (iter == streams.end())
+      return;
+    auto &slots = iter->priceResults;
+    auto const slot = std::find(slots.begin(), slots.end(), price);
+    if (slot == slots.end())
+      return;
+    slots.erase(slot);
+    // another slot still watches the symbol
+    if (!slots.empty())
+      return;
+
+    auto const stream = std::move(*iter);
+    streams.erase(iter);
+    self->updateBookTickerCount();
+    // the symbol's depth stream goes too, its order book is no longer fed
+    if (self->m_sslWebStream && self->m_sslWebStream->is_open())
+      self->sendSubscriptionRequest("UNSUBSCRIBE", stream,
+                                    stream.orderBook != nullptr);
+  });
+}
+
+void binance_ws::resubscribe(QString const &tokenName) {
+  net::post(m_strand, [self = shared_from_this(),
+                       name = tokenName.toLower().toStdString()] {
+    auto stream = self->findStream(name);
+    if (stream == nullptr || stream->priceResults.empty() ||
+        !self->m_sslWebStream || !self->m_sslWebStream->is_open())
+      return;
+    self->sendSubscriptionRequest("UNSUBSCRIBE", *stream);
+    self->sendSubscriptionRequest("SUBSCRIBE", *stream);
+  });
+}
+
+void binance_ws::forceReconnect() {
+  net::post(m_strand, [self = shared_from_this()] {
+    if (self->m_requestedToStop || !self->m_sslWebStream ||
+        !self->m_sslWebStream->is_open())
+      return;
+    qDebug() << "Forcing a reconnect of" << self->m_host.c_str() << "feed"
+             << self->m_feedIndex;
+    // the pending read is aborted and ignored, the reconnect starts afresh
+    self->scheduleReconnect();
+  });
+}
+
+void binance_ws::close(std::function<void()> onClosed) {
+  net::post(m_strand, [self = shared_from_this(),
+                       onClosed = std::move(onClosed)]() mutable {
+    self->m_requestedToStop = true;
+    if (self->m_reconnectTimer)
+      self->m_reconnectTimer->cancel();
+    if (self->m_idleTimer)
+      self->m_idleTimer->cancel();
+    if (!self->m_sslWebStream || !self->m_sslWebStream->is_open())
+      return onClosed();
+    // the pending read ends with `closed`, which no longer reconnects
+    self->m_sslWebStream->async_close(
+        beast::websocket::close_code::normal,
+        [onClosed = std::move(onClosed)](beast::error_code const) {
+          onClosed();
+        });
+  });
+}
+
+void binance_ws::updateBookTickerCount() {
+  m_bookTickerCount = static_cast<size_t>(
+      std::count_if(m_streams.begin(), m_streams.end(),
+                    [](stream_data_t const &stream) {
+                      return !stream.priceResults.empty() &&
+                             stream.priceSource != price_source_e::last_trade;
+                    }));
+}
+
+binance_ws::stream_data_t *
+binance_ws::findStream(std::string const &streamName) {
+  // stream names are of the form "btcusdt@aggTrade", the price slot
+  // is keyed by the symbol part only
+  auto const symbolLength = std::min(streamName.find('@'), streamName.size());
+  for (auto &stream : m_streams) {
+    if (stream.tokenName.size() == symbolLength &&
+        streamName.compare(0, symbolLength, stream.tokenName) == 0)
+      return &stream;
+  }
+  return nullptr;
 }
 
 void binance_ws::startFetching() {
   if (m_requestedToStop)
     return;
 
-  m_resolver.emplace(m_ioContext);
+  m_writeQueue.clear();
+  // depth events missed while reconnecting can't be recovered
+  resetOrderBooks();
+  if (auto endpoints = dns_cache_t::instance().lookup(m_host, m_port))
+    return websockConnectToResolvedNames(std::move(*endpoints));
+
+  m_resolver.emplace(m_strand);
   m_resolver->async_resolve(
       m_host, m_port,
       [self = shared_from_this()](auto const error_code,
                                   results_type const &results) {
         if (error_code) {
           qDebug() << error_code.message().c_str();
-          return;
+          return self->scheduleReconnect();
         }
-        self->websockConnectToResolvedNames(results);
+        self->websockConnectToResolvedNames(
+            dns_cache_t::instance().store(self->m_host, self->m_port, results));
       });
 }
 
 void binance_ws::websockConnectToResolvedNames(
-    resolver_result_type const &resolvedNames) {
+    dns_cache_t::endpoints_t endpoints) {
   m_resolver.reset();
-  m_sslWebStream.emplace(m_ioContext, m_sslContext);
+  rotateForFeed(endpoints, m_feedIndex);
+
+  m_sslWebStream.emplace(m_strand, m_sslContext);
   beast::get_lowest_layer(*m_sslWebStream)
       .expires_after(std::chrono::seconds(30));
   beast::get_lowest_layer(*m_sslWebStream)
       .async_connect(
-          resolvedNames,
-          [self = shared_from_this()](
+          endpoints,
+          [self = shared_from_this(),
+           started = std::chrono::steady_clock::now()](
               auto const &errorCode,
               resolver_result_type::endpoint_type const &connectedName) {
             if (errorCode) {
               qDebug() << errorCode.message().c_str();
-              return;
+              return self->scheduleReconnect();
             }
+            dns_cache_t::instance().recordConnect(connectedName, started);
             self->websockPerformSslHandshake(connectedName);
           });
 }
@@ -67,69 +250,176 @@ void binance_ws::websockPerformSslHandshake(
     auto const ec = beast::error_code(static_cast<int>(::ERR_get_error()),
                                       net::error::get_ssl_category());
     qDebug() << ec.message().c_str();
-    return;
+    return scheduleReconnect();
   }
   negotiateWebsocketConnection();
 }
 
 void binance_ws::negotiateWebsocketConnection() {
+  auto const started = tls_session_cache_t::instance().beforeHandshake(
+      m_sslWebStream->next_layer().native_handle());
   m_sslWebStream->next_layer().async_handshake(
       net::ssl::stream_base::client,
-      [self = shared_from_this()](beast::error_code const ec) {
+      [self = shared_from_this(), started](beast::error_code const ec) {
         if (ec) {
           qDebug() << ec.message().c_str();
-          return;
+          return self->scheduleReconnect();
         }
+        tls_session_cache_t::instance().afterHandshake(
+            self->m_sslWebStream->next_layer().native_handle(), started);
         beast::get_lowest_layer(*self->m_sslWebStream).expires_never();
         self->performWebsocketHandshake();
       });
 }
 
 void binance_ws::performWebsocketHandshake() {
-  auto const urlPath = "/stream?streams=" + m_tokenName.tokenName + "@aggTrade";
+  // every symbol rides on the same connection as a combined stream. With
+  // every symbol unsubscribed the connection stays open without any, the
+  // next `subscribe` adds its streams with a SUBSCRIBE request.
+  std::string urlPath = "/stream";
+  bool hasStreams = false;
+  for (auto const &stream : m_streams) {
+    std::vector<std::string> streamNames;
+    if (!stream.priceResults.empty())
+      appendPriceStreams(streamNames, stream.tokenName, stream.priceSource);
+    if (stream.orderBook)
+      streamNames.push_back(stream.tokenName + "@depth@100ms");
+    for (auto const &streamName : streamNames) {
+      urlPath += std::exchange(hasStreams, true) ? "/" : "?streams=";
+      urlPath += streamName;
+    }
+  }
 
   auto opt = beast::websocket::stream_base::timeout();
-  opt.idle_timeout = std::chrono::seconds(50);
+  opt.idle_timeout = beast::websocket::stream_base::none();
   opt.handshake_timeout = std::chrono::seconds(20);
-  opt.keep_alive_pings = true;
   m_sslWebStream->set_option(opt);
-
+  // pongs count as activity for the idle timer
   m_sslWebStream->control_callback(
-      [self = shared_from_this()](auto const frame_type, auto const &) {
-        if (frame_type == beast::websocket::frame_type::close) {
-          self->m_sslWebStream.reset();
-          return self->startFetching();
-        }
+      [this](beast::websocket::frame_type const, beast::string_view) {
+        m_readSinceIdleCheck = true;
       });
 
+  // a close frame completes the pending read with an error, which
+  // reconnects from there
+
   m_sslWebStream->async_handshake(
-      m_host, urlPath.toStdString(),
+      m_host, urlPath,
       [self = shared_from_this()](beast::error_code const ec) {
         if (ec) {
           qDebug() << ec.message().c_str();
-          return;
+          return self->scheduleReconnect();
         }
 
+        self->m_backoff.reset();
+        self->startIdleTimer();
         self->waitForMessages();
       });
 }
 
+void binance_ws::startIdleTimer() {
+  m_readSinceIdleCheck = false;
+  m_idlePingSent = false;
+  m_idleTimer.emplace(m_strand);
+  waitForIdleTimer();
+}
+
+// Half of a 50s idle timeout: a quiet connection is pinged after one silent
+// period and reconnected after the second one.
+void binance_ws::waitForIdleTimer() {
+  m_idleTimer->expires_after(std::chrono::seconds(25));
+  m_idleTimer->async_wait(
+      [self = shared_from_this()](beast::error_code const ec) {
+        self->onIdleTimerTick(ec);
+      });
+}
+
+void binance_ws::onIdleTimerTick(beast::error_code const &ec) {
+  if (ec || m_requestedToStop || !m_sslWebStream)
+    return;
+
+  if (std::exchange(m_readSinceIdleCheck, false)) {
+    m_idlePingSent = false;
+  } else if (!std::exchange(m_idlePingSent, true)) {
+    // a failed ping is left to the read loop
+    m_sslWebStream->async_ping({}, [](beast::error_code const) {});
+  } else {
+    qDebug() << "Idle timeout on" << m_host.c_str() << "feed" << m_feedIndex;
+    return scheduleReconnect();
+  }
+  waitForIdleTimer();
+}
+
+void binance_ws::scheduleReconnect() {
+  if (m_requestedToStop)
+    return;
+
+  m_idleTimer.reset();
+  m_sslWebStream.reset();
+  m_framesWaiting = false;
+  if (m_heldPriceCount != 0)
+    storeHeldPrices();
+  auto const delay = m_backoff.nextDelay();
+  qDebug() << "Reconnecting" << m_host.c_str() << "feed" << m_feedIndex
+           << "in" << delay.count() << "ms";
+  m_reconnectTimer.emplace(m_strand);
+  m_reconnectTimer->expires_after(delay);
+  m_reconnectTimer->async_wait(
+      [self = shared_from_this()](beast::error_code const ec) {
+        if (!ec)
+          self->startFetching();
+      });
+}
+
 void binance_ws::waitForMessages() {
-  m_readBuffer.emplace();
+  bool const holdsPrices = m_heldPriceCount != 0;
+  if (holdsPrices && !m_framesWaiting)
+    storeHeldPrices();
+  // drop the last frame but keep the memory, the loop shouldn't allocate
+  m_readBuffer.consume(m_readBuffer.size());
   m_sslWebStream->async_read(
-      *m_readBuffer,
-      [self = shared_from_this()](beast::error_code const error_code,
-                                  std::size_t const) {
-        if (error_code == net::error::operation_aborted) {
-          qDebug() << error_code.message().c_str();
-          return;
-        } else if (error_code) {
-          qDebug() << error_code.message().c_str();
-          self->m_sslWebStream.reset();
-          return self->startFetching();
-        }
-        self->interpretGenericMessages();
-      });
+      m_readBuffer,
+      makeRecyclingHandler(
+          m_handlerMemory,
+          [self = shared_from_this()](beast::error_code const error_code,
+                                      std::size_t const) {
+            if (error_code == net::error::operation_aborted) {
+              qDebug() << error_code.message().c_str();
+              return;
+            } else if (error_code) {
+              qDebug() << error_code.message().c_str();
+              return self->scheduleReconnect();
+            }
+            self->interpretGenericMessages();
+          }));
+  // after the read, which may complete at once from a buffered frame
+  if (holdsPrices && m_framesWaiting) {
+    if (!std::exchange(m_heldPriceFlushPosted, true))
+      postHeldPriceFlush();
+    else
+      m_readSinceFlushPosted = true;
+  }
+}
+
+// see `held_price_t`
+void binance_ws::postHeldPriceFlush() {
+  net::post(m_ioContext, makeRecyclingHandler(m_handlerMemory, [this] {
+    net::dispatch(m_strand, makeRecyclingHandler(m_handlerMemory, [this] {
+      if (m_requestedToStop || m_heldPriceCount == 0) {
+        m_heldPriceFlushPosted = false;
+        m_readSinceFlushPosted = false;
+        m_quietFlushPasses = 0;
+        return;
+      }
+      if (std::exchange(m_readSinceFlushPosted, false))
+        m_quietFlushPasses = 0;
+      if (++m_quietFlushPasses < 2)
+        return postHeldPriceFlush();
+      m_heldPriceFlushPosted = false;
+      m_quietFlushPasses = 0;
+      storeHeldPrices();
+    }));
+  }));
 }
 
 void binance_ws::interpretGenericMessages() {
@@ -137,40 +427,134 @@ void binance_ws::interpretGenericMessages() {
     return;
 
   char const *bufferCstr =
-      static_cast<char const *>(m_readBuffer->cdata().data());
-  auto const optPrice = binanceGetCoinPrice(bufferCstr, m_readBuffer->size());
-  if (optPrice != -1.0)
-    m_priceResult = optPrice;
+      static_cast<char const *>(m_readBuffer.cdata().data());
+  auto const receiveTimeNs = steadyNowNs();
+  m_readSinceIdleCheck = true;
+  m_latency.onFrame(receiveTimeNs);
+  if (m_journal)
+    m_journal->append(bufferCstr, m_readBuffer.size(), receiveTimeNs);
+  m_framesWaiting = m_conflating && moreFramesWaiting(*m_sslWebStream);
+  if (m_bookTickerCount != 0 &&
+      interpretBookTicker(bufferCstr, m_readBuffer.size(), receiveTimeNs))
+    return waitForMessages();
+
+  std::int64_t eventTimeMs = 0;
+  std::int64_t updateId = 0;
+  auto const optPrice =
+      binanceGetCoinPrice(bufferCstr, m_readBuffer.size(), m_lastStreamName,
+                          eventTimeMs, updateId);
+  if (optPrice != -1.0) {
+    m_latency.onTick(eventTimeMs,
+                     steadyToExchangeUs(exchange_name_e::binance, m_tradeType,
+                                        receiveTimeNs));
+    if (auto stream = findStream(m_lastStreamName);
+        stream != nullptr && !stream->priceResults.empty() &&
+        isFirstCopy(updateId))
+      storePrice(*stream, optPrice, eventTimeMs, receiveTimeNs);
+  } else if (m_hasOrderBooks) {
+    interpretDepthMessage(bufferCstr, m_readBuffer.size());
+  }
 
-  if (!m_tokenName.subscribed)
-    return makeSubscription();
   waitForMessages();
 }
 
-void binance_ws::makeSubscription() {
-  m_writeBuffer = QString(R"(
+bool binance_ws::interpretBookTicker(char const *str, size_t const size,
+                                     std::int64_t const receiveTimeNs) {
+  book_ticker_t ticker;
+  std::int64_t eventTimeMs = 0;
+  std::int64_t updateId = 0;
+  if (!binanceGetBookTicker(str, size, m_lastStreamName, ticker, eventTimeMs,
+                            updateId))
+    return false;
+
+  m_latency.onTick(eventTimeMs,
+                   steadyToExchangeUs(exchange_name_e::binance, m_tradeType,
+                                      receiveTimeNs));
+  auto stream = findStream(m_lastStreamName);
+  if (stream == nullptr || stream->priceResults.empty() ||
+      !isFirstCopy(updateId))
+    return true;
+  auto const price = stream->priceSource == price_source_e::micro_price
+                         ? ticker.microPrice()
+                         : ticker.mid();
+  storePrice(*stream, price, eventTimeMs, receiveTimeNs);
+  return true;
+}
+
+void binance_ws::storePrice(stream_data_t &stream, double const price,
+                            std::int64_t const eventTimeMs,
+                            std::int64_t const receiveTimeNs) {
+  auto &held = stream.heldPrice;
+  if (held.isHeld)
+    m_conflatedFrames.fetch_add(1, std::memory_order_relaxed);
+  if (m_framesWaiting) {
+    if (!held.isHeld)
+      ++m_heldPriceCount;
+    held = held_price_t{price, eventTimeMs, receiveTimeNs, true};
+    return;
+  }
+  if (held.isHeld) {
+    held.isHeld = false;
+    --m_heldPriceCount;
+  }
+  for (auto slot : stream.priceResults)
+    slot->store(price, eventTimeMs, receiveTimeNs);
+}
+
+void binance_ws::storeHeldPrices() {
+  for (auto &stream : m_streams) {
+    auto &held = stream.heldPrice;
+    if (!held.isHeld)
+      continue;
+    held.isHeld = false;
+    for (auto slot : stream.priceResults)
+      slot->store(held.price, held.eventTimeMs, held.receiveTimeNs);
+  }
+  // streams unsubscribed while holding a price are already gone
+  m_heldPriceCount = 0;
+}
+
+void binance_ws::sendSubscriptionRequest(char const *method,
+                                         stream_data_t const &stream,
+                                         bool const withDepth) {
+  std::vector<std::string> streamNames;
+  appendPriceStreams(streamNames, stream.tokenName, stream.priceSource);
+  if (withDepth)
+    streamNames.push_back(stream.tokenName + "@depth@100ms");
+  QString params;
+  for (auto const &streamName : streamNames) {
+    if (!params.isEmpty())
+      params += ", ";
+    params += QString("\"%1\"").arg(streamName.c_str());
+  }
+
+  m_writeQueue.push_back(QString(R"(
     {
-      "method": "SUBSCRIBE",
-      "params":
-      [
-        "%1@ticker",
-        "%1@aggTrade"
-      ],
-      "id": 10
+      "method": "%1",
+      "params": [ %2 ],
+      "id": %3
     })")
-                      .arg(m_tokenName.tokenName)
-                      .toStdString();
+                             .arg(method, params)
+                             .arg(++m_requestID)
+                             .toStdString());
+
+  // only one write may be outstanding on a websocket at any time
+  if (m_writeQueue.size() == 1)
+    writeNextMessage();
+}
 
+void binance_ws::writeNextMessage() {
   m_sslWebStream->async_write(
-      net::buffer(m_writeBuffer),
+      net::buffer(m_writeQueue.front()),
       [self = shared_from_this()](auto const errCode, size_t const) {
         if (errCode) {
           qDebug() << errCode.message().c_str();
           return;
         }
-        self->m_writeBuffer.clear();
-        self->m_tokenName.subscribed = true;
-        self->waitForMessages();
+        if (!self->m_writeQueue.empty())
+          self->m_writeQueue.pop_front();
+        if (!self->m_writeQueue.empty())
+          self->writeNextMessage();
       });
 }
 
@@ -178,15 +562,21 @@ void binance_ws::makeSubscription() {
 #undef GetObject
 #endif
 
-double binanceGetCoinPrice(char const *str, size_t const size) {
+static double binanceGetCoinPriceDOM(char const *str, size_t const size,
+                                     std::string &streamName,
+                                     std::int64_t &eventTimeMs,
+                                     std::int64_t &updateId) {
   rapidjson::Document d;
   d.Parse(str, size);
 
   try {
     auto const jsonObject = d.GetObject();
+    auto const streamIter = jsonObject.FindMember("stream");
     auto iter = jsonObject.FindMember("data");
-    if (iter == jsonObject.end())
+    if (iter == jsonObject.end() || streamIter == jsonObject.end())
       return -1.0;
+    streamName.assign(streamIter->value.GetString(),
+                      streamIter->value.GetStringLength());
     auto const dataObject = iter->value.GetObject();
     auto const typeIter = dataObject.FindMember("e");
     if (typeIter == dataObject.MemberEnd()) {
@@ -194,15 +584,23 @@ double binanceGetCoinPrice(char const *str, size_t const size) {
       return -1.0;
     }
 
+    if (auto const timeIter = dataObject.FindMember("E");
+        timeIter != dataObject.MemberEnd() && timeIter->value.IsInt64())
+      eventTimeMs = timeIter->value.GetInt64();
+
     std::string const type = typeIter->value.GetString();
     bool const is24HrTicker =
         type.length() == 10 && type[0] == '2' && type.back() == 'r';
     bool const isAggregateTrade = type.length() == 8 && type[0] == 'a' &&
                                   type[3] == 'T' && type.back() == 'e';
     if (is24HrTicker || isAggregateTrade) {
+      auto const idIter =
+          dataObject.FindMember(isAggregateTrade ? "a" : "L");
+      if (idIter != dataObject.MemberEnd() && idIter->value.IsInt64())
+        updateId = idIter->value.GetInt64();
       char const *amountStr = isAggregateTrade ? "p" : "c";
       auto const amount =
-          std::atof(dataObject.FindMember(amountStr)->value.GetString());
+          stringToDouble(dataObject.FindMember(amountStr)->value.GetString());
       return amount;
     }
   } catch (...) {
@@ -211,4 +609,298 @@ double binanceGetCoinPrice(char const *str, size_t const size) {
   return -1.0;
 }
 
+double binanceGetCoinPrice(char const *str, size_t const size,
+                           std::string &streamName, std::int64_t &eventTimeMs,
+                           std::int64_t &updateId) {
+  char const *cursor = str;
+  char const *const last = str + size;
+  json_field_t header[] = {{"stream"}, {"e"}, {"E"}};
+  auto result = scanJsonFields(cursor, last, header);
+  if (result == scan_result_e::malformed)
+    return binanceGetCoinPriceDOM(str, size, streamName, eventTimeMs,
+                                  updateId);
+  if (result == scan_result_e::missing)
+    return -1.0;
+
+  auto const type = header[1].value;
+  if (!parseInteger(header[2].value, eventTimeMs))
+    eventTimeMs = 0;
+  bool const isAggregateTrade = type == "aggTrade";
+  if (!isAggregateTrade && type != "24hrTicker")
+    return -1.0;
+
+  // the price field comes after the event type in both payloads, followed
+  // by the aggregate trade id or the ticker's last trade id
+  json_field_t price[] = {{isAggregateTrade ? "p" : "c"},
+                          {isAggregateTrade ? "a" : "L"}};
+  result = scanJsonFields(cursor, last, price);
+  if (result == scan_result_e::malformed)
+    return binanceGetCoinPriceDOM(str, size, streamName, eventTimeMs,
+                                  updateId);
+
+  double amount = -1.0;
+  if (!price[0].found || !parseDouble(price[0].value, amount))
+    return -1.0;
+  if (!price[1].found || !parseInteger(price[1].value, updateId))
+    updateId = 0;
+  streamName.assign(header[0].value.data(), header[0].value.size());
+  return amount;
+}
+
+static bool binanceGetBookTickerDOM(char const *str, size_t const size,
+                                    book_ticker_t &ticker,
+                                    std::int64_t &eventTimeMs,
+                                    std::int64_t &updateId) {
+  rapidjson::Document d;
+  d.Parse(str, size);
+  if (!d.IsObject())
+    return false;
+
+  auto const dataIter = d.FindMember("data");
+  if (dataIter == d.MemberEnd() || !dataIter->value.IsObject())
+    return false;
+  auto const &data = dataIter->value;
+  char const *const keys[4] = {"b", "B", "a", "A"};
+  double *const values[4] = {&ticker.bidPrice, &ticker.bidQuantity,
+                             &ticker.askPrice, &ticker.askQuantity};
+  for (int i = 0; i < 4; ++i) {
+    auto const iter = data.FindMember(keys[i]);
+    if (iter == data.MemberEnd() || !iter->value.IsString())
+      return false;
+    *values[i] = stringToDouble(iter->value.GetString());
+  }
+  eventTimeMs = updateId = 0;
+  if (auto const iter = data.FindMember("E");
+      iter != data.MemberEnd() && iter->value.IsInt64())
+    eventTimeMs = iter->value.GetInt64();
+  if (auto const iter = data.FindMember("u");
+      iter != data.MemberEnd() && iter->value.IsInt64())
+    updateId = iter->value.GetInt64();
+  return true;
+}
+
+bool binanceGetBookTicker(char const *str, size_t const size,
+                          std::string &streamName, book_ticker_t &ticker,
+                          std::int64_t &eventTimeMs, std::int64_t &updateId) {
+  static constexpr std::string_view suffix = "@bookTicker";
+  char const *cursor = str;
+  char const *const last = str + size;
+
+  // "stream" is the first key of a combined frame, so other frames cost
+  // only a few bytes of scanning here
+  json_field_t stream[] = {{"stream"}};
+  auto result = scanJsonFields(cursor, last, stream);
+  auto const streamValue = stream[0].value;
+  if (result != scan_result_e::found || streamValue.size() <= suffix.size() ||
+      streamValue.substr(streamValue.size() - suffix.size()) != suffix)
+    return false;
+  streamName.assign(streamValue.data(), streamValue.size());
+
+  // futures frames also carry the event time, spot frames don't
+  json_field_t fields[] = {{"b"}, {"B"}, {"a"}, {"A"}, {"E"}, {"u"}};
+  result = scanJsonFields(cursor, last, fields);
+  if (result == scan_result_e::malformed)
+    return binanceGetBookTickerDOM(str, size, ticker, eventTimeMs, updateId);
+  if (!fields[0].found || !fields[1].found || !fields[2].found ||
+      !fields[3].found || !parseDouble(fields[0].value, ticker.bidPrice) ||
+      !parseDouble(fields[1].value, ticker.bidQuantity) ||
+      !parseDouble(fields[2].value, ticker.askPrice) ||
+      !parseDouble(fields[3].value, ticker.askQuantity))
+    return false;
+  if (!fields[4].found || !parseInteger(fields[4].value, eventTimeMs))
+    eventTimeMs = 0;
+  if (!fields[5].found || !parseInteger(fields[5].value, updateId))
+    updateId = 0;
+  return true;
+}
+
+// [["price", "quantity"], ...]
+static bool binanceReadLevels(rapidjson::Value const &levels,
+                              book_side_e const side,
+                              std::vector<level_update_t> &result) {
+  if (!levels.IsArray())
+    return false;
+  for (auto const &levelJson : levels.GetArray()) {
+    if (!levelJson.IsArray())
+      return false;
+    auto const level = levelJson.GetArray();
+    if (level.Size() < 2 || !level[0].IsString() || !level[1].IsString())
+      return false;
+    level_update_t update;
+    update.side = side;
+    if (!parseDouble(std::string_view(level[0].GetString(),
+                                      level[0].GetStringLength()),
+                     update.price) ||
+        !parseDouble(std::string_view(level[1].GetString(),
+                                      level[1].GetStringLength()),
+                     update.quantity))
+      return false;
+    result.push_back(update);
+  }
+  return true;
+}
+
+void binance_ws::interpretDepthMessage(char const *str, size_t const size) {
+  rapidjson::Document d;
+  d.Parse(str, size);
+  if (!d.IsObject())
+    return;
+
+  auto const streamIter = d.FindMember("stream");
+  auto const dataIter = d.FindMember("data");
+  if (streamIter == d.MemberEnd() || dataIter == d.MemberEnd() ||
+      !streamIter->value.IsString() || !dataIter->value.IsObject())
+    return;
+
+  auto const &data = dataIter->value;
+  auto const typeIter = data.FindMember("e");
+  if (typeIter == data.MemberEnd() || !typeIter->value.IsString() ||
+      std::string_view(typeIter->value.GetString()) != "depthUpdate")
+    return;
+
+  auto stream = findStream(streamIter->value.GetString());
+  if (stream == nullptr || stream->orderBook == nullptr)
+    return;
+
+  depth_event_t event;
+  auto const firstIter = data.FindMember("U");
+  auto const finalIter = data.FindMember("u");
+  if (firstIter == data.MemberEnd() || finalIter == data.MemberEnd() ||
+      !firstIter->value.IsInt64() || !finalIter->value.IsInt64())
+    return;
+  event.firstUpdateId = firstIter->value.GetInt64();
+  event.finalUpdateId = finalIter->value.GetInt64();
+  if (auto const iter = data.FindMember("pu");
+      iter != data.MemberEnd() && iter->value.IsInt64())
+    event.previousFinalUpdateId = iter->value.GetInt64();
+
+  auto const bidsIter = data.FindMember("b");
+  auto const asksIter = data.FindMember("a");
+  if (bidsIter == data.MemberEnd() || asksIter == data.MemberEnd() ||
+      !binanceReadLevels(bidsIter->value, book_side_e::bid, event.updates) ||
+      !binanceReadLevels(asksIter->value, book_side_e::ask, event.updates))
+    return;
+
+  if (stream->orderBook->isSynced())
+    return applyDepthEvent(*stream, std::move(event));
+
+  static constexpr size_t maxPendingEvents = 2'000;
+  if (stream->pendingDepth.size() >= maxPendingEvents)
+    stream->pendingDepth.erase(stream->pendingDepth.begin());
+  stream->pendingDepth.push_back(std::move(event));
+  requestDepthSnapshot(*stream);
+}
+
+// https://binance-docs.github.io/apidocs/spot/en/#how-to-manage-a-local-order-book-correctly
+void binance_ws::applyDepthEvent(stream_data_t &stream,
+                                 depth_event_t &&event) {
+  auto &book = *stream.orderBook;
+  auto const lastUpdateId = book.sequence();
+  bool const isSpot = m_tradeType == trade_type_e::spot;
+  if (isSpot ? event.finalUpdateId <= lastUpdateId
+             : event.finalUpdateId < lastUpdateId)
+    return;
+
+  bool inSequence = false;
+  if (stream.awaitingFirstDepth) {
+    auto const expected = isSpot ? lastUpdateId + 1 : lastUpdateId;
+    inSequence = event.firstUpdateId <= expected &&
+                 event.finalUpdateId >= expected;
+  } else if (isSpot) {
+    inSequence = event.firstUpdateId == lastUpdateId + 1;
+  } else {
+    inSequence = event.previousFinalUpdateId == lastUpdateId;
+  }
+
+  if (!inSequence) {
+    qDebug() << "Depth gap on" << stream.tokenName.c_str() << "resyncing";
+    book.invalidate();
+    stream.awaitingFirstDepth = false;
+    stream.pendingDepth.push_back(std::move(event));
+    return requestDepthSnapshot(stream);
+  }
+
+  stream.awaitingFirstDepth = false;
+  book.applyUpdates(event.updates, event.finalUpdateId);
+}
+
+void binance_ws::requestDepthSnapshot(stream_data_t &stream) {
+  if (stream.snapshotInFlight || m_requestedToStop)
+    return;
+
+  stream.snapshotInFlight = true;
+  bool const isSpot = m_tradeType == trade_type_e::spot;
+  auto symbol = QString::fromStdString(stream.tokenName).toUpper();
+  auto const target = QString(isSpot ? "/api/v3/depth?symbol=%1&limit=1000"
+                                     : "/fapi/v1/depth?symbol=%1&limit=1000")
+                          .arg(symbol)
+                          .toStdString();
+  std::make_shared<depth_snapshot_request_t>(
+      m_strand, m_sslContext,
+      isSpot ? constants::binance_http_spot_host
+             : constants::binance_http_futures_host,
+      target,
+      [self = shared_from_this(), name = stream.tokenName](
+          std::string const &body) { self->onDepthSnapshot(name, body); })
+      ->run();
+}
+
+void binance_ws::onDepthSnapshot(std::string const &tokenName,
+                                 std::string const &body) {
+  auto stream = findStream(tokenName);
+  if (m_requestedToStop || stream == nullptr || stream->orderBook == nullptr)
+    return;
+  // on failure, the next depth event asks for another snapshot
+  stream->snapshotInFlight = false;
+  if (body.empty())
+    return;
+
+  rapidjson::Document d;
+  d.Parse(body.c_str(), body.size());
+  if (!d.IsObject())
+    return;
+
+  auto const idIter = d.FindMember("lastUpdateId");
+  auto const bidsIter = d.FindMember("bids");
+  auto const asksIter = d.FindMember("asks");
+  if (idIter == d.MemberEnd() || bidsIter == d.MemberEnd() ||
+      asksIter == d.MemberEnd() || !idIter->value.IsInt64())
+    return;
+
+  std::vector<level_update_t> levels;
+  if (!binanceReadLevels(bidsIter->value, book_side_e::bid, levels) ||
+      !binanceReadLevels(asksIter->value, book_side_e::ask, levels)) {
+    qDebug() << "Invalid depth snapshot" << body.c_str();
+    return;
+  }
+
+  std::vector<price_level_t> bids, asks;
+  for (auto const &level : levels)
+    (level.side == book_side_e::bid ? bids : asks)
+        .push_back({level.price, level.quantity});
+  stream->orderBook->applySnapshot(std::move(bids), std::move(asks),
+                                   idIter->value.GetInt64());
+  stream->awaitingFirstDepth = true;
+
+  auto pending = std::move(stream->pendingDepth);
+  stream->pendingDepth.clear();
+  for (auto &event : pending) {
+    // a gap in the buffer starts another resync, keep what follows it
+    if (!stream->orderBook->isSynced())
+      stream->pendingDepth.push_back(std::move(event));
+    else
+      applyDepthEvent(*stream, std::move(event));
+  }
+}
+
+void binance_ws::resetOrderBooks() {
+  for (auto &stream : m_streams) {
+    if (stream.orderBook == nullptr)
+      continue;
+    stream.orderBook->invalidate();
+    stream.pendingDepth.clear();
+    stream.awaitingFirstDepth = false;
+  }
+}
+
 } // namespace korrelator
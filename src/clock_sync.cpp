@@ -0,0 +1,307 @@
+#include "clock_sync.hpp"
+
+#include <QDebug>
+
+#include <boost/asio/ssl/context.hpp>
+#include <boost/beast/http/read.hpp>
+#include <boost/beast/http/write.hpp>
+#include <rapidjson/document.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+#include "constants.hpp"
+#include "tick_ring.hpp"
+#include "tls_session_cache.hpp"
+
+namespace korrelator {
+
+namespace {
+
+struct clock_anchor_t {
+  std::int64_t systemNs;
+  std::int64_t steadyNs;
+};
+
+clock_anchor_t const &clockAnchor() {
+  static clock_anchor_t const anchor{
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count(),
+      steadyNowNs()};
+  return anchor;
+}
+
+// [exchange][trade type], microseconds
+std::atomic<std::int64_t> exchangeOffsetsUs[2][2]{};
+
+std::atomic<std::int64_t> &offsetOf(exchange_name_e const exchange,
+                                    trade_type_e const tradeType) {
+  return exchangeOffsetsUs[exchange == exchange_name_e::kucoin ? 1 : 0]
+                          [tradeType == trade_type_e::futures ? 1 : 0];
+}
+
+// how much a new offset sample moves the filtered one
+constexpr double offsetSmoothing = 0.3;
+// larger jumps are taken as they are, smoothing would only delay them
+constexpr std::int64_t offsetStepUs = 1'000'000;
+constexpr int samplesPerProbe = 8;
+constexpr auto probeInterval = std::chrono::minutes(1);
+
+} // namespace
+
+std::int64_t localNowUs() { return steadyToLocalUs(steadyNowNs()); }
+
+std::int64_t steadyToLocalUs(std::int64_t const steadyTimeNs) {
+  return steadyToLocalNs(steadyTimeNs) / 1'000;
+}
+
+std::int64_t steadyToLocalNs(std::int64_t const steadyTimeNs) {
+  auto const &anchor = clockAnchor();
+  return anchor.systemNs + (steadyTimeNs - anchor.steadyNs);
+}
+
+std::int64_t exchangeNowMs(exchange_name_e const exchange,
+                           trade_type_e const tradeType) {
+  return steadyToExchangeUs(exchange, tradeType, steadyNowNs()) / 1'000;
+}
+
+std::int64_t steadyToExchangeUs(exchange_name_e const exchange,
+                                trade_type_e const tradeType,
+                                std::int64_t const steadyTimeNs) {
+  return steadyToLocalUs(steadyTimeNs) +
+         offsetOf(exchange, tradeType).load(std::memory_order_relaxed);
+}
+
+std::int64_t exchangeClockOffsetUs(exchange_name_e const exchange,
+                                   trade_type_e const tradeType) {
+  return offsetOf(exchange, tradeType).load(std::memory_order_relaxed);
+}
+
+// "serverTime" on Binance, "data" on KuCoin
+static bool parseServerTime(std::string const &body, std::int64_t &timeMs) {
+  rapidjson::Document doc;
+  doc.Parse(body.c_str(), body.size());
+  if (doc.HasParseError() || !doc.IsObject())
+    return false;
+  for (auto const name : {"serverTime", "data"}) {
+    if (auto const iter = doc.FindMember(name);
+        iter != doc.MemberEnd() && iter->value.IsInt64()) {
+      timeMs = iter->value.GetInt64();
+      return true;
+    }
+  }
+  return false;
+}
+
+clock_probe_t::clock_probe_t(strand_t strand, net::ssl::context &sslContext,
+                             std::string host, std::string target,
+                             int const sampleCount, callback_t callback)
+    : m_strand(std::move(strand)), m_sslContext(sslContext),
+      m_host(std::move(host)), m_target(std::move(target)),
+      m_sampleCount(sampleCount), m_callback(std::move(callback)) {}
+
+void clock_probe_t::run() {
+  if (auto endpoints =
+          dns_cache_t::instance().lookup(m_host, constants::https_port)) {
+    return net::post(m_strand, [self = shared_from_this(),
+                                endpoints = std::move(*endpoints)] {
+      self->connect(endpoints);
+    });
+  }
+
+  m_resolver.emplace(m_strand);
+  m_resolver->async_resolve(
+      m_host, constants::https_port,
+      [self = shared_from_this()](auto const errorCode,
+                                  resolver::results_type const &results) {
+        if (errorCode)
+          return self->fail("resolve", errorCode);
+        self->connect(dns_cache_t::instance().store(
+            self->m_host, constants::https_port, results));
+      });
+}
+
+void clock_probe_t::connect(
+    dns_cache_t::endpoints_t const &resolvedNames) {
+  m_resolver.reset();
+  m_sslStream.emplace(m_strand, m_sslContext);
+  beast::get_lowest_layer(*m_sslStream).expires_after(std::chrono::seconds(15));
+  beast::get_lowest_layer(*m_sslStream)
+      .async_connect(resolvedNames,
+                     [self = shared_from_this(),
+                      started = std::chrono::steady_clock::now()](
+                         auto const errorCode,
+                         resolver::results_type::endpoint_type const &ip) {
+                       if (errorCode)
+                         return self->fail("connect", errorCode);
+                       dns_cache_t::instance().recordConnect(ip, started);
+                       self->performSslHandshake();
+                     });
+}
+
+void clock_probe_t::performSslHandshake() {
+  if (!SSL_set_tlsext_host_name(m_sslStream->native_handle(),
+                                m_host.c_str())) {
+    auto const ec = beast::error_code(static_cast<int>(::ERR_get_error()),
+                                      net::error::get_ssl_category());
+    return fail("SNI", ec);
+  }
+
+  auto const started =
+      tls_session_cache_t::instance().beforeHandshake(m_sslStream->native_handle());
+  m_sslStream->async_handshake(
+      net::ssl::stream_base::client,
+      [self = shared_from_this(), started](beast::error_code const ec) {
+        if (ec)
+          return self->fail("handshake", ec);
+        tls_session_cache_t::instance().afterHandshake(
+            self->m_sslStream->native_handle(), started);
+        self->sendRequest();
+      });
+}
+
+void clock_probe_t::sendRequest() {
+  m_request.method(beast::http::verb::get);
+  m_request.target(m_target);
+  m_request.version(11);
+  m_request.keep_alive(true);
+  m_request.set(beast::http::field::host, m_host);
+  m_request.set(beast::http::field::accept, "application/json");
+  m_request.set(beast::http::field::user_agent, "korrelator");
+
+  beast::get_lowest_layer(*m_sslStream).expires_after(std::chrono::seconds(10));
+  m_requestSentUs = localNowUs();
+  beast::http::async_write(
+      *m_sslStream, m_request,
+      [self = shared_from_this()](auto const errorCode, std::size_t const) {
+        if (errorCode)
+          return self->fail("write", errorCode);
+        self->receiveResponse();
+      });
+}
+
+void clock_probe_t::receiveResponse() {
+  m_response.emplace();
+  beast::http::async_read(
+      *m_sslStream, m_buffer, *m_response,
+      [self = shared_from_this()](auto const errorCode, std::size_t const) {
+        auto const receivedUs = localNowUs();
+        if (errorCode)
+          return self->fail("read", errorCode);
+
+        std::int64_t serverTimeMs = 0;
+        if (self->m_response->result() != beast::http::status::ok ||
+            !parseServerTime(self->m_response->body(), serverTimeMs)) {
+          qDebug() << "Clock probe" << self->m_host.c_str()
+                   << self->m_response->body().c_str();
+          return self->m_callback(std::nullopt);
+        }
+
+        // the first request also paid for TCP/TLS warm-up, ignore it
+        if (self->m_requestsDone++ != 0) {
+          sample_t sample;
+          sample.roundTripUs = receivedUs - self->m_requestSentUs;
+          // the server truncates to whole milliseconds, take the middle one
+          sample.offsetUs = serverTimeMs * 1'000 + 500 -
+                            (self->m_requestSentUs + sample.roundTripUs / 2);
+          if (!self->m_bestSample ||
+              sample.roundTripUs < self->m_bestSample->roundTripUs)
+            self->m_bestSample = sample;
+        }
+
+        if (self->m_requestsDone > self->m_sampleCount ||
+            !self->m_response->keep_alive())
+          return self->m_callback(self->m_bestSample);
+        self->sendRequest();
+      });
+}
+
+void clock_probe_t::fail(char const *what, beast::error_code const &ec) {
+  qDebug() << "Clock probe" << m_host.c_str() << what << ec.message().c_str();
+  m_callback(m_bestSample);
+}
+
+clock_sync_t::clock_sync_t(net::ssl::context &sslContext)
+    : m_strand(net::make_strand(m_ioContext)), m_sslContext(sslContext) {
+  auto addEndpoint = [this](exchange_name_e const exchange,
+                            trade_type_e const tradeType, char const *host,
+                            char const *target) {
+    endpoint_t endpoint;
+    endpoint.exchange = exchange;
+    endpoint.tradeType = tradeType;
+    endpoint.host = host;
+    endpoint.target = target;
+    m_endpoints.push_back(std::move(endpoint));
+  };
+  addEndpoint(exchange_name_e::binance, trade_type_e::spot,
+              constants::binance_http_spot_host, "/api/v3/time");
+  addEndpoint(exchange_name_e::binance, trade_type_e::futures,
+              constants::binance_http_futures_host, "/fapi/v1/time");
+  addEndpoint(exchange_name_e::kucoin, trade_type_e::spot,
+              constants::kucoin_https_spot_host, "/api/v1/timestamp");
+  addEndpoint(exchange_name_e::kucoin, trade_type_e::futures,
+              constants::kc_futures_api_host, "/api/v1/timestamp");
+}
+
+clock_sync_t::~clock_sync_t() { stop(); }
+
+void clock_sync_t::start() {
+  if (m_thread.joinable())
+    return;
+
+  m_workGuard.emplace(net::make_work_guard(m_ioContext));
+  for (auto &endpoint : m_endpoints) {
+    endpoint.timer = std::make_unique<net::steady_timer>(m_strand);
+    net::post(m_strand, [this, &endpoint] { probe(endpoint); });
+  }
+  m_thread = std::thread([this] { m_ioContext.run(); });
+}
+
+void clock_sync_t::stop() {
+  m_workGuard.reset();
+  m_ioContext.stop();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+void clock_sync_t::probe(endpoint_t &endpoint) {
+  std::make_shared<clock_probe_t>(
+      m_strand, m_sslContext, endpoint.host, endpoint.target, samplesPerProbe,
+      [this, &endpoint](auto const &sample) { onSample(endpoint, sample); })
+      ->run();
+}
+
+void clock_sync_t::onSample(
+    endpoint_t &endpoint,
+    std::optional<clock_probe_t::sample_t> const &sample) {
+  if (!sample)
+    return scheduleProbe(endpoint, endpoint.backoff.nextDelay());
+
+  endpoint.backoff.reset();
+  auto &offset = offsetOf(endpoint.exchange, endpoint.tradeType);
+  auto const previousUs = offset.load(std::memory_order_relaxed);
+  auto newOffsetUs = sample->offsetUs;
+  if (endpoint.hasOffset && std::llabs(newOffsetUs - previousUs) < offsetStepUs)
+    newOffsetUs = previousUs + static_cast<std::int64_t>(
+                                   offsetSmoothing *
+                                   static_cast<double>(newOffsetUs - previousUs));
+  offset.store(newOffsetUs, std::memory_order_relaxed);
+  endpoint.hasOffset = true;
+
+  qDebug() << "Clock offset" << endpoint.host.c_str() << endpoint.target.c_str()
+           << newOffsetUs << "us, RTT" << sample->roundTripUs << "us";
+  scheduleProbe(endpoint, probeInterval);
+}
+
+void clock_sync_t::scheduleProbe(endpoint_t &endpoint,
+                                 std::chrono::milliseconds const delay) {
+  endpoint.timer->expires_after(delay);
+  endpoint.timer->async_wait([this, &endpoint](beast::error_code const ec) {
+    if (!ec)
+      probe(endpoint);
+  });
+}
+
+} // namespace korrelator
@@ -11,18 +11,18 @@ char const * const constants::trade_json_filename =
     "testnet_config/trade.json";
 char const * const constants::encrypted_config_filename = "testnet_config/.config.dat";
 char const * const constants::config_json_filename = "testnet_config/config.json";
-char const *const constants::binance_ws_spot_url = "testnet.binance.vision";
-char const *const constants::binance_http_spot_host = "testnet.binance.vision";
-char const *const constants::binance_ws_spot_port = "443";
-char const *const constants::binance_ws_futures_url =
+char const *constants::binance_ws_spot_url = "testnet.binance.vision";
+char const *constants::binance_http_spot_host = "testnet.binance.vision";
+char const *constants::binance_ws_spot_port = "443";
+char const *constants::binance_ws_futures_url =
     "stream.binancefuture.com";
-char const *const constants::binance_http_futures_host =
+char const *constants::binance_http_futures_host =
     "testnet.binancefuture.com";
-char const *const constants::binance_ws_futures_port = "443";
+char const *constants::binance_ws_futures_port = "443";
 
-char const *const constants::kucoin_https_spot_host =
+char const *constants::kucoin_https_spot_host =
     "openapi-sandbox.kucoin.com";
-char const *const constants::kc_spot_http_request =
+char const *constants::kc_spot_http_request =
     "POST /api/v1/bullet-public HTTP/1.1\r\n"
     "Host: openapi-sandbox.kucoin.com\r\n"
     "Accept: */*\r\n"
@@ -38,16 +38,16 @@ char const * const constants::old_json_filename =
     "korrelator.json";
 char const * const constants::encrypted_config_filename = "config.dat";
 char const * const constants::config_json_filename = "config.json";
-char const *const constants::binance_ws_spot_url = "stream.binance.com";
-char const *const constants::binance_http_spot_host = "api.binance.com";
-char const *const constants::binance_ws_spot_port = "9443";
+char const *constants::binance_ws_spot_url = "stream.binance.com";
+char const *constants::binance_http_spot_host = "api.binance.com";
+char const *constants::binance_ws_spot_port = "9443";
 
-char const *const constants::binance_http_futures_host = "fapi.binance.com";
-char const *const constants::binance_ws_futures_url = "fstream.binance.com";
-char const *const constants::binance_ws_futures_port = "443";
+char const *constants::binance_http_futures_host = "fapi.binance.com";
+char const *constants::binance_ws_futures_url = "fstream.binance.com";
+char const *constants::binance_ws_futures_port = "443";
 
-char const *const constants::kucoin_https_spot_host = "api.kucoin.com";
-char const *const constants::kc_spot_http_request =
+char const *constants::kucoin_https_spot_host = "api.kucoin.com";
+char const *constants::kc_spot_http_request =
     "POST /api/v1/bullet-public HTTP/1.1\r\n"
     "Host: api.kucoin.com\r\n"
     "Accept: */*\r\n"
@@ -55,21 +55,21 @@ char const *const constants::kc_spot_http_request =
     "User-Agent: postman\r\n\r\n";
 #endif
 
-char const *const constants::kucoin_https_spot_port = "443";
-size_t const constants::spot_http_request_len = strlen(kc_spot_http_request);
+char const *constants::kucoin_https_spot_port = "443";
+size_t constants::spot_http_request_len = strlen(kc_spot_http_request);
 
 #ifdef TESTNET
-char const *const constants::kc_futures_api_host =
+char const *constants::kc_futures_api_host =
     "api-sandbox-futures.kucoin.com";
-char const *const constants::kc_futures_http_request =
+char const *constants::kc_futures_http_request =
     "POST /api/v1/bullet-public HTTP/1.1\r\n"
     "Host: api-sandbox-futures.kucoin.com\r\n"
     "Accept: */*\r\n"
     "Content-Type: application/json\r\n"
     "User-Agent: postman\r\n\r\n";
 #else
-char const *const constants::kc_futures_api_host = "api-futures.kucoin.com";
-char const *const constants::kc_futures_http_request =
+char const *constants::kc_futures_api_host = "api-futures.kucoin.com";
+char const *constants::kc_futures_http_request =
     "POST /api/v1/bullet-public HTTP/1.1\r\n"
     "Host: api-futures.kucoin.com\r\n"
     "Accept: */*\r\n"
@@ -77,6 +77,36 @@ char const *const constants::kc_futures_http_request =
     "User-Agent: postman\r\n\r\n";
 #endif
 
-size_t const constants::futures_http_request_len =
+size_t constants::futures_http_request_len =
     strlen(kc_futures_http_request);
+
+char const *constants::https_port = "https";
+bool constants::exchange_host_overridden = false;
+
+void constants::overrideExchangeHost(std::string const &host,
+                                     std::string const &port) {
+  static std::string hostName, portName, bulletRequest;
+  hostName = host;
+  portName = port;
+  bulletRequest = "POST /api/v1/bullet-public HTTP/1.1\r\n"
+                  "Host: " + hostName + ":" + portName + "\r\n"
+                  "Accept: */*\r\n"
+                  "Content-Type: application/json\r\n"
+                  "User-Agent: postman\r\n\r\n";
+
+  binance_ws_spot_url = binance_ws_futures_url = hostName.c_str();
+  binance_http_spot_host = binance_http_futures_host = hostName.c_str();
+  kucoin_https_spot_host = kc_futures_api_host = hostName.c_str();
+  binance_ws_spot_port = binance_ws_futures_port = portName.c_str();
+  kucoin_https_spot_port = https_port = portName.c_str();
+  kc_spot_http_request = kc_futures_http_request = bulletRequest.c_str();
+  spot_http_request_len = futures_http_request_len = bulletRequest.size();
+  exchange_host_overridden = true;
+}
+
+std::string constants::httpsOrigin(char const *host) {
+  if (!exchange_host_overridden)
+    return std::string("https://") + host;
+  return std::string("https://") + host + ":" + https_port;
+}
 } // namespace korrelator
@@ -0,0 +1,417 @@
+#include "correlator_engine.hpp"
+
+#include <QDateTime>
+#include <QDebug>
+
+#include <algorithm>
+
+namespace korrelator {
+
+static QString localTimeString() {
+  return QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
+}
+
+QString correlator_observer_t::signalTime() const { return localTimeString(); }
+
+void correlator_observer_t::onNormalizedPoint(double const, token_t const &,
+                                              token_t const &, bool const) {}
+
+void correlator_observer_t::onPriceDeltaPoint(double const, double const,
+                                              bool const) {}
+
+void updateTokenIter(token_t &value, double const price) {
+  if (value.calculatingNewMinMax) {
+    value.minPrice = price * 0.75;
+    value.maxPrice = price * 1.25;
+    value.calculatingNewMinMax = false;
+  }
+
+  value.minPrice = std::min(value.minPrice, price);
+  value.maxPrice = std::max(value.maxPrice, price);
+  value.normalizedPrice =
+      (price - value.minPrice) / (value.maxPrice - value.minPrice);
+}
+
+void updateTokenIter(token_t &value) {
+  updateTokenIter(value, value.realPrice->price());
+}
+
+trade_action_e lineCrossedOver(double const prevA, double const currA,
+                               double const prevB, double const currB) {
+  // prevA -> previous ref, prevB -> previous symbol price
+  // currA -> current ref, currB -> current symbol price
+  if ((currA < currB) && (prevB < prevA))
+    return trade_action_e::buy;
+  else if ((prevA < prevB) && (currB < currA))
+    return trade_action_e::sell;
+  return trade_action_e::nothing;
+}
+
+void correlator_engine_t::attachTickRings() {
+  m_tickRingDrops = 0;
+  if (!m_settings.hasReferences || m_tokens.size() < 2)
+    return;
+
+  for (auto &ref : m_refs)
+    attachTickRing(ref);
+  attachTickRing(m_tokens[1]);
+}
+
+void correlator_engine_t::attachTickRing(token_t &token) const {
+  if (token.realPrice)
+    token.realPrice->setRing(std::make_unique<tick_ring_t>(
+        m_settings.tickRingCapacity, m_settings.tickRingPolicy));
+}
+
+void correlator_engine_t::startSignals(std::int64_t const startRequestedNs) {
+  m_lastPriceDeltaAction = trade_action_e::nothing;
+  m_startRequestedNs = startRequestedNs;
+}
+
+void correlator_engine_t::reset() {
+  m_pendingTicks.clear();
+  m_priceDeltaWindow.clear();
+  m_startRequestedNs = 0;
+  m_warmRefCount = 0;
+  m_refSetChanged = false;
+  for (auto &ref : m_refs)
+    ref.warmUpEndNs = 0;
+}
+
+void correlator_engine_t::seedRefAverage() {
+  if (!m_settings.hasReferences || m_refs.empty())
+    return;
+  auto price = 0.0;
+  for (auto const &t : m_refs)
+    price += t.normalizedPrice;
+  m_tokens[0].normalizedPrice = (price / (double)m_refs.size());
+}
+
+void correlator_engine_t::normalizePrices() {
+  // no price until a symbol's first tick, the REST snapshot seeded it or,
+  // for a ref added while running, it isn't averaged yet
+  auto const update = [](token_t &token) {
+    if (token.realPrice->price() != 0.0)
+      updateTokenIter(token);
+  };
+  for (auto &token : m_refs)
+    update(token);
+
+  if (m_settings.hasReferences && m_tokens.size() == 2)
+    return update(m_tokens[1]);
+
+  size_t const tokenStartIndex = m_settings.hasReferences ? 1 : 0;
+  for (size_t i = tokenStartIndex; i < m_tokens.size(); ++i)
+    update(m_tokens[i]);
+}
+
+// refs added while running are left out of the average until they have
+// warmed up
+double correlator_engine_t::averageRefPrice() {
+  auto const now = steadyNowNs();
+  double sum = 0.0;
+  std::size_t count = 0;
+  for (auto &ref : m_refs) {
+    if (ref.warmUpEndNs != 0) {
+      if (ref.calculatingNewMinMax || now < ref.warmUpEndNs)
+        continue;
+      ref.warmUpEndNs = 0;
+      qDebug() << "Reference" << ref.symbolName << "joined the average";
+    }
+    sum += ref.normalizedPrice;
+    ++count;
+  }
+
+  if (count != m_warmRefCount) {
+    m_refSetChanged = m_warmRefCount != 0;
+    m_warmRefCount = count;
+  }
+  return count == 0 ? 0.0 : sum / double(count);
+}
+
+ref_calculation_data_t correlator_engine_t::updateRef() {
+  ref_calculation_data_t refResult;
+
+  auto &value = m_tokens[0];
+  ++value.graphPointsDrawnCount;
+
+  auto const &restartTickValues = m_settings.restartTickValues;
+  if (!m_settings.doingManualLDClosure) {
+    refResult.isResettingRef =
+        restartTickValues.refLines &&
+        value.graphPointsDrawnCount >=
+            (qint64)restartTickValues.refLines->restartOnTickEntry;
+  } else {
+    auto const &specialTickValue = restartTickValues.special;
+    refResult.eachTickNormalize =
+        specialTickValue.has_value() &&
+        value.graphPointsDrawnCount >= specialTickValue->restartOnTickEntry;
+  }
+
+  if (refResult.isResettingRef || refResult.eachTickNormalize)
+    value.graphPointsDrawnCount = 0;
+
+  // get the normalizedValue
+  value.normalizedPrice = averageRefPrice() * value.alpha;
+  value.prevNormalizedPrice = value.normalizedPrice;
+  return refResult;
+}
+
+QString correlator_engine_t::signalTime() const {
+  return m_observer ? m_observer->signalTime() : localTimeString();
+}
+
+void correlator_engine_t::evaluateCrossOver(double const prevRef,
+                                            double const currentRef,
+                                            token_t &value) {
+  // no signal on a price only the REST snapshot has seen
+  if (value.realPrice->sequence() == 0)
+    return;
+  if (m_startRequestedNs != 0) {
+    qDebug() << "First signal evaluated"
+             << (steadyNowNs() - m_startRequestedNs) / 1'000'000
+             << "ms after Start";
+    m_startRequestedNs = 0;
+  }
+
+  auto const crossOverDecision = lineCrossedOver(
+      prevRef, currentRef, value.prevNormalizedPrice, value.normalizedPrice);
+
+  if (crossOverDecision != trade_action_e::nothing) {
+    auto &crossOver = value.crossOver.emplace();
+    crossOver.signalPrice = value.realPrice->price();
+    crossOver.action = crossOverDecision;
+    crossOver.time = signalTime();
+    value.crossedOver = true;
+  }
+
+  if (value.crossedOver) {
+    double amp = 0.0;
+    auto &crossOverValue = *value.crossOver;
+    if (crossOverValue.action == trade_action_e::buy)
+      amp = (value.normalizedPrice / currentRef) - 1.0;
+    else
+      amp = (currentRef / value.normalizedPrice) - 1.0;
+
+    if (m_settings.findingUmbral && amp >= m_settings.threshold) {
+      if (m_observer)
+        m_observer->onCrossOverSignal(value, std::move(crossOverValue));
+      value.crossedOver = false;
+      value.crossOver.reset();
+    }
+  }
+}
+
+void correlator_engine_t::drainTickRings() {
+  if (!m_settings.hasReferences || m_tokens.size() < 2 || m_refs.empty())
+    return;
+
+  std::uint64_t drops = 0;
+  m_pendingTicks.clear();
+  auto const collect = [this, &drops](token_t &token) {
+    auto ring = token.realPrice ? token.realPrice->ring() : nullptr;
+    if (!ring)
+      return;
+    ring->drain([this, &token](tick_t const &tick) {
+      m_pendingTicks.push_back({&token, tick.price, tick.receiveTimeNs});
+    });
+    drops += ring->dropCount();
+  };
+  for (auto &ref : m_refs)
+    collect(ref);
+  collect(m_tokens[1]);
+
+  if (drops != m_tickRingDrops) {
+    qDebug() << "Ticks dropped by full rings:" << drops;
+    m_tickRingDrops = drops;
+  }
+
+  // replay the ticks of every symbol in the order they were received, so
+  // crossovers that revert before the next timer tick are still seen
+  std::stable_sort(m_pendingTicks.begin(), m_pendingTicks.end(),
+                   [](auto const &a, auto const &b) {
+                     return a.receiveTimeNs < b.receiveTimeNs;
+                   });
+
+  auto &refSymbol = m_tokens[0];
+  auto &value = m_tokens[1];
+  for (auto const &tick : m_pendingTicks) {
+    if (tick.price == 0.0)
+      continue;
+    updateTokenIter(*tick.token, tick.price);
+
+    double const currentRef = averageRefPrice() * refSymbol.alpha;
+    // the average jumps when a ref joins or leaves, that's no crossover
+    if (m_refSetChanged)
+      m_refSetChanged = false;
+    else if (refSymbol.normalizedPrice != CMAX_DOUBLE_VALUE &&
+             value.prevNormalizedPrice != CMAX_DOUBLE_VALUE)
+      evaluateCrossOver(refSymbol.normalizedPrice, currentRef, value);
+    refSymbol.normalizedPrice = currentRef;
+    value.prevNormalizedPrice = value.normalizedPrice;
+  }
+}
+
+void correlator_engine_t::onNormalizedTimerTick(double const key,
+                                                bool const updatingMinMax) {
+  drainTickRings();
+  normalizePrices();
+  if (!m_settings.hasReferences)
+    return;
+
+  auto &refSymbol = m_tokens[0];
+  double const prevRef = refSymbol.normalizedPrice;
+  auto refResult = updateRef();
+  double currentRef = refSymbol.normalizedPrice;
+
+  // update the real symbols
+  auto &value = m_tokens[1];
+  ++value.graphPointsDrawnCount;
+  if (value.prevNormalizedPrice == CMAX_DOUBLE_VALUE)
+    value.prevNormalizedPrice = value.normalizedPrice;
+
+  auto const &restartTickValues = m_settings.restartTickValues;
+  bool const isResettingSymbols =
+      !m_settings.doingManualLDClosure &&
+      restartTickValues.normalLines.has_value() &&
+      (value.graphPointsDrawnCount >=
+       (qint64)restartTickValues.normalLines->restartOnTickEntry);
+
+  if (isResettingSymbols)
+    value.graphPointsDrawnCount = 0;
+
+  if (m_refSetChanged)
+    m_refSetChanged = false;
+  else
+    evaluateCrossOver(prevRef, currentRef, value);
+
+  if (refResult.eachTickNormalize || m_settings.doingAutoLDClosure) {
+    currentRef /= refSymbol.alpha;
+    auto const distanceFromRefToSymbol = // a
+        ((value.normalizedPrice > currentRef)
+             ? (value.normalizedPrice / currentRef)
+             : (currentRef / value.normalizedPrice)) -
+        1.0;
+    auto const distanceThreshold =
+        restartTickValues.special->afterDivisionSpecialEntry; // b
+    bool const resettingRef =
+        m_settings.doingAutoLDClosure &&
+        distanceFromRefToSymbol >
+            restartTickValues.special->afterDivisionPercentageEntry;
+
+    if (refResult.eachTickNormalize || resettingRef) {
+      if (value.normalizedPrice > currentRef) {
+        refSymbol.alpha =
+            ((distanceFromRefToSymbol + 1.0) / (distanceThreshold + 1.0));
+      } else {
+        refSymbol.alpha =
+            ((distanceThreshold + 1.0) / (distanceFromRefToSymbol + 1.0));
+      }
+      if (resettingRef)
+        refResult.isResettingRef = true;
+    }
+  }
+
+  value.prevNormalizedPrice = value.normalizedPrice;
+  if (m_observer)
+    m_observer->onNormalizedPoint(key, refSymbol, value, updatingMinMax);
+
+  if (refResult.isResettingRef || isResettingSymbols)
+    resetTickerData(refResult.isResettingRef, isResettingSymbols);
+}
+
+void correlator_engine_t::resetTickerData(bool const resetRefs,
+                                          bool const resetSymbols) {
+  static auto resetMap = [](auto &map) {
+    for (auto &value : map)
+      value.calculatingNewMinMax = true;
+  };
+
+  if (resetRefs)
+    resetMap(m_refs);
+  if (resetSymbols)
+    resetMap(m_tokens);
+}
+
+void correlator_engine_t::onPriceDeltaTimerTick(double const key,
+                                                bool const updatingMinMax) {
+  if (m_priceDeltas.size() < 2)
+    return;
+
+  double const a = m_priceDeltas[0].realPrice->price();
+  double const b = m_priceDeltas[1].realPrice->price();
+  if (a == 0.0 || b == 0.0)
+    return;
+
+  double const result = (a + b) / b;
+  token_t &value = m_priceDeltas[0];
+  if (value.calculatingNewMinMax) {
+    value.minPrice = result * 0.95;
+    value.maxPrice = result * 1.05;
+    value.calculatingNewMinMax = false;
+  }
+
+  m_priceDeltaWindow.emplace_back(key, result);
+  while (m_priceDeltaWindow.front().first < key - m_settings.averageWindow)
+    m_priceDeltaWindow.pop_front();
+  if (m_observer)
+    m_observer->onPriceDeltaPoint(key, result, updatingMinMax);
+
+  // the evaluator thread already checks the band on every tick
+  if (m_settings.eventDrivenSignals)
+    return;
+  if (auto const action = priceDeltaBandAction(result);
+      action != trade_action_e::nothing && m_observer)
+    m_observer->onPriceDeltaSignal(action);
+}
+
+void correlator_engine_t::updatePriceDeltaAverage() {
+  if (m_priceDeltaWindow.empty())
+    return;
+
+  auto const [minIter, maxIter] = std::minmax_element(
+      m_priceDeltaWindow.cbegin(), m_priceDeltaWindow.cend(),
+      [](auto const &a, auto const &b) { return a.second < b.second; });
+  auto &band = m_priceDeltaBand;
+  band.average = (maxIter->second + minIter->second) / 2.0;
+
+  qDebug() << "New average:" << band.average;
+
+  if (m_settings.maxAverageThreshold != 0.0) {
+    band.up = band.average + m_settings.maxAverageThreshold;
+    band.down = band.average - m_settings.maxAverageThreshold;
+
+    qDebug() << "M_UP" << band.up << ", M_DOWN" << band.down;
+  }
+}
+
+trade_action_e
+correlator_engine_t::priceDeltaBandAction(double const result) const {
+  if (m_settings.maxAverageThreshold == 0.0 || m_priceDeltaBand.average == 0.0)
+    return trade_action_e::nothing;
+  if (result > m_priceDeltaBand.up)
+    return trade_action_e::sell;
+  else if (result < m_priceDeltaBand.down)
+    return trade_action_e::buy;
+  return trade_action_e::nothing;
+}
+
+void correlator_engine_t::evaluatePriceDeltaTick() {
+  if (m_priceDeltas.size() < 2)
+    return;
+
+  double const a = m_priceDeltas[0].realPrice->price();
+  double const b = m_priceDeltas[1].realPrice->price();
+  if (a == 0.0 || b == 0.0)
+    return;
+
+  // only act when the delta leaves the band, not on every tick outside it
+  auto const action = priceDeltaBandAction((a + b) / b);
+  if (action == m_lastPriceDeltaAction)
+    return;
+  m_lastPriceDeltaAction = action;
+  if (action != trade_action_e::nothing && m_observer)
+    m_observer->onPriceDeltaSignal(action);
+}
+
+} // namespace korrelator
@@ -7,7 +7,6 @@
 #include <cassert>
 #include <sstream>
 #include <iomanip>
-#include <QDateTime>
 
 namespace korrelator {
 
@@ -109,8 +108,4 @@ std::basic_string<unsigned char> hmac256_encode(
   return reinterpret_cast<unsigned char *>(ss.str().data());
 }
 
-time_t getGMTTimeMs() {
-  return QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
-}
-
 } // namespace korrelator
@@ -0,0 +1,237 @@
+#include "decimal_parser.hpp"
+
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <string>
+
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+
+namespace korrelator {
+
+static double const powersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                     1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                     1e18, 1e19, 1e20, 1e21, 1e22};
+
+static constexpr int maxSignificantDigits = 19;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define KORRELATOR_NO_SWAR 1
+#endif
+
+#ifndef KORRELATOR_NO_SWAR
+static inline std::uint64_t loadEightBytes(char const *str) {
+  std::uint64_t value;
+  std::memcpy(&value, str, sizeof(value));
+  return value;
+}
+
+static inline bool isEightDigits(std::uint64_t const value) {
+  return ((value & 0xF0F0F0F0F0F0F0F0) |
+          (((value + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+         0x3333333333333333;
+}
+
+// converts eight ASCII digits with three multiplications instead of eight
+static inline std::uint32_t parseEightDigits(std::uint64_t value) {
+  std::uint64_t const mask = 0x000000FF000000FF;
+  std::uint64_t const mul1 = 0x000F424000000064; // 100 + (1000000 << 32)
+  std::uint64_t const mul2 = 0x0000271000000001; // 1 + (10000 << 32)
+  value -= 0x3030303030303030;
+  value = (value * 10) + (value >> 8);
+  value = (((value & mask) * mul1) + (((value >> 16) & mask) * mul2)) >> 32;
+  return static_cast<std::uint32_t>(value);
+}
+#endif
+
+static inline bool isDigit(char const c) {
+  return static_cast<unsigned char>(c - '0') < 10;
+}
+
+// reads digits into `mantissa`, leading zeros are not significant
+static inline char const *parseDigits(char const *first, char const *const last,
+                                      std::uint64_t &mantissa,
+                                      int &significantDigits) {
+  if (significantDigits == 0) {
+    while (first != last && *first == '0')
+      ++first;
+  }
+#ifndef KORRELATOR_NO_SWAR
+  while (last - first >= 8 && significantDigits + 8 <= maxSignificantDigits) {
+    auto const eightBytes = loadEightBytes(first);
+    if (!isEightDigits(eightBytes))
+      break;
+    mantissa = mantissa * 100000000 + parseEightDigits(eightBytes);
+    significantDigits += 8;
+    first += 8;
+  }
+#endif
+  for (; first != last && isDigit(*first); ++first) {
+    if (++significantDigits > maxSignificantDigits)
+      return nullptr;
+    mantissa = mantissa * 10 + static_cast<unsigned>(*first - '0');
+  }
+  return first;
+}
+
+static bool parseUnsignedDecimal(char const *first, char const *const last,
+                                 bool &negative, std::uint64_t &mantissa,
+                                 std::int32_t &exponent) {
+  negative = false;
+  mantissa = 0;
+  exponent = 0;
+  if (first == last)
+    return false;
+  if (*first == '-' || *first == '+') {
+    negative = *first == '-';
+    ++first;
+  }
+
+  int significantDigits = 0;
+  char const *const integerStart = first;
+  first = parseDigits(first, last, mantissa, significantDigits);
+  if (!first)
+    return false;
+  bool hasDigits = first != integerStart;
+
+  if (first != last && *first == '.') {
+    char const *const fractionStart = ++first;
+    first = parseDigits(first, last, mantissa, significantDigits);
+    if (!first)
+      return false;
+    // zeros skipped after the point still scale the value
+    exponent -= static_cast<std::int32_t>(first - fractionStart);
+    hasDigits = hasDigits || first != fractionStart;
+  }
+  if (!hasDigits)
+    return false;
+
+  if (first != last && (*first == 'e' || *first == 'E')) {
+    ++first;
+    bool negativeExponent = false;
+    if (first != last && (*first == '-' || *first == '+')) {
+      negativeExponent = *first == '-';
+      ++first;
+    }
+    if (first == last)
+      return false;
+    std::int32_t value = 0;
+    for (; first != last && isDigit(*first); ++first) {
+      if (value < 100000)
+        value = value * 10 + (*first - '0');
+    }
+    exponent += negativeExponent ? -value : value;
+  }
+  return first == last;
+}
+
+double decimal_t::toDouble() const {
+  double result = 0.0;
+  auto const magnitude = mantissa < 0
+                             ? 0 - static_cast<std::uint64_t>(mantissa)
+                             : static_cast<std::uint64_t>(mantissa);
+  // Clinger's fast path: both operands are exact, so is the result
+  if (magnitude <= (std::uint64_t(1) << 53) && exponent >= -22 &&
+      exponent <= 22) {
+    result = exponent < 0 ? static_cast<double>(magnitude) / powersOfTen[-exponent]
+                          : static_cast<double>(magnitude) * powersOfTen[exponent];
+  } else {
+    result = static_cast<double>(magnitude);
+    for (auto e = exponent; e < 0; e += 22)
+      result /= powersOfTen[e < -22 ? 22 : -e];
+    for (auto e = exponent; e > 0; e -= 22)
+      result *= powersOfTen[e > 22 ? 22 : e];
+  }
+  return mantissa < 0 ? -result : result;
+}
+
+bool parseDecimal(char const *first, char const *const last,
+                  decimal_t &result) {
+  bool negative = false;
+  std::uint64_t mantissa = 0;
+  std::int32_t exponent = 0;
+  if (!parseUnsignedDecimal(first, last, negative, mantissa, exponent) ||
+      mantissa > static_cast<std::uint64_t>(INT64_MAX))
+    return false;
+  result.mantissa = negative ? -static_cast<std::int64_t>(mantissa)
+                             : static_cast<std::int64_t>(mantissa);
+  result.exponent = exponent;
+  return true;
+}
+
+bool parseInteger(std::string_view const str, std::int64_t &result) {
+  decimal_t decimal;
+  if (!parseDecimal(str.data(), str.data() + str.size(), decimal) ||
+      decimal.exponent != 0)
+    return false;
+  result = decimal.mantissa;
+  return true;
+}
+
+static bool parseDoubleSlowPath(char const *first, char const *const last,
+                                double &result) {
+  if (first != last && *first == '+')
+    ++first;
+  // "inf", "nan" and the like are no exchange numbers
+  auto const digits = first != last && *first == '-' ? first + 1 : first;
+  if (digits == last || !(isDigit(*digits) || *digits == '.'))
+    return false;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  auto const [ptr, ec] = std::from_chars(first, last, result);
+  return ec == std::errc{} && ptr == last;
+#else
+  // unlike strtod, the classic locale reads '.' as the decimal point
+  // whatever the global locale is
+  std::istringstream stream(std::string(first, last));
+  stream.imbue(std::locale::classic());
+  stream >> result;
+  return !stream.fail() &&
+         stream.peek() == std::istringstream::traits_type::eof();
+#endif
+}
+
+bool parseDouble(char const *first, char const *const last, double &result) {
+  bool negative = false;
+  std::uint64_t mantissa = 0;
+  std::int32_t exponent = 0;
+  if (parseUnsignedDecimal(first, last, negative, mantissa, exponent) &&
+      mantissa <= (std::uint64_t(1) << 53) && exponent >= -22 &&
+      exponent <= 22) {
+    double const value =
+        exponent < 0 ? static_cast<double>(mantissa) / powersOfTen[-exponent]
+                     : static_cast<double>(mantissa) * powersOfTen[exponent];
+    result = negative ? -value : value;
+    return true;
+  }
+  return parseDoubleSlowPath(first, last, result);
+}
+
+double stringToDouble(std::string_view const str) {
+  double result = 0.0;
+  if (!parseDouble(str, result))
+    return 0.0;
+  return result;
+}
+
+double stringToDouble(char const *str) {
+  if (!str)
+    return 0.0;
+  return stringToDouble(std::string_view(str));
+}
+
+double stringToDouble(QString const &str, bool *ok) {
+  // only ASCII is meaningful here, anything else fails the parse anyway
+  QByteArray const latin1 = str.trimmed().toLatin1();
+  double result = 0.0;
+  bool const parsed =
+      parseDouble(latin1.constData(), latin1.constData() + latin1.size(),
+                  result);
+  if (ok)
+    *ok = parsed;
+  return parsed ? result : 0.0;
+}
+
+} // namespace korrelator
@@ -0,0 +1,122 @@
+#include "depth_snapshot.hpp"
+
+#include <QDebug>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/beast/http/read.hpp>
+#include <boost/beast/http/write.hpp>
+
+#include "constants.hpp"
+#include "tls_session_cache.hpp"
+
+namespace korrelator {
+
+depth_snapshot_request_t::depth_snapshot_request_t(
+    strand_t strand, net::ssl::context &sslContext, std::string host,
+    std::string target, callback_t callback)
+    : m_strand(std::move(strand)), m_sslContext(sslContext),
+      m_host(std::move(host)), m_target(std::move(target)),
+      m_callback(std::move(callback)) {}
+
+void depth_snapshot_request_t::run() {
+  if (auto endpoints =
+          dns_cache_t::instance().lookup(m_host, constants::https_port)) {
+    return net::post(m_strand, [self = shared_from_this(),
+                                endpoints = std::move(*endpoints)] {
+      self->connect(endpoints);
+    });
+  }
+
+  m_resolver.emplace(m_strand);
+  m_resolver->async_resolve(
+      m_host, constants::https_port,
+      [self = shared_from_this()](auto const errorCode,
+                                  resolver::results_type const &results) {
+        if (errorCode)
+          return self->fail("resolve", errorCode);
+        self->connect(dns_cache_t::instance().store(
+            self->m_host, constants::https_port, results));
+      });
+}
+
+void depth_snapshot_request_t::connect(
+    dns_cache_t::endpoints_t const &resolvedNames) {
+  m_resolver.reset();
+  m_sslStream.emplace(m_strand, m_sslContext);
+  beast::get_lowest_layer(*m_sslStream).expires_after(std::chrono::seconds(15));
+  beast::get_lowest_layer(*m_sslStream)
+      .async_connect(resolvedNames,
+                     [self = shared_from_this(),
+                      started = std::chrono::steady_clock::now()](
+                         auto const errorCode,
+                         resolver::results_type::endpoint_type const &ip) {
+                       if (errorCode)
+                         return self->fail("connect", errorCode);
+                       dns_cache_t::instance().recordConnect(ip, started);
+                       self->performSslHandshake();
+                     });
+}
+
+void depth_snapshot_request_t::performSslHandshake() {
+  if (!SSL_set_tlsext_host_name(m_sslStream->native_handle(),
+                                m_host.c_str())) {
+    auto const ec = beast::error_code(static_cast<int>(::ERR_get_error()),
+                                      net::error::get_ssl_category());
+    return fail("SNI", ec);
+  }
+
+  auto const started =
+      tls_session_cache_t::instance().beforeHandshake(m_sslStream->native_handle());
+  m_sslStream->async_handshake(
+      net::ssl::stream_base::client,
+      [self = shared_from_this(), started](beast::error_code const ec) {
+        if (ec)
+          return self->fail("handshake", ec);
+        tls_session_cache_t::instance().afterHandshake(
+            self->m_sslStream->native_handle(), started);
+        self->sendRequest();
+      });
+}
+
+void depth_snapshot_request_t::sendRequest() {
+  m_request.method(beast::http::verb::get);
+  m_request.target(m_target);
+  m_request.version(11);
+  m_request.set(beast::http::field::host, m_host);
+  m_request.set(beast::http::field::accept, "application/json");
+  m_request.set(beast::http::field::user_agent, "korrelator");
+
+  beast::get_lowest_layer(*m_sslStream).expires_after(std::chrono::seconds(10));
+  beast::http::async_write(
+      *m_sslStream, m_request,
+      [self = shared_from_this()](auto const errorCode, std::size_t const) {
+        if (errorCode)
+          return self->fail("write", errorCode);
+        self->receiveResponse();
+      });
+}
+
+void depth_snapshot_request_t::receiveResponse() {
+  beast::get_lowest_layer(*m_sslStream).expires_after(std::chrono::seconds(20));
+  beast::http::async_read(
+      *m_sslStream, m_buffer, m_response,
+      [self = shared_from_this()](auto const errorCode, std::size_t const) {
+        if (errorCode)
+          return self->fail("read", errorCode);
+        if (self->m_response.result() != beast::http::status::ok) {
+          qDebug() << "Depth snapshot" << self->m_target.c_str()
+                   << self->m_response.body().c_str();
+          return self->m_callback({});
+        }
+        self->m_callback(self->m_response.body());
+      });
+}
+
+void depth_snapshot_request_t::fail(char const *what,
+                                    beast::error_code const &ec) {
+  qDebug() << "Depth snapshot" << what << ec.message().c_str();
+  m_callback({});
+}
+
+} // namespace korrelator
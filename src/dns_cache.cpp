@@ -0,0 +1,153 @@
+#include "dns_cache.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+
+#include "constants.hpp"
+
+namespace korrelator {
+
+// the resolver doesn't report record TTLs, so every entry gets the same
+static constexpr auto entryLifetime = std::chrono::minutes(5);
+static constexpr auto refreshInterval = std::chrono::minutes(1);
+// weight of the newest connect in an address' smoothed latency
+static constexpr double connectSmoothing = 0.25;
+
+dns_cache_t &dns_cache_t::instance() {
+  static dns_cache_t cache;
+  return cache;
+}
+
+dns_cache_t::~dns_cache_t() { stop(); }
+
+void dns_cache_t::prewarm(
+    std::vector<std::pair<std::string, std::string>> hosts) {
+  if (m_thread.joinable())
+    return;
+
+  m_workGuard.emplace(net::make_work_guard(m_ioContext));
+  m_resolver.emplace(m_ioContext);
+  m_refreshTimer.emplace(m_ioContext);
+  for (auto &host : hosts) {
+    auto const key = host;
+    m_resolver->async_resolve(
+        key.first, key.second,
+        [this, key](boost::system::error_code const ec,
+                    net::ip::tcp::resolver::results_type const &results) {
+          if (ec) {
+            qDebug() << "Unable to resolve" << key.first.c_str() << ":"
+                     << ec.message().c_str();
+            return;
+          }
+          store(key.first, key.second, results);
+        });
+  }
+  scheduleRefresh();
+  m_thread = std::thread([this] { m_ioContext.run(); });
+}
+
+void dns_cache_t::stop() {
+  m_workGuard.reset();
+  m_ioContext.stop();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+std::optional<dns_cache_t::endpoints_t>
+dns_cache_t::lookup(std::string const &host, std::string const &service) {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  auto iter = m_entries.find(key_t(host, service));
+  if (iter == m_entries.end() ||
+      clock_t::now() - iter->second.resolvedAt > entryLifetime)
+    return std::nullopt;
+  return ordered(iter->second.endpoints);
+}
+
+dns_cache_t::endpoints_t
+dns_cache_t::store(std::string const &host, std::string const &service,
+                   net::ip::tcp::resolver::results_type const &results) {
+  endpoints_t endpoints;
+  endpoints.reserve(results.size());
+  for (auto const &result : results)
+    endpoints.push_back(result.endpoint());
+
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  if (!endpoints.empty())
+    m_entries[key_t(host, service)] = entry_t{endpoints, clock_t::now()};
+  return ordered(std::move(endpoints));
+}
+
+void dns_cache_t::recordConnect(endpoint_t const &endpoint,
+                                clock_t::time_point const started) {
+  auto const elapsedUs = double(
+      std::chrono::duration_cast<std::chrono::microseconds>(clock_t::now() -
+                                                            started)
+          .count());
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  auto [iter, inserted] = m_connectUs.emplace(endpoint, elapsedUs);
+  if (!inserted)
+    iter->second += connectSmoothing * (elapsedUs - iter->second);
+}
+
+// with `m_mutex` held
+dns_cache_t::endpoints_t dns_cache_t::ordered(endpoints_t endpoints) const {
+  auto const latencyOf = [this](endpoint_t const &endpoint) {
+    auto const iter = m_connectUs.find(endpoint);
+    return iter == m_connectUs.end() ? -1.0 : iter->second;
+  };
+  std::stable_sort(endpoints.begin(), endpoints.end(),
+                   [&latencyOf](endpoint_t const &a, endpoint_t const &b) {
+                     return latencyOf(a) < latencyOf(b);
+                   });
+  return endpoints;
+}
+
+void dns_cache_t::refreshAll() {
+  std::vector<key_t> keys;
+  {
+    std::lock_guard<std::mutex> lock_g(m_mutex);
+    for (auto const &entry : m_entries)
+      keys.push_back(entry.first);
+  }
+  // a failed refresh leaves the old addresses in place until they expire
+  for (auto const &key : keys) {
+    m_resolver->async_resolve(
+        key.first, key.second,
+        [this, key](boost::system::error_code const ec,
+                    net::ip::tcp::resolver::results_type const &results) {
+          if (!ec)
+            store(key.first, key.second, results);
+        });
+  }
+}
+
+void dns_cache_t::scheduleRefresh() {
+  m_refreshTimer->expires_after(refreshInterval);
+  m_refreshTimer->async_wait([this](boost::system::error_code const ec) {
+    if (ec)
+      return;
+    refreshAll();
+    scheduleRefresh();
+  });
+}
+
+void prewarmExchangeHosts() {
+  dns_cache_t::instance().prewarm(
+      {{constants::binance_ws_spot_url, constants::binance_ws_spot_port},
+       {constants::binance_ws_futures_url, constants::binance_ws_futures_port},
+       {constants::binance_http_spot_host, constants::https_port},
+       {constants::binance_http_futures_host, constants::https_port},
+       {constants::kucoin_https_spot_host, constants::https_port},
+       {constants::kc_futures_api_host, constants::https_port}});
+}
+
+void rotateForFeed(dns_cache_t::endpoints_t &endpoints, int const feedIndex) {
+  if (endpoints.empty())
+    return;
+  std::rotate(endpoints.begin(),
+              endpoints.begin() + (feedIndex % endpoints.size()),
+              endpoints.end());
+}
+
+} // namespace korrelator
@@ -0,0 +1,112 @@
+#include "feed_watchdog.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+
+#include "tick_slot.hpp"
+
+namespace korrelator {
+
+// weight of the newest sample in a symbol's smoothed update interval
+static constexpr double intervalSmoothing = 0.1;
+// before a symbol's interval is learnt, e.g. while it is still connecting
+static constexpr int unlearntSilenceFactor = 6;
+
+feed_watchdog_t::feed_watchdog_t(std::chrono::milliseconds const minimumSilence,
+                                 std::chrono::milliseconds const maximumSilence,
+                                 double const silenceFactor)
+    : m_minimumSilenceNs(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(minimumSilence)
+              .count()),
+      m_maximumSilenceNs(std::max(
+          m_minimumSilenceNs,
+          static_cast<std::int64_t>(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  maximumSilence)
+                  .count()))),
+      m_silenceFactor(silenceFactor) {}
+
+std::size_t feed_watchdog_t::addSymbol(std::string name,
+                                       tick_slot_t const &slot) {
+  auto symbol = std::make_unique<symbol_t>();
+  symbol->name = std::move(name);
+  symbol->slot = &slot;
+  m_symbols.push_back(std::move(symbol));
+  return m_symbols.size() - 1;
+}
+
+void feed_watchdog_t::removeSymbol(std::size_t const symbolIndex) {
+  auto &symbol = *m_symbols[symbolIndex];
+  symbol.slot = nullptr;
+  if (symbol.stale.exchange(false, std::memory_order_acq_rel))
+    m_staleCount.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+std::int64_t feed_watchdog_t::silenceNs(symbol_t const &symbol) const {
+  if (symbol.intervalNs <= 0.0)
+    return std::min(m_maximumSilenceNs,
+                    m_minimumSilenceNs * unlearntSilenceFactor);
+  return std::clamp(
+      static_cast<std::int64_t>(symbol.intervalNs * m_silenceFactor),
+      m_minimumSilenceNs, m_maximumSilenceNs);
+}
+
+void feed_watchdog_t::check(std::int64_t const nowNs,
+                            action_callback_t const &onSilence) {
+  for (std::size_t index = 0; index < m_symbols.size(); ++index) {
+    auto &symbol = *m_symbols[index];
+    if (symbol.slot == nullptr)
+      continue;
+    auto const sequence = symbol.slot->sequence();
+    if (symbol.lastChangeNs == 0) {
+      symbol.lastSequence = sequence;
+      symbol.lastChangeNs = nowNs;
+      continue;
+    }
+
+    if (sequence != symbol.lastSequence) {
+      // the first price only tells how long connecting took
+      if (symbol.lastSequence != 0) {
+        auto const sample = double(nowNs - symbol.lastChangeNs) /
+                            double(sequence - symbol.lastSequence);
+        symbol.intervalNs =
+            symbol.intervalNs <= 0.0
+                ? sample
+                : symbol.intervalNs +
+                      intervalSmoothing * (sample - symbol.intervalNs);
+      }
+      symbol.lastSequence = sequence;
+      symbol.lastChangeNs = nowNs;
+      if (symbol.stale.load(std::memory_order_relaxed)) {
+        symbol.stale.store(false, std::memory_order_release);
+        m_staleCount.fetch_sub(1, std::memory_order_acq_rel);
+        qDebug() << "Feed of" << symbol.name.c_str() << "recovered after"
+                 << symbol.attempts << "attempt(s)";
+      }
+      continue;
+    }
+
+    auto const silence = silenceNs(symbol);
+    if (!symbol.stale.load(std::memory_order_relaxed)) {
+      if (nowNs - symbol.lastChangeNs <= silence)
+        continue;
+      symbol.stale.store(true, std::memory_order_release);
+      m_staleCount.fetch_add(1, std::memory_order_acq_rel);
+      symbol.attempts = 0;
+      symbol.nextActionNs = nowNs;
+      qDebug() << "Feed of" << symbol.name.c_str() << "silent for"
+               << (nowNs - symbol.lastChangeNs) / 1'000'000 << "ms";
+    }
+    if (nowNs < symbol.nextActionNs)
+      continue;
+
+    auto const action =
+        symbol.attempts == 0 ? action_e::resubscribe : action_e::reconnect;
+    ++symbol.attempts;
+    symbol.nextActionNs = nowNs + (silence << std::min(symbol.attempts, 4));
+    onSilence(index, action);
+  }
+}
+
+} // namespace korrelator
@@ -0,0 +1,199 @@
+#include "frame_journal.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#include "clock_sync.hpp"
+
+namespace korrelator {
+
+namespace bip = boost::interprocess;
+
+// how often new bytes are written back and the next segment is prepared
+static constexpr auto flushInterval = std::chrono::milliseconds(100);
+static constexpr std::size_t pageSize = 4'096;
+
+frame_journal_t::frame_journal_t(std::filesystem::path directory,
+                                 std::uint32_t const connectionId,
+                                 std::size_t const segmentSize)
+    : m_directory(std::move(directory)), m_connectionId(connectionId),
+      m_segmentSize(segmentSize) {
+  m_retired.reserve(4);
+  m_current = createSegment();
+  m_next = createSegment();
+}
+
+void frame_journal_t::append(char const *data, std::size_t const size,
+                             std::int64_t const monotonicNs) {
+  auto const recordSize = frameRecordSize(size);
+  if (m_writeOffset + recordSize > m_current->size && !rollOver(recordSize)) {
+    m_framesDropped.store(m_framesDropped.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+    return;
+  }
+
+  frame_record_header_t header;
+  header.length = static_cast<std::uint32_t>(size);
+  header.connectionId = m_connectionId;
+  header.monotonicNs = monotonicNs;
+  header.wallNs = steadyToLocalNs(monotonicNs);
+
+  // payload first, so a record cut short by a crash still reads as the end
+  char *const record = m_current->data + m_writeOffset;
+  std::memcpy(record + sizeof(header), data, size);
+  std::memcpy(record, &header, sizeof(header));
+  m_writeOffset += recordSize;
+  m_publishedOffset.store(m_writeOffset, std::memory_order_release);
+  m_framesWritten.store(m_framesWritten.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+}
+
+bool frame_journal_t::rollOver(std::size_t const recordSize) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_next || recordSize > m_next->size)
+    return false;
+  m_retired.push_back(std::move(m_current));
+  m_current = std::move(m_next);
+  m_writeOffset = 0;
+  m_publishedOffset.store(0, std::memory_order_release);
+  return true;
+}
+
+std::unique_ptr<frame_journal_t::segment_t> frame_journal_t::createSegment() {
+  char fileName[64]{};
+  std::snprintf(fileName, sizeof(fileName), "c%u-%06u.frames", m_connectionId,
+                m_nextSegmentIndex);
+  auto const path = m_directory / fileName;
+  std::ofstream(path, std::ios::binary | std::ios::trunc).close();
+  std::filesystem::resize_file(path, m_segmentSize);
+
+  auto segment = std::make_unique<segment_t>();
+  segment->file = bip::file_mapping(path.string().c_str(), bip::read_write);
+  segment->region =
+      bip::mapped_region(segment->file, bip::read_write, 0, m_segmentSize);
+  segment->data = static_cast<char *>(segment->region.get_address());
+  segment->size = m_segmentSize;
+  // fault every page in now rather than on the writer's first touch
+  for (std::size_t i = 0; i < segment->size; i += pageSize)
+    static_cast<char volatile *>(segment->data)[i] = 0;
+  ++m_nextSegmentIndex;
+  return segment;
+}
+
+void frame_journal_t::flush(bool const final) {
+  std::vector<std::unique_ptr<segment_t>> retired;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    retired.swap(m_retired);
+    m_retired.reserve(4);
+
+    if (m_flushedSegment != m_current.get()) {
+      m_flushedSegment = m_current.get();
+      m_flushedOffset = 0;
+    }
+    auto const published = m_publishedOffset.load(std::memory_order_acquire);
+    if (published > m_flushedOffset) {
+      m_current->region.flush(m_flushedOffset, published - m_flushedOffset,
+                              !final);
+      m_flushedOffset = published;
+    }
+  }
+
+  // full segments are written back and unmapped off the lock
+  for (auto &segment : retired)
+    segment->region.flush(0, segment->size, false);
+  retired.clear();
+
+  if (!final && !m_next) {
+    try {
+      auto next = createSegment();
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_next = std::move(next);
+    } catch (std::exception const &e) {
+      qDebug() << "Unable to create frame segment:" << e.what();
+    }
+  }
+}
+
+frame_capture_t::frame_capture_t(std::filesystem::path const &rootDirectory,
+                                 std::size_t const segmentSize)
+    : m_segmentSize(std::max(segmentSize, pageSize)) {
+  char name[64]{};
+  auto const now = std::time(nullptr);
+  std::strftime(name, sizeof(name), "capture-%Y%m%d-%H%M%S",
+                std::localtime(&now));
+  m_directory = rootDirectory / name;
+  std::error_code ec;
+  std::filesystem::create_directories(m_directory, ec);
+  if (ec)
+    qDebug() << "Unable to create" << m_directory.string().c_str()
+             << ec.message().c_str();
+}
+
+frame_capture_t::~frame_capture_t() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopRequested = true;
+  }
+  m_stopCondition.notify_all();
+  if (m_flushThread.joinable())
+    m_flushThread.join();
+
+  for (auto &journal : m_journals) {
+    journal->flush(true);
+    qDebug() << "Frame journal" << journal->connectionId() << "wrote"
+             << journal->framesWritten() << "frames, dropped"
+             << journal->framesDropped();
+  }
+}
+
+frame_journal_t *frame_capture_t::addJournal(std::string const &connectionName) {
+  // only this thread adds journals, so the count can be read unlocked
+  auto const connectionId = static_cast<std::uint32_t>(m_journals.size());
+  std::unique_ptr<frame_journal_t> journal;
+  try {
+    journal = std::make_unique<frame_journal_t>(m_directory, connectionId,
+                                                m_segmentSize);
+  } catch (std::exception const &e) {
+    qDebug() << "Frame capture disabled for" << connectionName.c_str() << ":"
+             << e.what();
+    return nullptr;
+  }
+
+  std::ofstream index(m_directory / "connections.txt", std::ios::app);
+  index << connectionId << '\t' << connectionName << '\n';
+  index.close();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_journals.push_back(std::move(journal));
+  return m_journals.back().get();
+}
+
+void frame_capture_t::start() {
+  if (m_flushThread.joinable())
+    return;
+  m_flushThread = std::thread([this] { flushLoop(); });
+}
+
+void frame_capture_t::flushLoop() {
+  // journals added meanwhile are picked up on the next pass
+  std::vector<frame_journal_t *> journals;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stopCondition.wait_for(lock, flushInterval,
+                                   [this] { return m_stopRequested; })) {
+    journals.clear();
+    for (auto const &journal : m_journals)
+      journals.push_back(journal.get());
+    lock.unlock();
+    for (auto journal : journals)
+      journal->flush(false);
+    lock.lock();
+  }
+}
+
+} // namespace korrelator
@@ -0,0 +1,344 @@
+#include "frame_replay.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <tuple>
+
+#include "binance_websocket.hpp"
+#include "frame_journal.hpp"
+#include "kucoin_websocket.hpp"
+#include "tick_slot.hpp"
+
+namespace korrelator {
+
+namespace bip = boost::interprocess;
+
+static constexpr char const *standbySuffix = " (standby)";
+
+bool capture_reader_t::open(std::filesystem::path const &directory) {
+  m_segments.clear();
+  m_frames.clear();
+  m_connections.clear();
+
+  std::ifstream index(directory / "connections.txt");
+  if (!index) {
+    qDebug() << "No connections.txt in" << directory.string().c_str();
+    return false;
+  }
+  std::string line;
+  while (std::getline(index, line)) {
+    auto const tab = line.find('\t');
+    if (tab == std::string::npos)
+      continue;
+    m_connections[static_cast<std::uint32_t>(std::stoul(line.substr(0, tab)))] =
+        line.substr(tab + 1);
+  }
+
+  // segment names sort in the order they were written
+  std::vector<std::filesystem::path> segmentPaths;
+  std::error_code ec;
+  for (auto const &entry : std::filesystem::directory_iterator(directory, ec))
+    if (entry.is_regular_file() && entry.path().extension() == ".frames")
+      segmentPaths.push_back(entry.path());
+  std::sort(segmentPaths.begin(), segmentPaths.end());
+
+  for (auto const &path : segmentPaths) {
+    if (std::filesystem::file_size(path, ec) < sizeof(frame_record_header_t))
+      continue;
+    try {
+      auto segment = std::make_unique<segment_t>();
+      segment->file = bip::file_mapping(path.string().c_str(), bip::read_only);
+      segment->region = bip::mapped_region(segment->file, bip::read_only);
+      readSegment(*segment);
+      m_segments.push_back(std::move(segment));
+    } catch (std::exception const &e) {
+      qDebug() << "Unable to map" << path.string().c_str() << e.what();
+      return false;
+    }
+  }
+
+  std::stable_sort(m_frames.begin(), m_frames.end(),
+                   [](replay_frame_t const &a, replay_frame_t const &b) {
+                     return std::tie(a.monotonicNs, a.connectionId) <
+                            std::tie(b.monotonicNs, b.connectionId);
+                   });
+  return true;
+}
+
+void capture_reader_t::readSegment(segment_t const &segment) {
+  auto const *const data =
+      static_cast<char const *>(segment.region.get_address());
+  auto const size = segment.region.get_size();
+  std::size_t offset = 0;
+  while (offset + sizeof(frame_record_header_t) <= size) {
+    frame_record_header_t header;
+    std::memcpy(&header, data + offset, sizeof(header));
+    auto const recordSize = frameRecordSize(header.length);
+    if (header.length == 0 || offset + recordSize > size)
+      break;
+
+    replay_frame_t frame;
+    frame.data = data + offset + sizeof(header);
+    frame.length = header.length;
+    frame.connectionId = header.connectionId;
+    frame.monotonicNs = header.monotonicNs;
+    frame.wallNs = header.wallNs;
+    m_frames.push_back(frame);
+    offset += recordSize;
+  }
+}
+
+bool replay_driver_t::open(std::filesystem::path const &directory) {
+  if (!m_reader.open(directory))
+    return false;
+  mapConnections();
+  return true;
+}
+
+// connection names are those of `websocket_manager::connectionNames`,
+// e.g. "Binance spot #1" and its twin "Binance spot #1 (standby)"
+void replay_driver_t::mapConnections() {
+  m_connections.clear();
+  m_arbiters.clear();
+
+  auto const suffixLength = std::strlen(standbySuffix);
+  for (auto const &[connectionId, name] : m_reader.connections()) {
+    connection_t connection;
+    if (name.rfind("Binance ", 0) == 0)
+      connection.exchange = exchange_name_e::binance;
+    else if (name.rfind("KuCoin ", 0) == 0)
+      connection.exchange = exchange_name_e::kucoin;
+    if (name.find(" spot ") != std::string::npos)
+      connection.tradeType = trade_type_e::spot;
+    else if (name.find(" futures ") != std::string::npos)
+      connection.tradeType = trade_type_e::futures;
+    if (name.size() > suffixLength &&
+        name.compare(name.size() - suffixLength, suffixLength,
+                     standbySuffix) == 0) {
+      connection.feedIndex = 1;
+      auto const primaryName = name.substr(0, name.size() - suffixLength);
+      auto &arbiter = m_arbiters[primaryName];
+      if (!arbiter)
+        arbiter = std::make_unique<feed_arbiter_t>(primaryName);
+      connection.arbiter = arbiter.get();
+    }
+    m_connections[connectionId] = connection;
+  }
+
+  // primaries are listed before their standby, point them at the arbiter now
+  for (auto const &[connectionId, name] : m_reader.connections())
+    if (auto iter = m_arbiters.find(name); iter != m_arbiters.end())
+      m_connections[connectionId].arbiter = iter->second.get();
+}
+
+void replay_driver_t::addSubscription(QString const &tokenName,
+                                      trade_type_e const tradeType,
+                                      exchange_name_e const exchange,
+                                      tick_slot_t &priceResult,
+                                      price_source_e const priceSource) {
+  subscription_t subscription;
+  subscription.tokenName = exchange == exchange_name_e::kucoin
+                               ? tokenName.toUpper().toStdString()
+                               : tokenName.toLower().toStdString();
+  subscription.exchange = exchange;
+  subscription.tradeType = tradeType;
+  subscription.priceSource = priceSource;
+  subscription.priceResult = &priceResult;
+  m_subscriptions.push_back(std::move(subscription));
+  ++m_subscriptionsWithoutPrice;
+}
+
+void replay_driver_t::addTimer(std::chrono::milliseconds const firstDue,
+                               std::chrono::milliseconds const interval,
+                               timer_callback_t callback) {
+  replay_timer_t timer;
+  timer.dueNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(firstDue).count();
+  timer.intervalNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count();
+  timer.callback = std::move(callback);
+  m_timers.push_back(std::move(timer));
+}
+
+replay_driver_t::statistics_t replay_driver_t::run(double const speed) {
+  statistics_t stats;
+  auto const &frames = m_reader.frames();
+  if (frames.empty())
+    return stats;
+
+  auto const firstNs = frames.front().monotonicNs;
+  auto const startTime = std::chrono::steady_clock::now();
+  for (auto const &frame : frames) {
+    if (m_stopRequested.load(std::memory_order_relaxed))
+      break;
+
+    if (speed > 0.0) {
+      auto const due =
+          startTime + std::chrono::nanoseconds(static_cast<std::int64_t>(
+                          double(frame.monotonicNs - firstNs) / speed));
+      std::this_thread::sleep_until(due);
+    }
+
+    if (m_primedNs >= 0)
+      fireTimers(frame.monotonicNs - m_primedNs, frame);
+    m_wallTimeNs.store(frame.wallNs, std::memory_order_relaxed);
+    ++stats.frames;
+    if (!interpretFrame(frame))
+      continue;
+    ++stats.ticks;
+
+    if (m_primedNs < 0 && m_subscriptionsWithoutPrice == 0) {
+      m_primedNs = frame.monotonicNs;
+      if (m_primedCallback)
+        m_primedCallback();
+    } else if (m_primedNs >= 0 && m_tickCallback) {
+      m_tickCallback();
+    }
+  }
+
+  stats.elapsedSeconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - startTime)
+                             .count();
+  stats.recordedSeconds =
+      double(frames.back().monotonicNs - firstNs) / 1'000'000'000.0;
+  if (m_primedNs < 0)
+    qDebug() << "The capture has no price for" << m_subscriptionsWithoutPrice
+             << "of the symbols";
+  return stats;
+}
+
+void replay_driver_t::fireTimers(std::int64_t const untilNs,
+                                 replay_frame_t const &frame) {
+  while (true) {
+    // the earliest due timer goes first, the one added first on a tie
+    replay_timer_t *next = nullptr;
+    for (auto &timer : m_timers)
+      if (timer.callback && timer.dueNs <= untilNs &&
+          (next == nullptr || timer.dueNs < next->dueNs))
+        next = &timer;
+    if (next == nullptr)
+      return;
+
+    auto const dueNs = next->dueNs;
+    m_wallTimeNs.store(frame.wallNs - (frame.monotonicNs - m_primedNs - dueNs),
+                       std::memory_order_relaxed);
+    auto callback = next->callback;
+    if (next->intervalNs > 0)
+      next->dueNs += next->intervalNs;
+    else
+      next->callback = nullptr;
+    callback(double(dueNs) / 1'000'000'000.0);
+  }
+}
+
+bool replay_driver_t::interpretFrame(replay_frame_t const &frame) {
+  auto const iter = m_connections.find(frame.connectionId);
+  if (iter == m_connections.end())
+    return false;
+  auto const &connection = iter->second;
+  if (connection.exchange == exchange_name_e::binance)
+    return interpretBinanceFrame(connection, frame);
+  else if (connection.exchange == exchange_name_e::kucoin)
+    return interpretKuCoinFrame(connection, frame);
+  return false;
+}
+
+replay_driver_t::subscription_t *
+replay_driver_t::findSubscription(exchange_name_e const exchange,
+                                  trade_type_e const tradeType,
+                                  std::string const &streamName) {
+  // Binance streams are "btcusdt@aggTrade", keyed by the symbol part
+  auto const symbolLength = std::min(streamName.find('@'), streamName.size());
+  for (auto &subscription : m_subscriptions) {
+    if (subscription.exchange == exchange &&
+        subscription.tradeType == tradeType &&
+        subscription.tokenName.size() == symbolLength &&
+        streamName.compare(0, symbolLength, subscription.tokenName) == 0)
+      return &subscription;
+  }
+  return nullptr;
+}
+
+// like the live feeds, a symbol subscribed more than once (a ref and a
+// traded token) stores to each of its slots
+void replay_driver_t::storePrice(subscription_t const &subscription,
+                                 double const price,
+                                 std::int64_t const eventTimeMs,
+                                 std::int64_t const receiveTimeNs) {
+  for (auto &other : m_subscriptions) {
+    if (other.exchange != subscription.exchange ||
+        other.tradeType != subscription.tradeType ||
+        other.tokenName != subscription.tokenName)
+      continue;
+    other.priceResult->store(price, eventTimeMs, receiveTimeNs);
+    if (!other.hasPrice) {
+      other.hasPrice = true;
+      --m_subscriptionsWithoutPrice;
+    }
+  }
+}
+
+bool replay_driver_t::interpretBinanceFrame(connection_t const &connection,
+                                            replay_frame_t const &frame) {
+  double price = -1.0;
+  std::int64_t eventTimeMs = 0;
+  std::int64_t updateId = 0;
+  subscription_t *subscription = nullptr;
+
+  book_ticker_t ticker;
+  if (binanceGetBookTicker(frame.data, frame.length, m_lastStreamName, ticker,
+                           eventTimeMs, updateId)) {
+    subscription = findSubscription(connection.exchange, connection.tradeType,
+                                    m_lastStreamName);
+    if (subscription == nullptr ||
+        subscription->priceSource == price_source_e::last_trade)
+      return false;
+    price = subscription->priceSource == price_source_e::micro_price
+                ? ticker.microPrice()
+                : ticker.mid();
+  } else {
+    price = binanceGetCoinPrice(frame.data, frame.length, m_lastStreamName,
+                                eventTimeMs, updateId);
+    if (price == -1.0)
+      return false;
+    subscription = findSubscription(connection.exchange, connection.tradeType,
+                                    m_lastStreamName);
+    if (subscription == nullptr ||
+        subscription->priceSource != price_source_e::last_trade)
+      return false;
+  }
+
+  if (connection.arbiter &&
+      !connection.arbiter->accept(m_lastStreamName, updateId,
+                                  connection.feedIndex))
+    return false;
+  storePrice(*subscription, price, eventTimeMs, frame.monotonicNs);
+  return true;
+}
+
+bool replay_driver_t::interpretKuCoinFrame(connection_t const &connection,
+                                           replay_frame_t const &frame) {
+  std::int64_t eventTimeMs = 0;
+  std::int64_t updateId = 0;
+  auto const price = kuCoinGetCoinPrice(
+      frame.data, frame.length, connection.tradeType == trade_type_e::spot,
+      m_lastStreamName, eventTimeMs, updateId);
+  if (price == -1.0)
+    return false;
+
+  auto subscription = findSubscription(connection.exchange,
+                                       connection.tradeType, m_lastStreamName);
+  if (subscription == nullptr ||
+      (connection.arbiter &&
+       !connection.arbiter->accept(m_lastStreamName, updateId,
+                                   connection.feedIndex)))
+    return false;
+  storePrice(*subscription, price, eventTimeMs, frame.monotonicNs);
+  return true;
+}
+
+} // namespace korrelator
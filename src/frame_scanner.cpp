@@ -0,0 +1,141 @@
+#include "frame_scanner.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) ||             \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KORRELATOR_HAS_SSE2 1
+#include <emmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace korrelator {
+
+#ifdef KORRELATOR_HAS_SSE2
+static inline int countTrailingZeros(unsigned int const mask) {
+#ifdef _MSC_VER
+  unsigned long index = 0;
+  _BitScanForward(&index, mask);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+char const *findQuoteOrEscape(char const *first, char const *const last) {
+#ifdef __AVX2__
+  __m256i const quotes256 = _mm256_set1_epi8('"');
+  __m256i const escapes256 = _mm256_set1_epi8('\\');
+  for (; last - first >= 32; first += 32) {
+    __m256i const chunk =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(first));
+    auto const mask = static_cast<unsigned int>(
+        _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_cmpeq_epi8(chunk, quotes256),
+            _mm256_cmpeq_epi8(chunk, escapes256))));
+    if (mask != 0)
+      return first + countTrailingZeros(mask);
+  }
+#endif
+
+#ifdef KORRELATOR_HAS_SSE2
+  __m128i const quotes = _mm_set1_epi8('"');
+  __m128i const escapes = _mm_set1_epi8('\\');
+  for (; last - first >= 16; first += 16) {
+    __m128i const chunk =
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(first));
+    auto const mask = static_cast<unsigned int>(
+        _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quotes),
+                                       _mm_cmpeq_epi8(chunk, escapes))));
+    if (mask != 0)
+      return first + countTrailingZeros(mask);
+  }
+#endif
+
+  for (; first != last; ++first) {
+    if (*first == '"' || *first == '\\')
+      return first;
+  }
+  return last;
+}
+
+static inline char const *skipWhitespace(char const *first,
+                                         char const *const last) {
+  while (first != last &&
+         (*first == ' ' || *first == '\n' || *first == '\r' || *first == '\t'))
+    ++first;
+  return first;
+}
+
+static inline bool isValueDelimiter(char const c) {
+  return c == ',' || c == '}' || c == ']' || c == ' ' || c == '\n' ||
+         c == '\r' || c == '\t';
+}
+
+scan_result_e scanJsonFields(char const *&first, char const *const last,
+                             json_field_t *fields, std::size_t const count) {
+  std::size_t foundCount = 0;
+  char const *current = first;
+
+  // every string, key or value, is consumed as an opening/closing quote pair
+  while (foundCount < count) {
+    char const *const opening = findQuoteOrEscape(current, last);
+    if (opening == last)
+      break;
+    if (*opening == '\\')
+      return scan_result_e::malformed;
+    char const *const closing = findQuoteOrEscape(opening + 1, last);
+    if (closing == last || *closing == '\\')
+      return scan_result_e::malformed;
+
+    current = closing + 1;
+    char const *colon = skipWhitespace(current, last);
+    if (colon == last || *colon != ':')
+      continue; // a string value, not a key
+
+    std::string_view const key(opening + 1, closing - opening - 1);
+    json_field_t *field = nullptr;
+    for (std::size_t i = 0; i < count; ++i) {
+      if (!fields[i].found && fields[i].key == key) {
+        field = &fields[i];
+        break;
+      }
+    }
+    if (!field)
+      continue;
+
+    char const *const valueStart = skipWhitespace(colon + 1, last);
+    if (valueStart == last)
+      return scan_result_e::malformed;
+
+    if (*valueStart == '"') {
+      char const *const valueEnd = findQuoteOrEscape(valueStart + 1, last);
+      if (valueEnd == last || *valueEnd == '\\')
+        return scan_result_e::malformed;
+      field->value =
+          std::string_view(valueStart + 1, valueEnd - valueStart - 1);
+      current = valueEnd + 1;
+    } else if (*valueStart == '{' || *valueStart == '[') {
+      // objects and arrays are not scalar fields, keep scanning inside them
+      field->value = std::string_view{};
+      current = valueStart;
+    } else {
+      char const *valueEnd = valueStart;
+      while (valueEnd != last && !isValueDelimiter(*valueEnd))
+        ++valueEnd;
+      field->value = std::string_view(valueStart, valueEnd - valueStart);
+      current = valueEnd;
+    }
+    field->found = true;
+    ++foundCount;
+  }
+
+  first = current;
+  return foundCount == count ? scan_result_e::found : scan_result_e::missing;
+}
+
+} // namespace korrelator
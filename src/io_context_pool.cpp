@@ -0,0 +1,80 @@
+#include "io_context_pool.hpp"
+
+#include <QDebug>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace korrelator {
+
+static void pinThreadToCpu(std::thread &thread, int const cpu) {
+#ifdef _WIN32
+  if (SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << cpu) == 0)
+    qDebug() << "Unable to pin io thread to CPU" << cpu;
+#elif defined(__linux__)
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(cpu, &cpuSet);
+  if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpuSet),
+                             &cpuSet) != 0)
+    qDebug() << "Unable to pin io thread to CPU" << cpu;
+#else
+  (void)thread;
+  qDebug() << "CPU affinity is not supported, ignoring CPU" << cpu;
+#endif
+}
+
+io_context_pool_t::io_context_pool_t(std::size_t threadCount,
+                                     std::vector<int> cpuAffinity)
+    : m_cpuAffinity(std::move(cpuAffinity)) {
+  if (threadCount == 0)
+    threadCount = 1;
+
+  m_ioContexts.reserve(threadCount);
+  m_workGuards.reserve(threadCount);
+  for (std::size_t i = 0; i < threadCount; ++i) {
+    // a single thread runs each context, so asio may skip its locking
+    m_ioContexts.push_back(std::make_unique<net::io_context>(1));
+    m_workGuards.emplace_back(net::make_work_guard(*m_ioContexts.back()));
+  }
+}
+
+io_context_pool_t::~io_context_pool_t() { stop(); }
+
+net::io_context &io_context_pool_t::nextIOContext() {
+  auto &ioContext = *m_ioContexts[m_nextIOContext];
+  m_nextIOContext = (m_nextIOContext + 1) % m_ioContexts.size();
+  return ioContext;
+}
+
+void io_context_pool_t::run() {
+  if (!m_threads.empty())
+    return;
+
+  m_threads.reserve(m_ioContexts.size());
+  for (std::size_t i = 0; i < m_ioContexts.size(); ++i) {
+    m_threads.emplace_back([ioContext = m_ioContexts[i].get()] {
+      ioContext->run();
+    });
+    if (i < m_cpuAffinity.size() && m_cpuAffinity[i] >= 0)
+      pinThreadToCpu(m_threads.back(), m_cpuAffinity[i]);
+  }
+}
+
+void io_context_pool_t::stop() {
+  for (auto &workGuard : m_workGuards)
+    workGuard.reset();
+  for (auto &ioContext : m_ioContexts)
+    ioContext->stop();
+  for (auto &thread : m_threads) {
+    if (thread.joinable())
+      thread.join();
+  }
+  m_threads.clear();
+}
+
+} // namespace korrelator
@@ -6,8 +6,11 @@
 #include <boost/beast/http/read.hpp>
 #include <boost/beast/http/write.hpp>
 
+#include "clock_sync.hpp"
 #include "constants.hpp"
 #include "crypto.hpp"
+#include "decimal_parser.hpp"
+#include "tls_session_cache.hpp"
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <thread>
@@ -45,27 +48,35 @@ void kucoin_futures_plug::doConnect() {
   m_process = process_e::market_initiated;
   createRequestData();
 
+  if (auto endpoints = dns_cache_t::instance().lookup(
+          constants::kc_futures_api_host, constants::https_port))
+    return onHostResolved(*endpoints);
+
   m_resolver.async_resolve(
-      constants::kc_futures_api_host, "https",
+      constants::kc_futures_api_host, constants::https_port,
       [this](auto const &errorCode, resolver::results_type const &results) {
         if (errorCode) {
           qDebug() << errorCode.message().c_str();
           return;
         }
-        onHostResolved(results);
+        onHostResolved(dns_cache_t::instance().store(
+            constants::kc_futures_api_host, constants::https_port, results));
       });
 }
 
 void kucoin_futures_plug::startConnect() { doConnect(); }
 
-void kucoin_futures_plug::onHostResolved(tcp::resolver::results_type const &result) {
+void kucoin_futures_plug::onHostResolved(
+    dns_cache_t::endpoints_t const &result) {
   beast::get_lowest_layer(m_tcpStream).expires_after(std::chrono::seconds(30));
   beast::get_lowest_layer(m_tcpStream)
-      .async_connect(result, [this](auto const &errorCode, auto const &) {
+      .async_connect(result, [this, started = std::chrono::steady_clock::now()](
+                                 auto const &errorCode, auto const &ip) {
         if (errorCode) {
           qDebug() << errorCode.message().c_str();
           return;
         }
+        dns_cache_t::instance().recordConnect(ip, started);
         performSSLHandshake();
       });
 }
@@ -119,7 +130,8 @@ void kucoin_futures_plug::createRequestData() {
   writer.EndObject(); // }
 
   auto const payload = s.GetString();
-  std::string const unixEpochTime = std::to_string(std::time(nullptr) * 1'000);
+  std::string const unixEpochTime = std::to_string(
+      exchangeNowMs(exchange_name_e::kucoin, trade_type_e::futures));
   auto const stringToSign = unixEpochTime + "POST" + path + payload;
   auto const signature =
       base64_encode(hmac256_encode(stringToSign, m_apiSecret));
@@ -159,14 +171,18 @@ void kucoin_futures_plug::performSSLHandshake() {
     return;
   }
 
-  m_tcpStream.async_handshake(ssl::stream_base::client,
-                              [this](beast::error_code const ec) {
-                                if (ec) {
-                                  qDebug() << ec.message().c_str();
-                                  return;
-                                }
-                                return sendHttpsData();
-                              });
+  auto const started =
+      tls_session_cache_t::instance().beforeHandshake(m_tcpStream.native_handle());
+  m_tcpStream.async_handshake(
+      ssl::stream_base::client, [this, started](beast::error_code const ec) {
+        if (ec) {
+          qDebug() << ec.message().c_str();
+          return;
+        }
+        tls_session_cache_t::instance().afterHandshake(m_tcpStream.native_handle(),
+                                                 started);
+        return sendHttpsData();
+      });
 }
 
 kucoin_futures_plug::kucoin_futures_plug(net::io_context &ioContext,
@@ -269,7 +285,7 @@ void kucoin_futures_plug::onDataReceived(beast::error_code ec, std::size_t const
           auto const quantityIter = dataObject.FindMember("filledValue");
           if (quantityIter != dataObject.MemberEnd())
             m_finalQuantityPurchased =
-                std::stod(quantityIter->value.GetString());
+                stringToDouble(quantityIter->value.GetString());
         }
         goto noErrorEnd;
       } else if (dataObject.HasMember("orderId")) {
@@ -331,7 +347,8 @@ void kucoin_futures_plug::createMonitoringRequest() {
   // order
   std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
-  auto const unixEpochTime = std::to_string(std::time(nullptr) * 1'000);
+  auto const unixEpochTime = std::to_string(
+      exchangeNowMs(exchange_name_e::kucoin, trade_type_e::futures));
   auto const signatureStr =
       base64_encode(hmac256_encode(unixEpochTime + "GET" + path, m_apiSecret));
 
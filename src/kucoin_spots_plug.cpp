@@ -5,8 +5,11 @@
 #include <boost/beast/http/read.hpp>
 #include <boost/beast/http/write.hpp>
 
+#include "clock_sync.hpp"
 #include "constants.hpp"
 #include "crypto.hpp"
+#include "decimal_parser.hpp"
+#include "tls_session_cache.hpp"
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <thread>
@@ -77,27 +80,35 @@ void kucoin_spots_plug::doConnect() {
   if (!createRequestData())
     return;
 
+  if (auto endpoints = dns_cache_t::instance().lookup(
+          constants::kucoin_https_spot_host, constants::https_port))
+    return onHostResolved(*endpoints);
+
   m_resolver.async_resolve(
-      constants::kucoin_https_spot_host, "https",
+      constants::kucoin_https_spot_host, constants::https_port,
       [this](auto const &errorCode, resolver::results_type const &results) {
         if (errorCode) {
           qDebug() << errorCode.message().c_str();
           return;
         }
-        onHostResolved(results);
+        onHostResolved(dns_cache_t::instance().store(
+            constants::kucoin_https_spot_host, constants::https_port, results));
       });
 }
 
 void kucoin_spots_plug::startConnect() { doConnect(); }
 
-void kucoin_spots_plug::onHostResolved(tcp::resolver::results_type const &result) {
+void kucoin_spots_plug::onHostResolved(
+    dns_cache_t::endpoints_t const &result) {
   beast::get_lowest_layer(m_tcpStream).expires_after(std::chrono::seconds(30));
   beast::get_lowest_layer(m_tcpStream)
-      .async_connect(result, [this](auto const &errorCode, auto const &) {
+      .async_connect(result, [this, started = std::chrono::steady_clock::now()](
+                                 auto const &errorCode, auto const &ip) {
         if (errorCode) {
           qDebug() << errorCode.message().c_str();
           return;
         }
+        dns_cache_t::instance().recordConnect(ip, started);
         performSSLHandshake();
       });
 }
@@ -176,7 +187,8 @@ bool kucoin_spots_plug::createRequestData() {
   writer.EndObject(); // }
 
   auto const payload = s.GetString();
-  std::string const unixEpochTime = std::to_string(std::time(nullptr) * 1'000);
+  std::string const unixEpochTime = std::to_string(
+      exchangeNowMs(exchange_name_e::kucoin, trade_type_e::spot));
   auto const stringToSign = unixEpochTime + "POST" + path + payload;
   auto const signature =
       base64_encode(hmac256_encode(stringToSign, m_apiSecret));
@@ -218,14 +230,18 @@ void kucoin_spots_plug::performSSLHandshake() {
     return;
   }
 
-  m_tcpStream.async_handshake(ssl::stream_base::client,
-                              [this](beast::error_code const ec) {
-                                if (ec) {
-                                  qDebug() << ec.message().c_str();
-                                  return;
-                                }
-                                return sendHttpsData();
-                              });
+  auto const started =
+      tls_session_cache_t::instance().beforeHandshake(m_tcpStream.native_handle());
+  m_tcpStream.async_handshake(
+      ssl::stream_base::client, [this, started](beast::error_code const ec) {
+        if (ec) {
+          qDebug() << ec.message().c_str();
+          return;
+        }
+        tls_session_cache_t::instance().afterHandshake(m_tcpStream.native_handle(),
+                                                 started);
+        return sendHttpsData();
+      });
 }
 
 kucoin_spots_plug::kucoin_spots_plug(net::io_context &ioContext,
@@ -368,12 +384,12 @@ void kucoin_spots_plug::parseSuccessfulResponse(JsonObject const &dataObject ) {
       continue;
     }
 
-    m_averagePrice += std::stod(priceIter->value.GetString());
-    totalSize += std::stod(sizeIter->value.GetString());
-    totalFunds += std::stod(fundsIter->value.GetString());
+    m_averagePrice += stringToDouble(priceIter->value.GetString());
+    totalSize += stringToDouble(sizeIter->value.GetString());
+    totalFunds += stringToDouble(fundsIter->value.GetString());
     auto const feeCurrency = feeCurrencyIter->value.GetString();
     if (m_tradeConfig->baseCurrency.compare(feeCurrency, Qt::CaseInsensitive) == 0) {
-      totalCommission += std::stod(feeIter->value.GetString());
+      totalCommission += stringToDouble(feeIter->value.GetString());
     }
   }
 
@@ -447,7 +463,8 @@ void kucoin_spots_plug::createMonitoringRequest() {
 
   std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
-  auto const unixEpochTime = std::to_string(std::time(nullptr) * 1'000);
+  auto const unixEpochTime = std::to_string(
+      exchangeNowMs(exchange_name_e::kucoin, trade_type_e::spot));
   auto const signatureStr =
       base64_encode(hmac256_encode(unixEpochTime + "GET" + path, m_apiSecret));
 
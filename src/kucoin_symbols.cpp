@@ -1,17 +1,17 @@
 #include "kucoin_symbols.hpp"
 #include "constants.hpp"
+#include "decimal_parser.hpp"
 
 #include <QNetworkReply>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 
-static auto const kucoin_spot_tokens_url =
-    QString("https://") + korrelator::constants::kucoin_https_spot_host +
-    "/api/v1/market/allTickers";
-static auto const kucoin_futures_tokens_url =
-    QString("https://") + korrelator::constants::kc_futures_api_host +
-    "/api/v1/contracts/active";
+// built on every call, the hosts may be overridden at startup
+static QString httpsUrl(char const *host, char const *target) {
+  return QString::fromStdString(korrelator::constants::httpsOrigin(host)) +
+         target;
+}
 
 namespace korrelator {
 
@@ -22,20 +22,22 @@ kucoin_symbols::kucoin_symbols(QNetworkAccessManager& networkManager)
 
 void kucoin_symbols::getFuturesSymbols(
     success_callback_t onSuccess, error_callback_t onError) {
-  return sendNetworkRequest(kucoin_futures_tokens_url, trade_type_e::futures,
-                            onSuccess, onError);
+  auto const url =
+      httpsUrl(constants::kc_futures_api_host, "/api/v1/contracts/active");
+  return sendNetworkRequest(url, trade_type_e::futures, onSuccess, onError);
 }
 
 void kucoin_symbols::getSpotsSymbols(
     success_callback_t onSuccess, error_callback_t onError) {
-  return sendNetworkRequest(kucoin_spot_tokens_url, trade_type_e::spot,
-                            onSuccess, onError);
+  auto const url =
+      httpsUrl(constants::kucoin_https_spot_host, "/api/v1/market/allTickers");
+  return sendNetworkRequest(url, trade_type_e::spot, onSuccess, onError);
 }
 
 void kucoin_symbols::getSpotsExchangeInfo(
     token_list_t* spotsContainerPtr, error_callback_t onError) {
-  auto const fullUrl = QString("https://") +
-      korrelator::constants::kucoin_https_spot_host + QString("/api/v1/symbols");
+  auto const fullUrl = httpsUrl(constants::kucoin_https_spot_host,
+                                "/api/v1/symbols");
   QNetworkRequest request(fullUrl);
   request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader,
                     "application/json");
@@ -71,9 +73,9 @@ void kucoin_symbols::getSpotsExchangeInfo(
                                });
       if (iter != container.end()) {
         iter->baseMinSize =
-            itemObject.value("baseMinSize").toString().toDouble();
+            stringToDouble(itemObject.value("baseMinSize").toString());
         iter->quoteMinSize =
-            itemObject.value("quoteMinSize").toString().toDouble();
+            stringToDouble(itemObject.value("quoteMinSize").toString());
         iter->quoteCurrency = itemObject.value("quoteCurrency").toString();
         iter->baseCurrency = itemObject.value("baseCurrency").toString();
 
@@ -135,7 +137,7 @@ void kucoin_symbols::sendNetworkRequest(
           auto const tokenObject = list[i].toObject();
           korrelator::token_t t;
           t.symbolName = tokenObject.value("symbol").toString().toLower();
-          t.realPrice = std::make_shared<double>();
+          t.realPrice = std::make_shared<tick_slot_t>();
 
           if (tokenObject.contains("baseCurrency"))
             t.baseCurrency = tokenObject.value("baseCurrency").toString();
@@ -148,9 +150,9 @@ void kucoin_symbols::sendNetworkRequest(
 
           if (!tokenObject.contains(key)) {
             if (auto const f = tokenObject.value(key2); f.isString())
-              *t.realPrice = f.toString().toDouble();
+              t.realPrice->store(stringToDouble(f.toString()));
             else
-              *t.realPrice = f.toDouble();
+              t.realPrice->store(f.toDouble());
 
             if (tokenObject.contains("multiplier"))
               t.multiplier = tokenObject.value("multiplier").toDouble();
@@ -159,7 +161,8 @@ void kucoin_symbols::sendNetworkRequest(
             if (tokenObject.contains("quoteMinSize"))
               t.quoteMinSize = tokenObject.value("quoteMinSize").toDouble();
           } else {
-            *t.realPrice = tokenObject.value(key).toString().toDouble();
+            t.realPrice->store(
+                stringToDouble(tokenObject.value(key).toString()));
           }
 
           t.exchange = exchange_name_e::kucoin;
@@ -1,12 +1,19 @@
 #include "kucoin_websocket.hpp"
 
 #include <QDebug>
+#include <algorithm>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ssl/context.hpp>
 #include <random>
 #include <rapidjson/document.h>
 
+#include "clock_sync.hpp"
 #include "constants.hpp"
+#include "decimal_parser.hpp"
+#include "depth_snapshot.hpp"
+#include "frame_journal.hpp"
+#include "frame_scanner.hpp"
+#include "tls_session_cache.hpp"
 #include "utils.hpp"
 
 #ifdef _MSC_VER
@@ -15,8 +22,16 @@
 
 namespace korrelator {
 
-double kuCoinGetCoinPrice(char const *str, size_t const size,
-                          bool const isSpot) {
+// a bullet-public token is valid for 24hrs, refresh it a little earlier
+static auto const bulletTokenLifetime = std::chrono::hours(23);
+
+std::mutex kucoin_ws::s_bulletTokenMutex;
+kucoin_ws::bullet_token_t kucoin_ws::s_bulletTokens[2];
+
+static double kuCoinGetCoinPriceDOM(char const *str, size_t const size,
+                                    bool const isSpot, std::string &tokenName,
+                                    std::int64_t &eventTimeMs,
+                                    std::int64_t &updateId) {
   rapidjson::Document d;
   d.Parse(str, size);
 
@@ -24,7 +39,34 @@ double kuCoinGetCoinPrice(char const *str, size_t const size,
   auto iter = jsonObject.FindMember("data");
   if (iter == jsonObject.end() || !iter->value.IsObject())
     return -1.0;
+
+  // topics are of the form "/market/ticker:BTC-USDT"
+  auto const topicIter = jsonObject.FindMember("topic");
+  if (topicIter == jsonObject.end() || !topicIter->value.IsString())
+    return -1.0;
+  char const *const topic = topicIter->value.GetString();
+  char const *const topicEnd = topic + topicIter->value.GetStringLength();
+  char const *const symbol = std::find(topic, topicEnd, ':');
+  if (symbol == topicEnd)
+    return -1.0;
+  tokenName.assign(symbol + 1, topicEnd);
+
   auto const dataObject = iter->value.GetObject();
+  eventTimeMs = updateId = 0;
+  if (auto const sequenceIter = dataObject.FindMember("sequence");
+      sequenceIter != dataObject.MemberEnd()) {
+    if (sequenceIter->value.IsInt64())
+      updateId = sequenceIter->value.GetInt64();
+    else if (sequenceIter->value.IsString())
+      parseInteger(sequenceIter->value.GetString(), updateId);
+  }
+  if (auto const timeIter = dataObject.FindMember(isSpot ? "time" : "ts");
+      timeIter != dataObject.MemberEnd() && timeIter->value.IsInt64()) {
+    eventTimeMs = timeIter->value.GetInt64();
+    if (!isSpot)
+      eventTimeMs /= 1'000'000;
+  }
+
   if (isSpot) {
     auto const priceIter = dataObject.FindMember("price");
     if (priceIter == dataObject.MemberEnd() ||
@@ -32,7 +74,7 @@ double kuCoinGetCoinPrice(char const *str, size_t const size,
       assert(false);
       return -1.0;
     }
-    return std::stod(priceIter->value.GetString());
+    return stringToDouble(priceIter->value.GetString());
   } else {
     auto const bestBidIter = dataObject.FindMember("bestBidPrice");
     auto const bestAskIter = dataObject.FindMember("bestAskPrice");
@@ -43,28 +85,106 @@ double kuCoinGetCoinPrice(char const *str, size_t const size,
       assert(false);
       return -1.0;
     }
-    auto const bidPrice = std::stod(bestBidIter->value.GetString());
-    auto const askPrice = std::stod(bestAskIter->value.GetString());
+    auto const bidPrice = stringToDouble(bestBidIter->value.GetString());
+    auto const askPrice = stringToDouble(bestAskIter->value.GetString());
     return (bidPrice + askPrice) / 2.0;
   }
   return -1.0;
 }
 
+double kuCoinGetCoinPrice(char const *str, size_t const size,
+                          bool const isSpot, std::string &tokenName,
+                          std::int64_t &eventTimeMs, std::int64_t &updateId) {
+  char const *cursor = str;
+  // spot: topic, price, time(ms) and sequence,
+  // futures: topic, bid, ask, ts(ns) and sequence
+  json_field_t fields[5] = {{"topic"},
+                            {isSpot ? "price" : "bestBidPrice"},
+                            {isSpot ? "time" : "bestAskPrice"},
+                            {isSpot ? "sequence" : "ts"},
+                            {"sequence"}};
+  auto const result =
+      scanJsonFields(cursor, str + size, fields, isSpot ? 4 : 5);
+  if (result == scan_result_e::malformed)
+    return kuCoinGetCoinPriceDOM(str, size, isSpot, tokenName, eventTimeMs,
+                                 updateId);
+  // welcome, pong and ack messages have no topic
+  if (!fields[0].found || !fields[1].found || (!isSpot && !fields[2].found))
+    return -1.0;
+
+  // topics are of the form "/market/ticker:BTC-USDT"
+  auto const topic = fields[0].value;
+  auto const separator = topic.find(':');
+  if (separator == std::string_view::npos)
+    return -1.0;
+
+  double price = -1.0;
+  if (!parseDouble(fields[1].value, price))
+    return -1.0;
+  if (!isSpot) {
+    double askPrice = 0.0;
+    if (!parseDouble(fields[2].value, askPrice))
+      return -1.0;
+    price = (price + askPrice) / 2.0;
+  }
+
+  auto const &timeField = fields[isSpot ? 2 : 3];
+  if (!timeField.found || !parseInteger(timeField.value, eventTimeMs))
+    eventTimeMs = 0;
+  else if (!isSpot)
+    eventTimeMs /= 1'000'000;
+  auto const &sequenceField = fields[isSpot ? 3 : 4];
+  if (!sequenceField.found || !parseInteger(sequenceField.value, updateId))
+    updateId = 0;
+  tokenName.assign(topic.data() + separator + 1, topic.size() - separator - 1);
+  return price;
+}
+
 kucoin_ws::kucoin_ws(net::io_context &ioContext, ssl::context &sslContext,
-                     double &priceResult, trade_type_e const tradeType)
+                     trade_type_e const tradeType, feed_arbiter_t *arbiter,
+                     int const feedIndex)
     : m_ioContext(ioContext), m_sslContext(sslContext),
-      m_priceResult(priceResult), m_tradeType(tradeType),
+      m_strand(net::make_strand(ioContext)), m_arbiter(arbiter),
+      m_tradeType(tradeType), m_feedIndex(feedIndex),
       m_isSpotTrade(tradeType == trade_type_e::spot) {}
 
 kucoin_ws::~kucoin_ws() {
   resetPingTimer();
+  m_reconnectTimer.reset();
   m_resolver.reset();
   m_sslWebStream.reset();
-  m_readWriteBuffer.reset();
   m_response.reset();
   m_instanceServers.clear();
   m_websocketToken.clear();
-  m_subscriptionString.clear();
+  m_writeQueue.clear();
+  m_topics.clear();
+}
+
+bool kucoin_ws::loadCachedBulletToken() {
+  std::lock_guard<std::mutex> lock_g(s_bulletTokenMutex);
+  auto const &cache = s_bulletTokens[m_isSpotTrade ? 0 : 1];
+  if (cache.token.empty() || cache.instanceServers.empty() ||
+      std::chrono::steady_clock::now() >= cache.expiresAt)
+    return false;
+  m_websocketToken = cache.token;
+  m_instanceServers = cache.instanceServers;
+  return true;
+}
+
+void kucoin_ws::storeBulletToken() {
+  std::lock_guard<std::mutex> lock_g(s_bulletTokenMutex);
+  auto &cache = s_bulletTokens[m_isSpotTrade ? 0 : 1];
+  cache.token = m_websocketToken;
+  cache.instanceServers = m_instanceServers;
+  cache.expiresAt = std::chrono::steady_clock::now() + bulletTokenLifetime;
+}
+
+void kucoin_ws::invalidateBulletToken() {
+  std::lock_guard<std::mutex> lock_g(s_bulletTokenMutex);
+  auto &cache = s_bulletTokens[m_isSpotTrade ? 0 : 1];
+  // another connection may have refreshed it already
+  if (cache.token == m_websocketToken)
+    cache.token.clear();
 }
 
 void kucoin_ws::restApiInitiateConnection() {
@@ -74,36 +194,50 @@ void kucoin_ws::restApiInitiateConnection() {
 
   resetPingTimer();
   m_websocketToken.clear();
+  m_writeQueue.clear();
   m_tokensSubscribedFor = false;
+  // level2 messages missed while reconnecting can't be recovered
+  resetOrderBooks();
+
+  if (loadCachedBulletToken()) {
+    return net::post(m_strand, [this] { initiateWebsocketConnection(); });
+  }
 
   auto const url = m_isSpotTrade ? constants::kucoin_https_spot_host
                                  : constants::kc_futures_api_host;
-  m_resolver.emplace(m_ioContext);
+  if (auto endpoints =
+          dns_cache_t::instance().lookup(url, constants::https_port))
+    return restApiConnectToResolvedNames(*endpoints);
+
+  m_resolver.emplace(m_strand);
   m_resolver->async_resolve(
-      url, "https",
-      [this](auto const errorCode, resolver::results_type const &results) {
+      url, constants::https_port,
+      [this, url](auto const errorCode, resolver::results_type const &results) {
         if (errorCode) {
           qDebug() << errorCode.message().c_str();
-          return;
+          return scheduleReconnect();
         }
-        restApiConnectToResolvedNames(results);
+        restApiConnectToResolvedNames(
+            dns_cache_t::instance().store(url, constants::https_port, results));
       });
 }
 
 void kucoin_ws::restApiConnectToResolvedNames(
-    results_type const &resolvedNames) {
+    dns_cache_t::endpoints_t const &resolvedNames) {
   m_resolver.reset();
-  m_sslWebStream.emplace(m_ioContext, m_sslContext);
+  m_sslWebStream.emplace(m_strand, m_sslContext);
   beast::get_lowest_layer(*m_sslWebStream)
       .expires_after(std::chrono::seconds(30));
   beast::get_lowest_layer(*m_sslWebStream)
       .async_connect(resolvedNames,
-                     [this](auto const errorCode,
-                            resolver::results_type::endpoint_type const &) {
+                     [this, started = std::chrono::steady_clock::now()](
+                         auto const errorCode,
+                         resolver::results_type::endpoint_type const &ip) {
                        if (errorCode) {
                          qDebug() << errorCode.message().c_str();
-                         return;
+                         return scheduleReconnect();
                        }
+                       dns_cache_t::instance().recordConnect(ip, started);
                        restApiPerformSSLHandshake();
                      });
 }
@@ -119,15 +253,19 @@ void kucoin_ws::restApiPerformSSLHandshake() {
     auto const ec = beast::error_code(static_cast<int>(::ERR_get_error()),
                                       net::error::get_ssl_category());
     qDebug() << ec.message().c_str();
-    return;
+    return scheduleReconnect();
   }
 
+  auto const started = tls_session_cache_t::instance().beforeHandshake(
+      m_sslWebStream->next_layer().native_handle());
   m_sslWebStream->next_layer().async_handshake(
-      ssl::stream_base::client, [this](beast::error_code const ec) {
+      ssl::stream_base::client, [this, started](beast::error_code const ec) {
         if (ec) {
           qDebug() << ec.message().c_str();
-          return;
+          return scheduleReconnect();
         }
+        tls_session_cache_t::instance().afterHandshake(
+            m_sslWebStream->next_layer().native_handle(), started);
         return restApiSendRequest();
       });
 }
@@ -146,7 +284,7 @@ void kucoin_ws::restApiSendRequest() {
       [this](auto const errorCode, auto const) {
         if (errorCode) {
           qDebug() << errorCode.message().c_str();
-          return;
+          return scheduleReconnect();
         }
 
         restApiReceiveResponse();
@@ -154,16 +292,16 @@ void kucoin_ws::restApiSendRequest() {
 }
 
 void kucoin_ws::restApiReceiveResponse() {
-  m_readWriteBuffer.emplace();
+  m_readWriteBuffer.consume(m_readWriteBuffer.size());
   m_response.emplace();
   beast::get_lowest_layer(*m_sslWebStream)
       .expires_after(std::chrono::seconds(20));
-  beast::http::async_read(m_sslWebStream->next_layer(), *m_readWriteBuffer,
+  beast::http::async_read(m_sslWebStream->next_layer(), m_readWriteBuffer,
                           *m_response,
                           [this](auto const errorCode, auto const) {
                             if (errorCode) {
                               qDebug() << errorCode.message().c_str();
-                              return;
+                              return scheduleReconnect();
                             }
 
                             restApiInterpretHttpResponse();
@@ -181,12 +319,12 @@ void kucoin_ws::restApiInterpretHttpResponse() {
     if (responseCodeIter == jsonObject.MemberEnd() ||
         responseCodeIter->value.GetString() != std::string("200000")) {
       qDebug() << response.c_str();
-      return;
+      return scheduleReconnect();
     }
     auto const dataIter = jsonObject.FindMember("data");
     if (dataIter == jsonObject.MemberEnd() || !dataIter->value.IsObject()) {
       qDebug() << "Could not find 'data'" << response.c_str();
-      return;
+      return scheduleReconnect();
     }
     auto const &dataObject = dataIter->value.GetObject();
     m_websocketToken = dataObject.FindMember("token")->value.GetString();
@@ -215,20 +353,52 @@ void kucoin_ws::restApiInterpretHttpResponse() {
     }
   } catch (std::exception const &e) {
     qDebug() << e.what();
-    return;
+    return scheduleReconnect();
   }
 
   m_response.reset();
 
-  if (!m_instanceServers.empty() && !m_websocketToken.empty())
+  if (!m_instanceServers.empty() && !m_websocketToken.empty()) {
+    storeBulletToken();
     initiateWebsocketConnection();
+  }
+}
+
+void kucoin_ws::addSubscription(QString const &tokenName,
+                                tick_slot_t &priceResult) {
+  auto const name = tokenName.toUpper().toStdString();
+  auto topic = findTopic(name);
+  if (topic == nullptr) {
+    m_topics.push_back(topic_data_t{name});
+    topic = &m_topics.back();
+  }
+  auto &slots = topic->priceResults;
+  if (slots.empty())
+    ++m_topicCount;
+  if (std::find(slots.begin(), slots.end(), &priceResult) == slots.end())
+    slots.push_back(&priceResult);
+}
+
+void kucoin_ws::addOrderBook(QString const &tokenName, order_book_t &book) {
+  auto const name = tokenName.toUpper().toStdString();
+  auto topic = findTopic(name);
+  if (topic == nullptr) {
+    m_topics.push_back(topic_data_t{name});
+    topic = &m_topics.back();
+  }
+  if (topic->orderBook == nullptr) {
+    ++m_orderBookCount;
+    ++m_topicCount;
+  }
+  topic->orderBook = &book;
 }
 
-void kucoin_ws::addSubscription(QString const &tokenName) {
-  if (m_tokenList.isEmpty())
-    m_tokenList = tokenName;
-  else
-    m_tokenList += ("," + tokenName);
+kucoin_ws::topic_data_t *kucoin_ws::findTopic(std::string const &tokenName) {
+  for (auto &topic : m_topics) {
+    if (topic.tokenName == tokenName)
+      return &topic;
+  }
+  return nullptr;
 }
 
 void kucoin_ws::initiateWebsocketConnection() {
@@ -245,37 +415,49 @@ void kucoin_ws::initiateWebsocketConnection() {
 
   if (m_instanceServers.empty()) {
     qDebug() << "No server instance found that supports encryption";
-    return;
+    return scheduleReconnect();
   }
 
   m_uri = korrelator::uri(m_instanceServers.back().endpoint);
-  auto const service = m_uri.protocol() != "wss" ? m_uri.protocol() : "443";
-  m_resolver.emplace(m_ioContext);
+  auto const service = !m_uri.port().empty()      ? m_uri.port()
+                       : m_uri.protocol() != "wss" ? m_uri.protocol()
+                                                   : "443";
+  // the instance server rarely changes between bullet tokens
+  if (auto endpoints = dns_cache_t::instance().lookup(m_uri.host(), service))
+    return websockConnectToResolvedNames(std::move(*endpoints));
+
+  m_resolver.emplace(m_strand);
   m_resolver->async_resolve(
       m_uri.host(), service,
-      [this](auto const &errorCode, resolver::results_type const &results) {
+      [this, service](auto const &errorCode,
+                      resolver::results_type const &results) {
         if (errorCode) {
           qDebug() << errorCode.message().c_str();
-          return;
+          return scheduleReconnect();
         }
-        websockConnectToResolvedNames(results);
+        websockConnectToResolvedNames(
+            dns_cache_t::instance().store(m_uri.host(), service, results));
       });
 }
 
 void kucoin_ws::websockConnectToResolvedNames(
-    resolver::results_type const &resolvedNames) {
+    dns_cache_t::endpoints_t endpoints) {
   m_resolver.reset();
-  m_sslWebStream.emplace(m_ioContext, m_sslContext);
+  rotateForFeed(endpoints, m_feedIndex);
+
+  m_sslWebStream.emplace(m_strand, m_sslContext);
   beast::get_lowest_layer(*m_sslWebStream)
       .expires_after(std::chrono::seconds(30));
   beast::get_lowest_layer(*m_sslWebStream)
-      .async_connect(resolvedNames,
-                     [this](auto const errorCode,
-                            resolver::results_type::endpoint_type const &) {
+      .async_connect(endpoints,
+                     [this, started = std::chrono::steady_clock::now()](
+                         auto const errorCode,
+                         resolver::results_type::endpoint_type const &ip) {
                        if (errorCode) {
                          qDebug() << errorCode.message().c_str();
-                         return;
+                         return scheduleReconnect();
                        }
+                       dns_cache_t::instance().recordConnect(ip, started);
                        websockPerformSSLHandshake();
                      });
 }
@@ -289,23 +471,27 @@ void kucoin_ws::websockPerformSSLHandshake() {
     auto const errorCode = beast::error_code(
         static_cast<int>(::ERR_get_error()), net::error::get_ssl_category());
     qDebug() << errorCode.message().c_str();
-    return;
+    return scheduleReconnect();
   }
 
   negotiateWebsocketConnection();
 }
 
 void kucoin_ws::negotiateWebsocketConnection() {
+  auto const started = tls_session_cache_t::instance().beforeHandshake(
+      m_sslWebStream->next_layer().native_handle());
   m_sslWebStream->next_layer().async_handshake(
-      ssl::stream_base::client, [this](beast::error_code const &ec) {
+      ssl::stream_base::client, [this, started](beast::error_code const &ec) {
         if (ec) {
 
           if (ec.category() == net::error::get_ssl_category()) {
             qDebug() << "SSL Category error";
           }
           qDebug() << ec.message().c_str();
-          return;
+          return scheduleReconnect();
         }
+        tls_session_cache_t::instance().afterHandshake(
+            m_sslWebStream->next_layer().native_handle(), started);
         beast::get_lowest_layer(*m_sslWebStream).expires_never();
         performWebsocketHandshake();
       });
@@ -318,8 +504,11 @@ void kucoin_ws::performWebsocketHandshake() {
                                   [this](auto const errorCode) {
                                     if (errorCode) {
                                       qDebug() << errorCode.message().c_str();
-                                      return;
+                                      // the token may have been revoked
+                                      invalidateBulletToken();
+                                      return scheduleReconnect();
                                     }
+                                    m_backoff.reset();
                                     startPingTimer();
                                     waitForMessages();
                                   });
@@ -339,7 +528,14 @@ void kucoin_ws::onPingTimerTick(boost::system::error_code const &ec) {
     return;
   }
 
-  m_sslWebStream->async_ping({}, [this](boost::system::error_code const &){
+  m_sslWebStream->async_ping({}, [this](boost::system::error_code const &ec){
+    // a failed ping is left to the read loop, which reconnects; a reconnect
+    // or a stop may also have reset the timer in the meantime
+    if (ec || !m_pingTimer) {
+      if (ec)
+        qDebug() << "Ping failed" << ec.message().c_str();
+      return;
+    }
     auto const pingIntervalMs = m_instanceServers.back().pingIntervalMs;
     m_pingTimer->expires_from_now(boost::posix_time::milliseconds(pingIntervalMs));
     m_pingTimer->async_wait([this](boost::system::error_code const &errCode){
@@ -350,7 +546,7 @@ void kucoin_ws::onPingTimerTick(boost::system::error_code const &ec) {
 
 void kucoin_ws::startPingTimer() {
   resetPingTimer();
-  m_pingTimer.emplace(m_ioContext);
+  m_pingTimer.emplace(m_strand);
 
   auto const pingIntervalMs = m_instanceServers.back().pingIntervalMs;
   m_pingTimer->expires_from_now(
@@ -360,21 +556,72 @@ void kucoin_ws::startPingTimer() {
   });
 }
 
+void kucoin_ws::scheduleReconnect() {
+  if (m_requestedToStop)
+    return;
+
+  resetPingTimer();
+  m_sslWebStream.reset();
+  m_framesWaiting = false;
+  if (m_heldPriceCount != 0)
+    storeHeldPrices();
+  auto const delay = m_backoff.nextDelay();
+  qDebug() << "Reconnecting KuCoin feed" << m_feedIndex << "in"
+           << delay.count() << "ms";
+  m_reconnectTimer.emplace(m_strand);
+  m_reconnectTimer->expires_after(delay);
+  m_reconnectTimer->async_wait([this](beast::error_code const ec) {
+    if (!ec)
+      restApiInitiateConnection();
+  });
+}
+
 void kucoin_ws::waitForMessages() {
-  m_readWriteBuffer.emplace();
+  bool const holdsPrices = m_heldPriceCount != 0;
+  if (holdsPrices && !m_framesWaiting)
+    storeHeldPrices();
+  // drop the last frame but keep the memory, the loop shouldn't allocate
+  m_readWriteBuffer.consume(m_readWriteBuffer.size());
   m_sslWebStream->async_read(
-      *m_readWriteBuffer,
-      [this](beast::error_code const errorCode, std::size_t const) {
-        if (errorCode == net::error::operation_aborted) {
-          qDebug() << errorCode.message().c_str();
-          return;
-        } else if (errorCode) {
-          qDebug() << errorCode.message().c_str();
-          m_sslWebStream.reset();
-          return restApiInitiateConnection();
-        }
-        interpretGenericMessages();
-      });
+      m_readWriteBuffer,
+      makeRecyclingHandler(
+          m_handlerMemory,
+          [this](beast::error_code const errorCode, std::size_t const) {
+            if (errorCode == net::error::operation_aborted) {
+              qDebug() << errorCode.message().c_str();
+              return;
+            } else if (errorCode) {
+              qDebug() << errorCode.message().c_str();
+              return scheduleReconnect();
+            }
+            interpretGenericMessages();
+          }));
+  if (holdsPrices && m_framesWaiting) {
+    if (!std::exchange(m_heldPriceFlushPosted, true))
+      postHeldPriceFlush();
+    else
+      m_readSinceFlushPosted = true;
+  }
+}
+
+void kucoin_ws::postHeldPriceFlush() {
+  net::post(m_ioContext, makeRecyclingHandler(m_handlerMemory, [this] {
+    net::dispatch(m_strand, makeRecyclingHandler(m_handlerMemory, [this] {
+      if (m_requestedToStop || m_heldPriceCount == 0) {
+        m_heldPriceFlushPosted = false;
+        m_readSinceFlushPosted = false;
+        m_quietFlushPasses = 0;
+        return;
+      }
+      if (std::exchange(m_readSinceFlushPosted, false))
+        m_quietFlushPasses = 0;
+      if (++m_quietFlushPasses < 2)
+        return postHeldPriceFlush();
+      m_heldPriceFlushPosted = false;
+      m_quietFlushPasses = 0;
+      storeHeldPrices();
+    }));
+  }));
 }
 
 void kucoin_ws::interpretGenericMessages() {
@@ -382,42 +629,493 @@ void kucoin_ws::interpretGenericMessages() {
     return;
 
   char const *bufferCstr =
-      static_cast<char const *>(m_readWriteBuffer->cdata().data());
-  size_t const dataLength = m_readWriteBuffer->size();
+      static_cast<char const *>(m_readWriteBuffer.cdata().data());
+  size_t const dataLength = m_readWriteBuffer.size();
+  auto const receiveTimeNs = steadyNowNs();
+  m_latency.onFrame(receiveTimeNs);
+  if (m_journal)
+    m_journal->append(bufferCstr, dataLength, receiveTimeNs);
+  m_framesWaiting = m_conflating && moreFramesWaiting(*m_sslWebStream);
+  std::int64_t eventTimeMs = 0;
+  std::int64_t updateId = 0;
   auto const optPrice =
-      kuCoinGetCoinPrice(bufferCstr, dataLength, m_isSpotTrade);
-  if (optPrice != -1.0)
-    m_priceResult = optPrice;
+      kuCoinGetCoinPrice(bufferCstr, dataLength, m_isSpotTrade,
+                         m_lastTokenName, eventTimeMs, updateId);
+  if (optPrice != -1.0) {
+    m_latency.onTick(eventTimeMs,
+                     steadyToExchangeUs(exchange_name_e::kucoin,
+                                        m_isSpotTrade ? trade_type_e::spot
+                                                      : trade_type_e::futures,
+                                        receiveTimeNs));
+    if (auto topic = findTopic(m_lastTokenName);
+        topic != nullptr && !topic->priceResults.empty() &&
+        (!m_arbiter ||
+         m_arbiter->accept(m_lastTokenName, updateId, m_feedIndex)))
+      storePrice(*topic, optPrice, eventTimeMs, receiveTimeNs);
+  } else if (m_orderBookCount != 0) {
+    interpretDepthMessage(bufferCstr, dataLength);
+  }
 
   if (!m_tokensSubscribedFor)
     return makeSubscription();
   return waitForMessages();
 }
 
+void kucoin_ws::storePrice(topic_data_t &topic, double const price,
+                           std::int64_t const eventTimeMs,
+                           std::int64_t const receiveTimeNs) {
+  auto &held = topic.heldPrice;
+  if (held.isHeld)
+    m_conflatedFrames.fetch_add(1, std::memory_order_relaxed);
+  if (m_framesWaiting) {
+    if (!held.isHeld)
+      ++m_heldPriceCount;
+    held = held_price_t{price, eventTimeMs, receiveTimeNs, true};
+    return;
+  }
+  if (held.isHeld) {
+    held.isHeld = false;
+    --m_heldPriceCount;
+  }
+  for (auto slot : topic.priceResults)
+    slot->store(price, eventTimeMs, receiveTimeNs);
+}
+
+void kucoin_ws::storeHeldPrices() {
+  for (auto &topic : m_topics) {
+    auto &held = topic.heldPrice;
+    if (!held.isHeld)
+      continue;
+    held.isHeld = false;
+    for (auto slot : topic.priceResults)
+      slot->store(held.price, held.eventTimeMs, held.receiveTimeNs);
+  }
+  // topics unsubscribed while holding a price are already gone
+  m_heldPriceCount = 0;
+}
+
 void kucoin_ws::makeSubscription() {
   static char const *const subscriptionFormat = R"({
     "id": %1,
     "type": "subscribe",
-    "topic": "/%2/ticker:%3",
+    "topic": "/%2/%3:%4",
+    "response": false
+  })";
+
+  if (m_topics.empty())
+    return waitForMessages();
+
+  std::vector<std::string const *> tickers, level2s;
+  for (auto const &topic : m_topics) {
+    if (!topic.priceResults.empty())
+      tickers.push_back(&topic.tokenName);
+    if (topic.orderBook)
+      level2s.push_back(&topic.tokenName);
+  }
+
+  auto const subscribe = [this](char const *channel,
+                                std::vector<std::string const *> const &names) {
+    // a single request takes at most `maxTopicsPerRequest` symbols
+    for (size_t i = 0; i < names.size(); i += maxTopicsPerRequest) {
+      auto const last = std::min(names.size(), i + maxTopicsPerRequest);
+      QString tokenList;
+      for (size_t x = i; x < last; ++x) {
+        if (!tokenList.isEmpty())
+          tokenList += ",";
+        tokenList += names[x]->c_str();
+      }
+
+      m_writeQueue.push_back(
+          QString(subscriptionFormat)
+              .arg(get_random_integer())
+              .arg((m_isSpotTrade ? "market" : "contractMarket"), channel,
+                   tokenList)
+              .toStdString());
+    }
+  };
+  subscribe("ticker", tickers);
+  subscribe("level2", level2s);
+
+  m_tokensSubscribedFor = true;
+  if (!m_writeQueue.empty())
+    writeNextMessage();
+  waitForMessages();
+}
+
+void kucoin_ws::queueTopicRequest(char const *type,
+                                  std::string const &tokenName) {
+  static char const *const requestFormat = R"({
+    "id": %1,
+    "type": "%2",
+    "topic": "/%3/ticker:%4",
     "response": false
   })";
+  m_writeQueue.push_back(
+      QString(requestFormat)
+          .arg(get_random_integer())
+          .arg(type, (m_isSpotTrade ? "market" : "contractMarket"),
+               tokenName.c_str())
+          .toStdString());
+  if (m_writeQueue.size() == 1)
+    writeNextMessage();
+}
+
+void kucoin_ws::subscribe(QString const &tokenName,
+                          tick_slot_t &priceResult) {
+  // reserved now so that `canAddSubscription` sees it before the post runs
+  ++m_topicCount;
+  net::post(m_strand, [this, name = tokenName.toUpper().toStdString(),
+                       price = &priceResult] {
+    auto topic = findTopic(name);
+    if (topic == nullptr) {
+      m_topics.push_back(topic_data_t{name});
+      topic = &m_topics.back();
+    }
+    auto &slots = topic->priceResults;
+    bool const isNewTicker = slots.empty();
+    if (!isNewTicker)
+      --m_topicCount;
+    if (std::find(slots.begin(), slots.end(), price) == slots.end())
+      slots.push_back(price);
+    // otherwise the topic is part of the next `makeSubscription`
+    if (isNewTicker && m_tokensSubscribedFor && m_sslWebStream &&
+        m_sslWebStream->is_open())
+      queueTopicRequest("subscribe", name);
+  });
+}
+
+void kucoin_ws::unsubscribe(QString const &tokenName,
+                            tick_slot_t &priceResult) {
+  net::post(m_strand, [this, name = tokenName.toUpper().toStdString(),
+                       price = &priceResult] {
+    auto topic = findTopic(name);
+    if (topic == nullptr)
+      return;
+    auto &slots = topic->priceResults;
+    auto const slot = std::find(slots.begin(), slots.end(), price);
+    if (slot == slots.end())
+      return;
+    slots.erase(slot);
+    // another slot still watches the symbol
+    if (!slots.empty())
+      return;
+    --m_topicCount;
+    // a level2 topic of the same symbol stays
+    if (topic->orderBook == nullptr)
+      m_topics.erase(m_topics.begin() + (topic - m_topics.data()));
+    if (m_tokensSubscribedFor && m_sslWebStream && m_sslWebStream->is_open())
+      queueTopicRequest("unsubscribe", name);
+  });
+}
+
+void kucoin_ws::resubscribe(QString const &tokenName) {
+  net::post(m_strand, [this, name = tokenName.toUpper().toStdString()] {
+    auto topic = findTopic(name);
+    if (topic == nullptr || topic->priceResults.empty() ||
+        !m_tokensSubscribedFor || !m_sslWebStream ||
+        !m_sslWebStream->is_open())
+      return;
+    queueTopicRequest("unsubscribe", name);
+    queueTopicRequest("subscribe", name);
+  });
+}
+
+void kucoin_ws::close(std::function<void()> onClosed) {
+  net::post(m_strand, [this, onClosed = std::move(onClosed)]() mutable {
+    m_requestedToStop = true;
+    resetPingTimer();
+    if (m_reconnectTimer)
+      m_reconnectTimer->cancel();
+    if (!m_sslWebStream || !m_sslWebStream->is_open())
+      return onClosed();
+    // the pending read ends with `closed`, which no longer reconnects
+    m_sslWebStream->async_close(
+        ws::close_code::normal,
+        [onClosed = std::move(onClosed)](beast::error_code const) {
+          onClosed();
+        });
+  });
+}
+
+void kucoin_ws::forceReconnect() {
+  net::post(m_strand, [this] {
+    if (m_requestedToStop || !m_sslWebStream || !m_sslWebStream->is_open())
+      return;
+    qDebug() << "Forcing a reconnect of KuCoin feed" << m_feedIndex;
+    // the pending read is aborted and ignored, the reconnect starts afresh
+    scheduleReconnect();
+  });
+}
+
+// snapshot levels are strings on spot and numbers on futures
+static bool kuCoinReadNumber(rapidjson::Value const &value, double &result) {
+  if (value.IsNumber()) {
+    result = value.GetDouble();
+    return true;
+  }
+  return value.IsString() &&
+         parseDouble(std::string_view(value.GetString(),
+                                      value.GetStringLength()),
+                     result);
+}
+
+static bool kuCoinReadInteger(rapidjson::Value const &value,
+                              std::int64_t &result) {
+  if (value.IsInt64()) {
+    result = value.GetInt64();
+    return true;
+  }
+  return value.IsString() &&
+         parseInteger(std::string_view(value.GetString(),
+                                       value.GetStringLength()),
+                      result);
+}
+
+// spot: {"changes": {"asks": [["price", "size", "sequence"]], "bids": [...]},
+//        "sequenceStart": 1, "sequenceEnd": 2, ...}
+// futures: {"sequence": 18, "change": "5000.0,sell,83", ...}
+static bool kuCoinReadDepthEvent(rapidjson::Value const &data,
+                                 bool const isSpot, std::int64_t &start,
+                                 std::int64_t &end,
+                                 std::vector<level_update_t> &levels,
+                                 std::vector<std::int64_t> &sequences) {
+  if (!isSpot) {
+    auto const sequenceIter = data.FindMember("sequence");
+    auto const changeIter = data.FindMember("change");
+    if (sequenceIter == data.MemberEnd() || changeIter == data.MemberEnd() ||
+        !kuCoinReadInteger(sequenceIter->value, start) ||
+        !changeIter->value.IsString())
+      return false;
+    end = start;
+
+    std::string_view const change(changeIter->value.GetString(),
+                                  changeIter->value.GetStringLength());
+    auto const first = change.find(',');
+    auto const second = change.find(',', first + 1);
+    if (first == std::string_view::npos || second == std::string_view::npos)
+      return false;
+    level_update_t level;
+    auto const side = change.substr(first + 1, second - first - 1);
+    level.side = side == "buy" ? book_side_e::bid : book_side_e::ask;
+    if (!parseDouble(change.substr(0, first), level.price) ||
+        !parseDouble(change.substr(second + 1), level.quantity))
+      return false;
+    levels.push_back(level);
+    sequences.push_back(start);
+    return true;
+  }
+
+  auto const startIter = data.FindMember("sequenceStart");
+  auto const endIter = data.FindMember("sequenceEnd");
+  auto const changesIter = data.FindMember("changes");
+  if (startIter == data.MemberEnd() || endIter == data.MemberEnd() ||
+      changesIter == data.MemberEnd() || !changesIter->value.IsObject() ||
+      !kuCoinReadInteger(startIter->value, start) ||
+      !kuCoinReadInteger(endIter->value, end))
+    return false;
+
+  auto const &changes = changesIter->value;
+  for (auto const side : {book_side_e::bid, book_side_e::ask}) {
+    auto const iter =
+        changes.FindMember(side == book_side_e::bid ? "bids" : "asks");
+    if (iter == changes.MemberEnd() || !iter->value.IsArray())
+      continue;
+    for (auto const &changeJson : iter->value.GetArray()) {
+      if (!changeJson.IsArray())
+        return false;
+      auto const change = changeJson.GetArray();
+      level_update_t level;
+      std::int64_t sequence = 0;
+      level.side = side;
+      if (change.Size() < 3 || !kuCoinReadNumber(change[0], level.price) ||
+          !kuCoinReadNumber(change[1], level.quantity) ||
+          !kuCoinReadInteger(change[2], sequence))
+        return false;
+      // price "0" only advances the sequence
+      if (level.price == 0.0)
+        continue;
+      levels.push_back(level);
+      sequences.push_back(sequence);
+    }
+  }
+  return true;
+}
+
+void kucoin_ws::interpretDepthMessage(char const *str, size_t const size) {
+  rapidjson::Document d;
+  d.Parse(str, size);
+  if (!d.IsObject())
+    return;
+
+  // topics are of the form "/market/level2:BTC-USDT"
+  auto const topicIter = d.FindMember("topic");
+  auto const dataIter = d.FindMember("data");
+  if (topicIter == d.MemberEnd() || dataIter == d.MemberEnd() ||
+      !topicIter->value.IsString() || !dataIter->value.IsObject())
+    return;
+  std::string_view const topicName(topicIter->value.GetString(),
+                                    topicIter->value.GetStringLength());
+  auto const separator = topicName.find(':');
+  if (separator == std::string_view::npos ||
+      topicName.find("/level2") == std::string_view::npos)
+    return;
+
+  auto topic = findTopic(std::string(topicName.substr(separator + 1)));
+  if (topic == nullptr || topic->orderBook == nullptr)
+    return;
+
+  depth_event_t event;
+  std::vector<level_update_t> levels;
+  std::vector<std::int64_t> sequences;
+  if (!kuCoinReadDepthEvent(dataIter->value, m_isSpotTrade,
+                            event.sequenceStart, event.sequenceEnd, levels,
+                            sequences))
+    return;
+  event.changes.reserve(levels.size());
+  for (size_t i = 0; i < levels.size(); ++i)
+    event.changes.push_back(depth_change_t{levels[i], sequences[i]});
+
+  if (topic->orderBook->isSynced())
+    return applyDepthEvent(*topic, std::move(event));
+
+  static constexpr size_t maxPendingEvents = 5'000;
+  if (topic->pendingDepth.size() >= maxPendingEvents)
+    topic->pendingDepth.erase(topic->pendingDepth.begin());
+  topic->pendingDepth.push_back(std::move(event));
+  requestDepthSnapshot(*topic);
+}
+
+void kucoin_ws::applyDepthEvent(topic_data_t &topic, depth_event_t &&event) {
+  auto &book = *topic.orderBook;
+  auto const lastSequence = book.sequence();
+  if (event.sequenceEnd <= lastSequence)
+    return;
+
+  if (event.sequenceStart > lastSequence + 1) {
+    qDebug() << "Level2 gap on" << topic.tokenName.c_str() << "resyncing";
+    book.invalidate();
+    topic.pendingDepth.push_back(std::move(event));
+    return requestDepthSnapshot(topic);
+  }
+
+  // overlapping messages are allowed, skip the changes already applied
+  std::vector<level_update_t> levels;
+  levels.reserve(event.changes.size());
+  for (auto const &change : event.changes) {
+    if (change.sequence > lastSequence)
+      levels.push_back(change.level);
+  }
+  book.applyUpdates(levels, event.sequenceEnd);
+}
+
+void kucoin_ws::requestDepthSnapshot(topic_data_t &topic) {
+  if (topic.snapshotInFlight || m_requestedToStop)
+    return;
 
-  if (m_subscriptionString.empty()) {
-    m_subscriptionString =
-        QString(subscriptionFormat)
-            .arg(get_random_integer())
-            .arg((m_isSpotTrade ? "market" : "contractMarket"), m_tokenList)
-            .toStdString();
+  topic.snapshotInFlight = true;
+  // the full spot snapshot needs an API key, the public one is 100 deep,
+  // see `onDepthSnapshot`
+  auto const target =
+      QString(m_isSpotTrade ? "/api/v1/market/orderbook/level2_100?symbol=%1"
+                            : "/api/v1/level2/snapshot?symbol=%1")
+          .arg(topic.tokenName.c_str())
+          .toStdString();
+  std::make_shared<depth_snapshot_request_t>(
+      m_strand, m_sslContext,
+      m_isSpotTrade ? constants::kucoin_https_spot_host
+                    : constants::kc_futures_api_host,
+      target,
+      [this, name = topic.tokenName](std::string const &body) {
+        onDepthSnapshot(name, body);
+      })
+      ->run();
+}
+
+void kucoin_ws::onDepthSnapshot(std::string const &tokenName,
+                                std::string const &body) {
+  auto topic = findTopic(tokenName);
+  if (m_requestedToStop || topic == nullptr || topic->orderBook == nullptr)
+    return;
+  // on failure, the next level2 message asks for another snapshot
+  topic->snapshotInFlight = false;
+  if (body.empty())
+    return;
+
+  rapidjson::Document d;
+  d.Parse(body.c_str(), body.size());
+  if (!d.IsObject())
+    return;
+
+  auto const codeIter = d.FindMember("code");
+  auto const dataIter = d.FindMember("data");
+  if (codeIter == d.MemberEnd() || dataIter == d.MemberEnd() ||
+      !codeIter->value.IsString() || !dataIter->value.IsObject() ||
+      std::string_view(codeIter->value.GetString()) != "200000") {
+    qDebug() << "Invalid level2 snapshot" << body.c_str();
+    return;
   }
 
-  m_sslWebStream->async_write(net::buffer(m_subscriptionString),
+  auto const &data = dataIter->value;
+  std::int64_t sequence = 0;
+  auto const sequenceIter = data.FindMember("sequence");
+  if (sequenceIter == data.MemberEnd() ||
+      !kuCoinReadInteger(sequenceIter->value, sequence))
+    return;
+
+  std::vector<price_level_t> sides[2]; // [bids, asks]
+  char const *const sideNames[2] = {"bids", "asks"};
+  for (int i = 0; i < 2; ++i) {
+    auto const iter = data.FindMember(sideNames[i]);
+    if (iter == data.MemberEnd() || !iter->value.IsArray())
+      return;
+    for (auto const &levelJson : iter->value.GetArray()) {
+      if (!levelJson.IsArray())
+        return;
+      auto const level = levelJson.GetArray();
+      price_level_t priceLevel;
+      if (level.Size() < 2 || !kuCoinReadNumber(level[0], priceLevel.price) ||
+          !kuCoinReadNumber(level[1], priceLevel.quantity))
+        return;
+      sides[i].push_back(priceLevel);
+    }
+  }
+  // the spot book stays as deep as its partial snapshot, the futures
+  // snapshot is the full book
+  std::size_t const depthLimit = m_isSpotTrade ? spotSnapshotDepth : 0;
+  topic->orderBook->applySnapshot(std::move(sides[0]), std::move(sides[1]),
+                                  sequence, depthLimit);
+
+  auto pending = std::move(topic->pendingDepth);
+  topic->pendingDepth.clear();
+  for (auto &event : pending) {
+    // a gap in the buffer starts another resync, keep what follows it
+    if (!topic->orderBook->isSynced())
+      topic->pendingDepth.push_back(std::move(event));
+    else
+      applyDepthEvent(*topic, std::move(event));
+  }
+}
+
+void kucoin_ws::resetOrderBooks() {
+  for (auto &topic : m_topics) {
+    if (topic.orderBook == nullptr)
+      continue;
+    topic.orderBook->invalidate();
+    topic.pendingDepth.clear();
+  }
+}
+
+void kucoin_ws::writeNextMessage() {
+  m_sslWebStream->async_write(net::buffer(m_writeQueue.front()),
                               [this](auto const errCode, size_t const) {
                                 if (errCode) {
                                   qDebug() << errCode.message().c_str();
                                   return;
                                 }
-                                m_tokensSubscribedFor = true;
-                                waitForMessages();
+                                if (!m_writeQueue.empty())
+                                  m_writeQueue.pop_front();
+                                if (!m_writeQueue.empty())
+                                  writeNextMessage();
                               });
 }
 
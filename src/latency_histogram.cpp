@@ -0,0 +1,54 @@
+#include "latency_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace korrelator {
+
+std::uint64_t latency_histogram_t::bucketUpperBound(std::size_t const index) {
+  if (index < subBucketCount)
+    return index;
+  auto const shift = static_cast<int>(index / subBucketCount) - 1;
+  auto const subBucket = index % subBucketCount + subBucketCount;
+  return ((subBucket + 1) << shift) - 1;
+}
+
+latency_summary_t latency_histogram_t::summary() const {
+  // copy first, the writer may keep going while we walk the buckets
+  std::vector<std::uint64_t> counts(bucketCount);
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i < bucketCount; ++i) {
+    counts[i] = m_counts[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+
+  latency_summary_t result;
+  result.count = total;
+  if (total == 0)
+    return result;
+  result.max = m_max.load(std::memory_order_relaxed);
+  result.mean = static_cast<double>(m_sum.load(std::memory_order_relaxed)) /
+                static_cast<double>(
+                    std::max<std::uint64_t>(1, m_count.load(
+                                                   std::memory_order_relaxed)));
+
+  auto percentile = [&](double const quantile) -> std::uint64_t {
+    auto const rank = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(
+               std::ceil(quantile * static_cast<double>(total))));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < bucketCount; ++i) {
+      seen += counts[i];
+      if (seen >= rank)
+        return std::min(bucketUpperBound(i), result.max);
+    }
+    return result.max;
+  };
+  result.p50 = percentile(0.50);
+  result.p99 = percentile(0.99);
+  result.p999 = percentile(0.999);
+  return result;
+}
+
+} // namespace korrelator
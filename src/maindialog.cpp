@@ -3,22 +3,28 @@
 
 #include <QCloseEvent>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QMessageBox>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QSslSocket>
 #include <set>
 
 #include "binance_symbols.hpp"
+#include "clock_sync.hpp"
 #include "constants.hpp"
 #include "container.hpp"
 #include "double_trader.hpp"
+#include "feed_watchdog.hpp"
+#include "frame_replay.hpp"
 #include "kucoin_symbols.hpp"
 #include "order_model.hpp"
 #include "qcustomplot.h"
 #include "single_trader.hpp"
+#include "tls_session_cache.hpp"
 #include "websocket_manager.hpp"
 
 namespace korrelator {
@@ -29,22 +35,6 @@ QString actionTypeToString(trade_action_e a) {
   return "SELL";
 }
 
-QString exchangeNameToString(exchange_name_e const ex) {
-  if (ex == exchange_name_e::binance)
-    return "Binance";
-  else if (ex == exchange_name_e::kucoin)
-    return "KuCoin";
-  return QString();
-}
-
-QString marketTypeToString(market_type_e const m) {
-  if (m == market_type_e::market)
-    return "market";
-  else if (m == market_type_e::limit)
-    return "limit";
-  return "unknown";
-}
-
 QString tradeTypeToString(trade_type_e const t) {
   if (t == trade_type_e::futures)
     return "Futures";
@@ -69,40 +59,12 @@ trade_type_e stringToTradeType(QString const &t) {
   return trade_type_e::unknown;
 }
 
-market_type_e stringToMarketType(QString const &m) {
-  if (m.compare("market") == 0)
-    return market_type_e::market;
-  else if (m.compare("limit") == 0)
-    return market_type_e::limit;
-  return market_type_e::unknown;
-}
-
-exchange_name_e stringToExchangeName(QString const &name) {
-  auto const name_ = name.trimmed();
-  if (name_.compare("binance", Qt::CaseInsensitive) == 0)
-    return exchange_name_e::binance;
-  else if (name_.compare("kucoin", Qt::CaseInsensitive) == 0)
-    return exchange_name_e::kucoin;
-  return exchange_name_e::none;
-}
-
-void updateTokenIter(token_t &value) {
-  auto const price = *value.realPrice;
-  if (value.calculatingNewMinMax) {
-    value.minPrice = price * 0.75;
-    value.maxPrice = price * 1.25;
-    value.calculatingNewMinMax = false;
-  }
-
-  value.minPrice = std::min(value.minPrice, price);
-  value.maxPrice = std::max(value.maxPrice, price);
-  value.normalizedPrice =
-      (price - value.minPrice) / (value.maxPrice - value.minPrice);
-}
-
 QSslConfiguration getSSLConfig() {
   auto ssl_config = QSslConfiguration::defaultConfiguration();
   ssl_config.setProtocol(QSsl::TlsV1_2OrLater);
+  // a local mock exchange serves a self-signed certificate
+  if (constants::exchange_host_overridden)
+    ssl_config.setPeerVerifyMode(QSslSocket::VerifyNone);
   return ssl_config;
 }
 
@@ -110,30 +72,6 @@ void configureRequestForSSL(QNetworkRequest &request) {
   request.setSslConfiguration(getSSLConfig());
 }
 
-void token_t::reset() {
-  if (graph && graph->data())
-    graph->data()->clear();
-
-  crossedOver = false;
-  calculatingNewMinMax = true;
-  pricePrecision = quantityPrecision = baseAssetPrecision = quotePrecision = -1;
-  minPrice = prevNormalizedPrice = CMAX_DOUBLE_VALUE;
-  maxPrice = -(CMAX_DOUBLE_VALUE);
-  alpha = 1.0;
-  baseMinSize = 0.0;
-  quoteMinSize = 0.0;
-  normalizedPrice = 0.0;
-  multiplier = 1.0;
-  tickSize = 0.0;
-  graphPointsDrawnCount = 0;
-  graph = nullptr;
-  baseCurrency = quoteCurrency = legendName = "";
-  crossOver.reset();
-
-  if (realPrice)
-    *realPrice = 0.0;
-}
-
 symbol_fetcher_t::symbol_fetcher_t()
     : binance{nullptr}, kucoin{nullptr} {}
 
@@ -153,10 +91,17 @@ MainDialog::MainDialog(bool &warnOnExit,
                        std::filesystem::path const configDirectory,
                        QWidget *parent)
     : QDialog(parent), ui(new Ui::MainDialog), m_currentListWidget(nullptr),
-      m_websocket(nullptr), m_legendLayout(nullptr),
+      m_websocket(nullptr), m_tokens(m_engine.tokens()),
+      m_refs(m_engine.refs()), m_priceDeltas(m_engine.priceDeltas()),
+      m_settings(m_engine.settings()), m_legendLayout(nullptr),
       m_configDirectory(configDirectory), m_warnOnExit(warnOnExit) {
 
   ui->setupUi(this);
+  m_engine.setObserver(this);
+
+  m_clockSync =
+      std::make_unique<korrelator::clock_sync_t>(korrelator::getSSLContext());
+  m_clockSync->start();
 
   m_symbolUpdater.binance.reset(
       new korrelator::binance_symbols(m_networkManager));
@@ -202,11 +147,11 @@ void MainDialog::connectRestartTickSignal() {
   auto getValue =
       [this](int const index) -> std::optional<korrelator::rot_metadata_t> {
     if (index == 0)
-      return m_restartTickValues.normalLines;
+      return m_settings.restartTickValues.normalLines;
     else if (index == 1)
-      return m_restartTickValues.refLines;
+      return m_settings.restartTickValues.refLines;
     else if (index == 3)
-      return m_restartTickValues.special;
+      return m_settings.restartTickValues.special;
     return std::nullopt; // should almost never happen
   };
 
@@ -271,11 +216,17 @@ void MainDialog::takeBackToFactoryReset() {
   enableUIComponents(false);
   ui->startButton->setEnabled(false);
 
-  for (auto &token : m_tokens)
+  // the engine's reset only detaches a token from its graph
+  auto const resetToken = [](token_t &token) {
+    if (token.graph && token.graph->data())
+      token.graph->data()->clear();
     token.reset();
+  };
+  for (auto &token : m_tokens)
+    resetToken(token);
 
   for (auto &token : m_refs)
-    token.reset();
+    resetToken(token);
 
   readTradesConfigFromFile();
 
@@ -304,8 +255,8 @@ void MainDialog::registerCustomTypes() {
 
 void MainDialog::populateUIComponents() {
   // value initialize normal and refLine's `restartOnTickEntry` data to 2500
-  m_restartTickValues.normalLines.emplace().restartOnTickEntry = 2500;
-  m_restartTickValues.refLines.emplace().restartOnTickEntry = 2500;
+  m_settings.restartTickValues.normalLines.emplace().restartOnTickEntry = 2500;
+  m_settings.restartTickValues.refLines.emplace().restartOnTickEntry = 2500;
 
   ui->resetPercentageLine->setValidator(new QDoubleValidator);
   ui->maxRetriesLine->setValidator(new QIntValidator(1, 100));
@@ -363,26 +314,27 @@ bool MainDialog::setRestartTickRowValues(
 void MainDialog::onApplyButtonClicked() {
   using korrelator::tick_line_type_e;
 
+  auto &restartTickValues = m_settings.restartTickValues;
   bool valueSet = false;
   int const index = ui->restartTickCombo->currentIndex();
   if (index == 0) {
-    valueSet = setRestartTickRowValues(m_restartTickValues.normalLines);
-    m_restartTickValues.special.reset();
+    valueSet = setRestartTickRowValues(restartTickValues.normalLines);
+    restartTickValues.special.reset();
   } else if (index == 1) {
-    valueSet = setRestartTickRowValues(m_restartTickValues.refLines);
-    m_restartTickValues.special.reset();
+    valueSet = setRestartTickRowValues(restartTickValues.refLines);
+    restartTickValues.special.reset();
   } else if (index == 2) {
-    valueSet = setRestartTickRowValues(m_restartTickValues.refLines);
-    setRestartTickRowValues(m_restartTickValues.normalLines);
-    m_restartTickValues.special.reset();
+    valueSet = setRestartTickRowValues(restartTickValues.refLines);
+    setRestartTickRowValues(restartTickValues.normalLines);
+    restartTickValues.special.reset();
   } else {
-    setRestartTickRowValues(m_restartTickValues.special);
-    m_restartTickValues.normalLines.reset();
-    m_restartTickValues.refLines.reset();
+    setRestartTickRowValues(restartTickValues.special);
+    restartTickValues.normalLines.reset();
+    restartTickValues.refLines.reset();
   }
 
   if (valueSet)
-    m_restartTickValues.special.reset();
+    restartTickValues.special.reset();
   return ui->restartTickLine->setFocus();
 }
 
@@ -412,6 +364,8 @@ void MainDialog::connectAllUISignals() {
                    &MainDialog::onApplyButtonClicked);
   QObject::connect(ui->exportButton, &QPushButton::clicked, this,
                    &MainDialog::onExportButtonClicked);
+  QObject::connect(ui->feedLatencyButton, &QPushButton::clicked, this,
+                   &MainDialog::onFeedLatencyButtonClicked);
   QObject::connect(this, &MainDialog::newOrderDetected, this,
                    [this](auto a, auto b, exchange_name_e const exchange,
                           trade_type_e const tt) {
@@ -444,7 +398,8 @@ void MainDialog::connectAllUISignals() {
       ui->selectionCombo,
       static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
       this, [this](int const index) {
-        m_maxVisiblePlot = getMaxPlotsInVisibleRegion();
+        m_maxVisiblePlot = m_settings.averageWindow =
+            getMaxPlotsInVisibleRegion();
         if (!m_programIsRunning) {
           double const key = m_elapsedTime.elapsed() / 1'000.0;
           ui->customPlot->xAxis->setRange(key, m_maxVisiblePlot,
@@ -485,14 +440,20 @@ void MainDialog::connectAllUISignals() {
     if (currentRow < 0 || currentRow >= m_currentListWidget->count())
       return;
 
-    auto item = m_currentListWidget->takeItem(currentRow);
-    tokenRemoved(item->text());
-    delete item;
+    auto const text = m_currentListWidget->item(currentRow)->text();
+    if (!m_programIsRunning)
+      tokenRemoved(text);
+    else if (m_currentListWidget != ui->tokenListWidget ||
+             !removeRefWhileRunning(text))
+      return;
+    delete m_currentListWidget->takeItem(currentRow);
     saveAppConfigToFile();
   });
 
   QObject::connect(ui->startButton, &QPushButton::clicked, this,
                    &MainDialog::onOKButtonClicked);
+  QObject::connect(ui->replayButton, &QPushButton::clicked, this,
+                   &MainDialog::onReplayButtonClicked);
 
   QObject::connect(ui->futuresNextButton, &QToolButton::clicked, this, [this] {
     auto const tokenName = ui->futuresCombo->currentText().trimmed();
@@ -509,9 +470,9 @@ void MainDialog::connectAllUISignals() {
     auto const optThreshold = getIntegralValue(ui->umbralLine);
     if (!optThreshold.has_value())
       return;
-    m_findingUmbral = *optThreshold != 0.0;
-    if (m_findingUmbral)
-      m_threshold /= 100.0;
+    m_settings.findingUmbral = *optThreshold != 0.0;
+    if (m_settings.findingUmbral)
+      m_settings.threshold /= 100.0;
   });
 
   QObject::connect(&m_graphPlotter.timer, &QTimer::timeout, this,
@@ -625,6 +586,10 @@ void MainDialog::onNewOrderDetected(korrelator::cross_over_data_t crossOver,
     m_model->AddData(modelData);
   m_model->front()->friendModel = nullptr;
 
+  // a replay only lists the orders it would have made
+  if (m_replay)
+    return;
+
   if (ui->liveTradeCheckbox->isChecked() && !m_apiTradeApiMap.empty()) {
     sendExchangeRequest(modelData, exchange, tradeType, crossOver.action,
                         crossOver.openPrice, origin);
@@ -665,6 +630,7 @@ void MainDialog::enableUIComponents(bool const enabled) {
   ui->doubleTradeCheck->setEnabled(enabled);
   ui->activatePriceDiffCheckbox->setEnabled(enabled);
   ui->averageGroupbox->setEnabled(enabled);
+  ui->replayButton->setEnabled(enabled);
 }
 
 void MainDialog::stopGraphPlotting(bool const requestConfirmation) {
@@ -683,12 +649,21 @@ void MainDialog::stopGraphPlotting(bool const requestConfirmation) {
   ui->spotPrevButton->setEnabled(true);
   ui->startButton->setText("Start");
 
+  stopSignalEvaluator();
   m_graphUpdater.worker.reset();
   m_graphUpdater.thread.reset();
+  if (m_replay) {
+    // the replay runs inside the worker until it sees the request
+    m_replay->requestStop();
+    m_priceUpdater.thread.reset();
+  }
   m_priceUpdater.worker.reset();
   m_priceUpdater.thread.reset();
+  m_replay.reset();
 
   m_programIsRunning = m_tradeOpened = m_firstRun = false;
+  m_pendingSnapshotRequests = 0;
+  ++m_snapshotGeneration;
   if (m_normalizationOrderData)
     m_normalizationOrderData->lastTradeAction =
         korrelator::trade_action_e::nothing;
@@ -708,6 +683,10 @@ void MainDialog::stopGraphPlotting(bool const requestConfirmation) {
   data.tradeType = trade_type_e::unknown;
   m_tokenPlugs.append(std::move(data));
   m_websocket.reset();
+  m_feedWatchdog.reset();
+  detachSignalNotifier();
+  m_retiredPriceSlots.clear();
+  m_engine.reset();
 
   if (m_averagePriceDifferenceTimer &&
       m_averagePriceDifferenceTimer->isActive()) {
@@ -785,6 +764,15 @@ MainDialog::list_iterator MainDialog::find(korrelator::token_list_t &container,
                       });
 }
 
+// the price source of a symbol is remembered per market and exchange
+static QString priceSourceKey(QString const &tokenName,
+                              trade_type_e const tradeType,
+                              exchange_name_e const exchange) {
+  return tokenName.toUpper() +
+         (tradeType == trade_type_e::spot ? "_SPOT" : "_FUTURES") + "(" +
+         korrelator::exchangeNameToString(exchange) + ")";
+}
+
 void MainDialog::newItemAdded(QString const &tokenName, trade_type_e const tt,
                               exchange_name_e const exchange) {
   korrelator::token_t token;
@@ -792,7 +780,10 @@ void MainDialog::newItemAdded(QString const &tokenName, trade_type_e const tt,
   token.tradeType = tt;
   token.exchange = exchange;
   token.calculatingNewMinMax = true;
-  token.realPrice = std::make_shared<double>(0.0);
+  token.realPrice = std::make_shared<korrelator::tick_slot_t>();
+  if (auto iter = m_priceSources.find(priceSourceKey(tokenName, tt, exchange));
+      iter != m_priceSources.end())
+    token.priceSource = iter->second;
 
   if (ui->activatePriceDiffCheckbox->isChecked()) {
     m_priceDeltas.push_back(std::move(token));
@@ -806,7 +797,7 @@ void MainDialog::newItemAdded(QString const &tokenName, trade_type_e const tt,
 
     if (find(m_refs, tokenName, tt, exchange) == m_refs.end()) {
       token.symbolName = tokenName;
-      token.realPrice = std::make_shared<double>();
+      token.realPrice = std::make_shared<korrelator::tick_slot_t>();
       m_refs.push_back(std::move(token));
     }
   } else {
@@ -865,6 +856,92 @@ void MainDialog::tokenRemoved(QString const &text) {
   }
 }
 
+void MainDialog::addRefWhileRunning(QString const &tokenName,
+                                    trade_type_e const tt,
+                                    exchange_name_e const exchange) {
+  korrelator::token_t token;
+  token.symbolName = tokenName;
+  token.tradeType = tt;
+  token.exchange = exchange;
+  token.calculatingNewMinMax = true;
+  token.warmUpEndNs = korrelator::steadyNowNs() +
+                      std::int64_t(m_refWarmUpSeconds) * 1'000'000'000;
+  if (auto iter = m_priceSources.find(priceSourceKey(tokenName, tt, exchange));
+      iter != m_priceSources.end())
+    token.priceSource = iter->second;
+
+  // its own slot even if the symbol is already watched; the feed stores to
+  // every subscribed slot and this one needs a ring before it's written to
+  token.realPrice = std::make_shared<korrelator::tick_slot_t>();
+  if (m_settings.hasReferences && m_tokens.size() >= 2)
+    m_engine.attachTickRing(token);
+  if (m_signalEvaluator.notifier)
+    token.realPrice->setNotifier(m_signalEvaluator.notifier);
+
+  auto const slot = token.realPrice;
+  auto const priceSource = token.priceSource;
+  {
+    std::lock_guard<std::mutex> lock_g(m_signalMutex);
+    m_refs.push_back(std::move(token));
+  }
+  qDebug() << "Reference" << tokenName << "joins in" << m_refWarmUpSeconds
+           << "seconds";
+  watchPricesWhileRunning([this, tokenName, tt, exchange, slot, priceSource] {
+    m_websocket->subscribe(tokenName, tt, exchange, *slot, priceSource);
+  });
+}
+
+bool MainDialog::removeRefWhileRunning(QString const &widgetText) {
+  if (!widgetText.endsWith('*')) {
+    QMessageBox::critical(
+        this, "Error", "Only reference symbols can be removed while running");
+    return false;
+  }
+
+  auto const data = tokenNameFromWidgetName(widgetText);
+  std::shared_ptr<korrelator::tick_slot_t> slot;
+  bool isLastRef = false;
+  {
+    std::lock_guard<std::mutex> lock_g(m_signalMutex);
+    auto iter = find(m_refs, data.tokenName, data.tradeType, data.exchange);
+    if (iter == m_refs.end())
+      return true;
+    isLastRef = m_refs.size() == 1;
+    if (!isLastRef) {
+      slot = iter->realPrice;
+      m_refs.erase(iter);
+      m_engine.refSetChanged();
+    }
+  }
+  if (isLastRef) {
+    QMessageBox::critical(
+        this, "Error",
+        "The last reference symbol can't be removed while running");
+    return false;
+  }
+
+  // the websocket may still write to it until the unsubscribe is through
+  m_retiredPriceSlots.push_back(slot);
+  auto const tokenName = data.tokenName.toLower();
+  auto const tt = data.tradeType;
+  auto const exchange = data.exchange;
+  watchPricesWhileRunning([this, tokenName, tt, exchange, slot] {
+    m_websocket->unsubscribe(tokenName, tt, exchange, *slot);
+  });
+  return true;
+}
+
+// the websocket manager is only touched on the price updater's thread
+void MainDialog::watchPricesWhileRunning(std::function<void()> request) {
+  if (!m_priceUpdater.worker)
+    return;
+  QMetaObject::invokeMethod(m_priceUpdater.worker.get(),
+                            [this, request = std::move(request)] {
+                              if (m_websocket)
+                                request();
+                            });
+}
+
 void MainDialog::getSpotsTokens(korrelator::exchange_name_e const exchange,
                                 callback_t cb) {
   auto errorCallback = [this](QString const &errorMessage) {
@@ -1013,6 +1090,16 @@ void MainDialog::saveAppConfigToFile() {
   if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
     return;
 
+  auto const writePriceSource = [this](QJsonObject &obj,
+                                       QString const &tokenName,
+                                       trade_type_e const tradeType,
+                                       exchange_name_e const exchange) {
+    auto const iter =
+        m_priceSources.find(priceSourceKey(tokenName, tradeType, exchange));
+    if (iter != m_priceSources.end())
+      obj["priceSource"] = korrelator::priceSourceToString(iter->second);
+  };
+
   QJsonObject rootObject;
   rootObject["doubleTrade"] = ui->doubleTradeCheck->isChecked();
   rootObject["umbral"] = ui->umbralLine->text().trimmed().toDouble();
@@ -1020,22 +1107,47 @@ void MainDialog::saveAppConfigToFile() {
   rootObject["maxRetries"] = ui->maxRetriesLine->text().trimmed().toInt();
   rootObject["reverse"] = ui->reverseCheckBox->isChecked();
   rootObject["liveTrade"] = ui->liveTradeCheckbox->isChecked();
-  rootObject["lastPriceAverage"] = m_lastPriceAverage;
+  rootObject["lastPriceAverage"] = m_engine.priceDeltaBand().average;
   rootObject["useLastAverage"] = ui->useLastAverageCheckbox->isChecked();
   rootObject["averagePriceTimer"] =
       ui->averageTimerLine->text().trimmed().toInt();
   rootObject["lastOrderSource"] = static_cast<int>(m_orderOrigin);
   rootObject["averageThreshold"] = ui->averageThresholdLine->text().trimmed();
+  rootObject["tickRingCapacity"] =
+      static_cast<qint64>(m_settings.tickRingCapacity);
+  rootObject["tickRingPolicy"] =
+      m_settings.tickRingPolicy == korrelator::ring_overflow_policy_e::conflate
+          ? "conflate"
+          : "dropOldest";
+  rootObject["eventDrivenSignals"] = m_settings.eventDrivenSignals;
+  rootObject["orderBookDepth"] = m_orderBookDepth;
+  rootObject["ioThreads"] = static_cast<int>(m_ioThreadCount);
+  {
+    QJsonArray affinity;
+    for (auto const cpu : m_ioThreadAffinity)
+      affinity.append(cpu);
+    rootObject["ioThreadAffinity"] = affinity;
+  }
+  rootObject["dualFeed"] = m_dualFeed;
+  rootObject["conflateFrames"] = m_conflateFrames;
+  rootObject["refWarmUpSeconds"] = m_refWarmUpSeconds;
+  rootObject["verifyCertificates"] = m_verifyCertificates;
+  rootObject["staleFeedGate"] = m_staleFeedGate;
+  rootObject["staleFeedSeconds"] = m_staleFeedSeconds;
+  rootObject["frameCapture"] = m_frameCapture;
+  rootObject["frameCaptureSegmentMB"] =
+      static_cast<int>(m_frameCaptureSegmentMB);
 
   {
     QJsonArray jsonTicks;
-    if (auto &special = m_restartTickValues.special; special.has_value())
+    auto const &restartTickValues = m_settings.restartTickValues;
+    if (auto &special = restartTickValues.special; special.has_value())
       jsonTicks.append(getJsonObjectFromRot(*special, "Special"));
 
-    if (auto &value = m_restartTickValues.normalLines; value.has_value())
+    if (auto &value = restartTickValues.normalLines; value.has_value())
       jsonTicks.append(getJsonObjectFromRot(*value, "normalLine"));
 
-    if (auto &ref = m_restartTickValues.refLines; ref.has_value())
+    if (auto &ref = restartTickValues.refLines; ref.has_value())
       jsonTicks.append(getJsonObjectFromRot(*ref, "refLine"));
 
     if (!jsonTicks.isEmpty())
@@ -1053,6 +1165,7 @@ void MainDialog::saveAppConfigToFile() {
       obj["market"] = d.tradeType == trade_type_e::spot ? "spot" : "futures";
       obj["ref"] = displayedName.endsWith('*');
       obj["exchange"] = korrelator::exchangeNameToString(d.exchange);
+      writePriceSource(obj, d.tokenName, d.tradeType, d.exchange);
       tokensJsonList.append(obj);
     }
     rootObject["tokens"] = tokensJsonList;
@@ -1069,6 +1182,7 @@ void MainDialog::saveAppConfigToFile() {
       obj["symbol"] = d.tokenName.toLower();
       obj["market"] = d.tradeType == trade_type_e::spot ? "spot" : "futures";
       obj["exchange"] = korrelator::exchangeNameToString(d.exchange);
+      writePriceSource(obj, d.tokenName, d.tradeType, d.exchange);
       pricesJsonList.append(obj);
     }
     rootObject["priceDeltas"] = pricesJsonList;
@@ -1171,6 +1285,40 @@ void MainDialog::readAppConfigFromFile() {
       ui->averageThresholdLine->setText(
           jsonObject.value("averageThreshold").toString());
 
+      int const defaultRingCapacity =
+          static_cast<int>(korrelator::tick_ring_t::defaultCapacity);
+      m_settings.tickRingCapacity = static_cast<std::size_t>(std::clamp(
+          jsonObject.value("tickRingCapacity").toInt(defaultRingCapacity), 16,
+          1 << 20));
+      m_settings.tickRingPolicy =
+          jsonObject.value("tickRingPolicy").toString() == "conflate"
+              ? korrelator::ring_overflow_policy_e::conflate
+              : korrelator::ring_overflow_policy_e::drop_oldest;
+      m_settings.eventDrivenSignals =
+          jsonObject.value("eventDrivenSignals").toBool(false);
+      m_orderBookDepth = jsonObject.value("orderBookDepth").toBool(false);
+      m_ioThreadCount = static_cast<std::size_t>(
+          std::clamp(jsonObject.value("ioThreads").toInt(1), 1, 64));
+      m_ioThreadAffinity.clear();
+      for (auto const cpu : jsonObject.value("ioThreadAffinity").toArray())
+        m_ioThreadAffinity.push_back(cpu.toInt(-1));
+      m_dualFeed = jsonObject.value("dualFeed").toBool(false);
+      m_conflateFrames = jsonObject.value("conflateFrames").toBool(false);
+      m_refWarmUpSeconds =
+          std::clamp(jsonObject.value("refWarmUpSeconds").toInt(30), 0, 3600);
+      m_verifyCertificates =
+          jsonObject.value("verifyCertificates").toBool(false);
+      // a mock exchange only has a self-signed certificate
+      korrelator::tls_session_cache_t::instance().setPeerVerification(
+          m_verifyCertificates &&
+          !korrelator::constants::exchange_host_overridden);
+      m_staleFeedGate = jsonObject.value("staleFeedGate").toBool(true);
+      m_staleFeedSeconds =
+          std::clamp(jsonObject.value("staleFeedSeconds").toInt(5), 1, 300);
+      m_frameCapture = jsonObject.value("frameCapture").toBool(false);
+      m_frameCaptureSegmentMB = static_cast<std::size_t>(std::clamp(
+          jsonObject.value("frameCaptureSegmentMB").toInt(64), 1, 1024));
+
       {
         ConnectAllTradeRadioSignals(false);
         auto const lastOrderSourceInt =
@@ -1194,7 +1342,8 @@ void MainDialog::readAppConfigFromFile() {
           jsonObject.value("useLastAverage").toBool(false);
       ui->useLastAverageCheckbox->setChecked(useLastSavedAverage);
       if (useLastSavedAverage)
-        m_lastPriceAverage = jsonObject.value("lastPriceAverage").toDouble(0.0);
+        m_engine.priceDeltaBand().average =
+            jsonObject.value("lastPriceAverage").toDouble(0.0);
 
       for (int i = 0; i < jsonTicks.size(); ++i) {
         QJsonObject const tickData = jsonTicks[i].toObject();
@@ -1237,6 +1386,9 @@ void MainDialog::readAppConfigFromFile() {
 
       if (exchange == korrelator::exchange_name_e::none)
         continue;
+      if (obj.contains("priceSource"))
+        m_priceSources[priceSourceKey(tokenName, tradeType, exchange)] =
+            korrelator::stringToPriceSource(obj["priceSource"].toString());
       ui->refCheckBox->setChecked(isRef);
       addNewItemToTokenMap(tokenName, tradeType, exchange);
     }
@@ -1255,6 +1407,9 @@ void MainDialog::readAppConfigFromFile() {
           korrelator::stringToExchangeName(obj["exchange"].toString());
       if (exchange == korrelator::exchange_name_e::none)
         continue;
+      if (obj.contains("priceSource"))
+        m_priceSources[priceSourceKey(tokenName, tradeType, exchange)] =
+            korrelator::stringToPriceSource(obj["priceSource"].toString());
 
       addNewItemToTokenMap(tokenName, tradeType, exchange);
     }
@@ -1447,6 +1602,13 @@ void MainDialog::addNewItemToTokenMap(
     korrelator::exchange_name_e const exchange) {
 
   bool const isPriceWidgetSelected = ui->activatePriceDiffCheckbox->isChecked();
+  if (m_programIsRunning &&
+      (isPriceWidgetSelected || !ui->refCheckBox->isChecked())) {
+    QMessageBox::critical(this, "Error",
+                          "Only reference symbols can be added while running");
+    return;
+  }
+
   QString text = tokenName.toUpper() +
                  (tt == trade_type_e::spot ? "_SPOT" : "_FUTURES") +
                  ("(" + exchangeNameToString(exchange) + ")");
@@ -1467,7 +1629,16 @@ void MainDialog::addNewItemToTokenMap(
                           "The maximum token you can add is two(2).");
     return;
   }
+  if (m_programIsRunning &&
+      find(m_tokens, tokenName, tt, exchange) != m_tokens.end()) {
+    QMessageBox::critical(this, "Error",
+                          "The traded symbol can't also be a reference");
+    return;
+  }
+
   listWidget->addItem(text);
+  if (m_programIsRunning)
+    return addRefWhileRunning(tokenName.toLower(), tt, exchange);
   newItemAdded(tokenName.toLower(), tt, exchange);
 }
 
@@ -1514,7 +1685,7 @@ void MainDialog::setupNormalizedGraphData() {
     int i = 0;
     for (auto &value : m_tokens) {
       if (!value.realPrice)
-        value.realPrice = std::make_shared<double>();
+        value.realPrice = std::make_shared<korrelator::tick_slot_t>();
 
       value.graph = ui->customPlot->addGraph();
       auto const color = colors[i % (sizeof(colors) / sizeof(colors[0]))];
@@ -1620,8 +1791,7 @@ void MainDialog::setupPriceDeltaGraphData() {
 }
 
 void MainDialog::getInitialTokenPrices() {
-  static size_t numberOfRecursions;
-  numberOfRecursions = 0;
+  auto const generation = ++m_snapshotGeneration;
 
   auto normalizePrice = [this](korrelator::token_list_t &list,
                                korrelator::token_list_t &result,
@@ -1632,34 +1802,38 @@ void MainDialog::getInitialTokenPrices() {
       auto iter =
           find(result, value.symbolName, value.tradeType, value.exchange);
       if (iter != result.end()) {
-        value.realPrice = iter->realPrice;
         value.baseCurrency = iter->baseCurrency;
         value.quoteCurrency = iter->quoteCurrency;
         value.calculatingNewMinMax = true;
-        updateTokenIter(value);
+        // the feeds run already and own the slot, a tick that beat the
+        // snapshot is the fresher price
+        auto const livePrice = value.realPrice->price();
+        korrelator::updateTokenIter(
+            value, livePrice != 0.0 ? livePrice : iter->realPrice->price());
       }
     }
   };
 
-  auto foo = [this, normalizePrice](korrelator::token_list_t &&result,
-                                    trade_type_e const tt) {
+  auto foo = [this, normalizePrice, generation](
+                 korrelator::token_list_t &&result, trade_type_e const tt) {
+    // stopped, and maybe started again, while the snapshot was in flight
+    if (generation != m_snapshotGeneration || !m_programIsRunning)
+      return;
     normalizePrice(m_tokens, result, tt);
     normalizePrice(m_refs, result, tt);
 
-    if (--numberOfRecursions == 0) {
-      if (m_hasReferences) {
-        auto price = 0.0;
-        for (auto const &t : m_refs)
-          price += t.normalizedPrice;
-        m_tokens[0].normalizedPrice = (price / (double)m_refs.size());
-      }
+    if (--m_pendingSnapshotRequests == 0) {
+      m_engine.seedRefAverage();
       // after successfully getting the SPOTs and FUTURES' prices,
       // update kucoin's trade config && start the websockets.
       updateKuCoinTradeConfiguration();
       updateTradeConfigurationPrecisions();
       if (m_orderOrigin == korrelator::order_origin_e::from_both)
         m_priceAverageOrderData->dataList = m_normalizationOrderData->dataList;
-      startWebsocket();
+      qDebug() << "REST price snapshot took"
+               << (korrelator::steadyNowNs() - m_startRequestedNs) / 1'000'000
+               << "ms, the feeds connected meanwhile";
+      startSignalEngine();
     }
   };
 
@@ -1670,7 +1844,7 @@ void MainDialog::getInitialTokenPrices() {
     if (t.exchange != exchange_name_e::none)
       exchanges.insert(t.exchange);
 
-  numberOfRecursions = 2 * exchanges.size();
+  m_pendingSnapshotRequests = 2 * exchanges.size();
 
   // get prices of symbols that are on the SPOT "list" first
   for (auto const &exchange : exchanges) {
@@ -1713,22 +1887,21 @@ bool MainDialog::validateUserInput() {
   } else
     return false;
 
-  m_doingAutoLDClosure = false;
-  if (m_restartTickValues.special.has_value()) {
-    m_doingManualLDClosure =
-        m_restartTickValues.special->restartOnTickEntry != 0.0;
-    m_doingAutoLDClosure =
-        m_restartTickValues.special->percentageEntry != 0.0 &&
-        m_restartTickValues.special->specialEntry != 0.0;
+  m_settings.doingAutoLDClosure = false;
+  if (auto const &special = m_settings.restartTickValues.special;
+      special.has_value()) {
+    m_settings.doingManualLDClosure = special->restartOnTickEntry != 0.0;
+    m_settings.doingAutoLDClosure =
+        special->percentageEntry != 0.0 && special->specialEntry != 0.0;
   }
 
   if (auto const threshold = getIntegralValue(ui->umbralLine);
       threshold.has_value()) {
-    m_threshold = *threshold;
-    m_findingUmbral = *threshold != 0.0;
+    m_settings.threshold = *threshold;
+    m_settings.findingUmbral = *threshold != 0.0;
 
-    if (m_findingUmbral)
-      m_threshold /= 100.0;
+    if (m_settings.findingUmbral)
+      m_settings.threshold /= 100.0;
   } else
     return false;
 
@@ -1758,7 +1931,7 @@ bool MainDialog::validateUserInput() {
           getIntegralValue(ui->averageThresholdLine);
       maxAverageThreshold.has_value()) {
     if (*maxAverageThreshold > 0.0) {
-      m_maxAverageThreshold = maxAverageThreshold.value() / 100.0;
+      m_settings.maxAverageThreshold = maxAverageThreshold.value() / 100.0;
     }
   } else {
     return false;
@@ -1850,7 +2023,7 @@ void MainDialog::onStartVerificationSuccessful() {
             korrelator::trade_action_e::nothing;
   }
 
-  m_maxVisiblePlot = getMaxPlotsInVisibleRegion();
+  m_maxVisiblePlot = m_settings.averageWindow = getMaxPlotsInVisibleRegion();
 
   ui->startButton->setText("Stop");
   resetGraphComponents();
@@ -1859,15 +2032,20 @@ void MainDialog::onStartVerificationSuccessful() {
   setupNormalizedGraphData();
   setupPriceDeltaGraphData();
 
-  m_hasReferences = false;
+  m_settings.hasReferences = false;
 
   if (auto iter = find(m_tokens, "*"); iter != m_tokens.end()) {
     if (iter != m_tokens.begin())
       std::iter_swap(iter, m_tokens.begin());
-    m_hasReferences = true;
+    m_settings.hasReferences = true;
   }
 
   setupOrderTableModel();
+  if (m_replay)
+    return startReplay();
+  // the connections are set up while the REST snapshot is downloaded
+  m_startRequestedNs = korrelator::steadyNowNs();
+  startWebsocket();
   getInitialTokenPrices();
 }
 
@@ -1890,16 +2068,39 @@ void MainDialog::onOKButtonClicked() {
   onStartVerificationSuccessful();
 }
 
-void MainDialog::calculatePriceNormalization() {
-  for (auto &token : m_refs)
-    korrelator::updateTokenIter(token);
+void MainDialog::onReplayButtonClicked() {
+  if (ui->tokenListWidget->count() == 0 || m_programIsRunning)
+    return;
+
+  auto const directory = QFileDialog::getExistingDirectory(
+      this, tr("Replay capture"),
+      QString::fromStdString((m_configDirectory / "captures").string()));
+  if (directory.isEmpty())
+    return;
+
+  bool ok = false;
+  auto const speed = QInputDialog::getDouble(
+      this, tr("Replay"), tr("Speed, 0 for as fast as possible"), 1.0, 0.0,
+      1'000.0, 1, &ok);
+  if (!ok || !validateUserInput())
+    return;
+
+  auto replay = std::make_unique<korrelator::replay_driver_t>();
+  if (!replay->open(directory.toStdString())) {
+    QMessageBox::critical(this, tr("Error"),
+                          tr("Unable to read the capture in %1").arg(directory));
+    return;
+  }
+  m_replay = std::move(replay);
+  m_replaySpeed = speed;
+
+  if (ui->tabWidget->currentWidget() != ui->tabCharts)
+    ui->tabWidget->setCurrentWidget(ui->tabCharts);
 
-  if (m_hasReferences && m_tokens.size() == 2)
-    return korrelator::updateTokenIter(m_tokens[1]);
+  if (!m_firstRun)
+    return takeBackToFactoryReset();
 
-  size_t const tokenStartIndex = m_hasReferences ? 1 : 0;
-  for (size_t i = tokenStartIndex; i < m_tokens.size(); ++i)
-    korrelator::updateTokenIter(m_tokens[i]);
+  onStartVerificationSuccessful();
 }
 
 void MainDialog::updateKuCoinTradeConfiguration() {
@@ -1944,41 +2145,71 @@ void MainDialog::updateKuCoinTradeConfiguration() {
   }
 }
 
-void MainDialog::priceLaunchImpl() {
-  m_websocket = std::make_unique<korrelator::websocket_manager>();
-
-  for (auto &tokenInfo : m_refs) {
-    m_websocket->addSubscription(tokenInfo.symbolName, tokenInfo.tradeType,
-                                 tokenInfo.exchange, *tokenInfo.realPrice);
-  }
+void MainDialog::forEachPriceSubscription(
+    std::function<void(korrelator::token_t &)> const &subscribe) {
+  for (auto &tokenInfo : m_refs)
+    subscribe(tokenInfo);
 
   for (auto &tokenInfo : m_tokens) {
     if (tokenInfo.symbolName.length() != 1)
-      m_websocket->addSubscription(tokenInfo.symbolName, tokenInfo.tradeType,
-                                   tokenInfo.exchange, *tokenInfo.realPrice);
+      subscribe(tokenInfo);
   }
 
-  if (!m_priceDeltas.empty()) {
-    for (auto &value : m_priceDeltas) {
-      if (auto iter =
-              find(m_tokens, value.symbolName, value.tradeType, value.exchange);
-          iter != m_tokens.end()) {
+  // price deltas share the slot of a symbol that is already watched
+  for (auto &value : m_priceDeltas) {
+    if (auto iter =
+            find(m_tokens, value.symbolName, value.tradeType, value.exchange);
+        iter != m_tokens.end()) {
+      value.realPrice = iter->realPrice;
+      value.orderBook = iter->orderBook;
+    } else {
+      iter = find(m_refs, value.symbolName, value.tradeType, value.exchange);
+      if (iter != m_refs.end()) {
         value.realPrice = iter->realPrice;
+        value.orderBook = iter->orderBook;
       } else {
-        iter = find(m_refs, value.symbolName, value.tradeType, value.exchange);
-        if (iter != m_refs.end())
-          value.realPrice = iter->realPrice;
-        else
-          m_websocket->addSubscription(value.symbolName, value.tradeType,
-                                       value.exchange, *value.realPrice);
+        subscribe(value);
       }
     }
   }
+}
+
+void MainDialog::priceLaunchImpl() {
+  m_websocket = std::make_unique<korrelator::websocket_manager>(
+      m_ioThreadCount, m_ioThreadAffinity, m_dualFeed);
+  m_websocket->setFeedWatchdog(m_feedWatchdog);
+  m_websocket->setConflation(m_conflateFrames);
 
+  auto const addOrderBook = [this](korrelator::token_t &tokenInfo) {
+    if (!m_orderBookDepth)
+      return;
+    if (!tokenInfo.orderBook)
+      tokenInfo.orderBook = std::make_shared<korrelator::order_book_t>();
+    m_websocket->addOrderBook(tokenInfo.symbolName, tokenInfo.tradeType,
+                              tokenInfo.exchange, *tokenInfo.orderBook);
+  };
+
+  forEachPriceSubscription([this, &addOrderBook](korrelator::token_t &token) {
+    m_websocket->addSubscription(token.symbolName, token.tradeType,
+                                 token.exchange, *token.realPrice,
+                                 token.priceSource);
+    addOrderBook(token);
+  });
+
+  if (m_frameCapture)
+    m_websocket->enableFrameCapture(m_configDirectory / "captures",
+                                    m_frameCaptureSegmentMB * 1024 * 1024);
   m_websocket->startWatch();
 }
 
 void MainDialog::startWebsocket() {
+  // before any websocket or graph thread touches the price slots; ticks
+  // queue up in the rings until the signal engine starts
+  m_engine.attachTickRings();
+  attachSignalNotifier();
+  m_feedWatchdog = std::make_shared<korrelator::feed_watchdog_t>(
+      std::chrono::seconds(m_staleFeedSeconds));
+
   // price updater
   m_priceUpdater.worker =
       std::make_unique<korrelator::Worker>([this] { priceLaunchImpl(); });
@@ -1988,6 +2219,19 @@ void MainDialog::startWebsocket() {
                    m_priceUpdater.worker.get(), &korrelator::Worker::startWork);
   m_priceUpdater.worker->moveToThread(m_priceUpdater.thread.get());
   m_priceUpdater.thread->start();
+}
+
+void MainDialog::startSignalEngine() {
+  startSignalEvaluator();
+
+  // refs can be added and removed while the correlator runs
+  ui->exchangeCombo->setEnabled(true);
+  ui->spotCombo->setEnabled(true);
+  ui->futuresCombo->setEnabled(true);
+  ui->spotNextButton->setEnabled(true);
+  ui->futuresNextButton->setEnabled(true);
+  ui->spotPrevButton->setEnabled(true);
+  ui->refCheckBox->setEnabled(true);
 
   // graph updater
   m_graphUpdater.worker = std::make_unique<korrelator::Worker>([this] {
@@ -1995,24 +2239,8 @@ void MainDialog::startWebsocket() {
       /* Set up and initialize the graph plotting timer */
       m_elapsedTime.restart();
       QObject::connect(
-          &m_timerPlot, &QTimer::timeout, m_graphUpdater.worker.get(), [this] {
-
-            {
-              std::lock_guard<std::mutex> lock_g(m_graphPlotter.mutex);
-              m_lastKeyUsed = m_elapsedTime.elapsed() / 1'000.0;
-            }
-
-            // update the min max on the y-axis every second
-            bool const updatingMinMax =
-                (m_lastKeyUsed - m_lastGraphPoint) >= 1.0;
-            if (updatingMinMax)
-              m_lastGraphPoint = m_lastKeyUsed;
-
-            if (m_calculatingPriceAverage)
-              onPriceDeltaGraphTimerTick(updatingMinMax);
-            if (m_calculatingNormalPrice)
-              onNormalizedGraphTimerTick(updatingMinMax);
-          });
+          &m_timerPlot, &QTimer::timeout, m_graphUpdater.worker.get(),
+          [this] { onGraphClockTick(m_elapsedTime.elapsed() / 1'000.0); });
       m_lastGraphPoint = 0.0;
       auto const timerTick = getTimerTickMilliseconds();
       m_timerPlot.start(timerTick);
@@ -2038,6 +2266,94 @@ void MainDialog::startWebsocket() {
   m_graphPlotter.timer.start(std::chrono::milliseconds(100));
 }
 
+void MainDialog::onGraphClockTick(double const key) {
+  {
+    std::lock_guard<std::mutex> lock_g(m_graphPlotter.mutex);
+    m_lastKeyUsed = key;
+  }
+
+  // update the min max on the y-axis every second
+  bool const updatingMinMax = (m_lastKeyUsed - m_lastGraphPoint) >= 1.0;
+  if (updatingMinMax)
+    m_lastGraphPoint = m_lastKeyUsed;
+
+  // the evaluator thread may be working on the same tokens, and refs can be
+  // added or removed while running
+  std::lock_guard<std::mutex> signalLock(m_signalMutex);
+  if (m_calculatingPriceAverage)
+    m_engine.onPriceDeltaTimerTick(m_lastKeyUsed, updatingMinMax);
+  if (m_calculatingNormalPrice)
+    m_engine.onNormalizedTimerTick(m_lastKeyUsed, updatingMinMax);
+}
+
+void MainDialog::startReplay() {
+  for (auto *list : {&m_refs, &m_tokens, &m_priceDeltas}) {
+    for (auto &token : *list) {
+      if (!token.realPrice && token.symbolName.length() != 1)
+        token.realPrice = std::make_shared<korrelator::tick_slot_t>();
+    }
+  }
+  forEachPriceSubscription([this](korrelator::token_t &token) {
+    m_replay->addSubscription(token.symbolName, token.tradeType,
+                              token.exchange, *token.realPrice,
+                              token.priceSource);
+  });
+  m_engine.attachTickRings();
+  m_engine.startSignals();
+
+  // the first recorded prices stand in for the REST snapshot
+  m_replay->setPrimedCallback([this] {
+    auto const normalize = [](korrelator::token_list_t &list) {
+      for (auto &value : list) {
+        if (value.symbolName.length() == 1 || !value.realPrice)
+          continue;
+        value.calculatingNewMinMax = true;
+        korrelator::updateTokenIter(value);
+      }
+    };
+    normalize(m_refs);
+    normalize(m_tokens);
+    m_engine.seedRefAverage();
+  });
+  // ticks are evaluated as they're replayed, not on a separate thread
+  if (m_settings.eventDrivenSignals)
+    m_replay->setTickCallback([this] { evaluatePendingSignals(); });
+
+  m_lastGraphPoint = 0.0;
+  auto const timerTick = std::chrono::milliseconds(getTimerTickMilliseconds());
+  m_replay->addTimer(timerTick, timerTick,
+                     [this](double const key) { onGraphClockTick(key); });
+  m_replay->addTimer(std::chrono::milliseconds(5'000),
+                     std::chrono::milliseconds(0), [this](double const) {
+                       QMetaObject::invokeMethod(this, [this] {
+                         if (m_replay)
+                           m_tradeOpened = true;
+                       });
+                       calculateAveragePriceDifference();
+                     });
+  if (m_averagePriceDifferenceTimer) {
+    auto const interval = std::chrono::milliseconds(
+        m_averagePriceDifferenceTimer->interval());
+    m_replay->addTimer(interval, interval, [this](double const) {
+      calculateAveragePriceDifference();
+    });
+  }
+
+  m_priceUpdater.worker = std::make_unique<korrelator::Worker>([this] {
+    auto const stats = m_replay->run(m_replaySpeed);
+    qDebug() << "Replayed" << stats.frames << "frames," << stats.ticks
+             << "ticks, of" << stats.recordedSeconds << "s in"
+             << stats.elapsedSeconds << "s:" << stats.ticksPerSecond()
+             << "ticks/s";
+  });
+  m_priceUpdater.thread.reset(new QThread);
+  QObject::connect(m_priceUpdater.thread.get(), &QThread::started,
+                   m_priceUpdater.worker.get(), &korrelator::Worker::startWork);
+  m_priceUpdater.worker->moveToThread(m_priceUpdater.thread.get());
+  m_priceUpdater.thread->start();
+  m_graphPlotter.timer.start(std::chrono::milliseconds(100));
+}
+
 bool calculateSimpleGraphMinMax(QCPGraph *graph, QCPRange const &range,
                                 double &minValue, double &maxValue) {
   bool foundInRange = false;
@@ -2051,40 +2367,8 @@ bool calculateSimpleGraphMinMax(QCPGraph *graph, QCPRange const &range,
 }
 
 void MainDialog::calculateAveragePriceDifference() {
-  if (m_priceDeltas.empty() || m_priceDeltas[0].graph == nullptr)
-    return;
-
-  double const keyStart =
-      (m_lastKeyUsed >= m_maxVisiblePlot ? (m_lastKeyUsed - m_maxVisiblePlot)
-                                         : 0.0);
-  double minValue, maxValue;
-  if (calculateSimpleGraphMinMax(m_priceDeltas[0].graph,
-                                 QCPRange(keyStart, m_lastKeyUsed), minValue,
-                                 maxValue)) {
-    m_lastPriceAverage = (maxValue + minValue) / 2.0;
-
-    qDebug() << "New average:" << m_lastPriceAverage;
-
-    if (m_maxAverageThreshold != 0.0) {
-      m_averageUp = m_lastPriceAverage + m_maxAverageThreshold;
-      m_averageDown = m_lastPriceAverage - m_maxAverageThreshold;
-
-      qDebug() << "M_UP" << m_averageUp << ", M_DOWN" << m_averageDown;
-    }
-  }
-}
-
-korrelator::trade_action_e MainDialog::lineCrossedOver(double const prevA,
-                                                       double const currA,
-                                                       double const prevB,
-                                                       double const currB) {
-  // prevA -> previous ref, prevB -> previous symbol price
-  // currA -> current ref, currB -> current symbol price
-  if ((currA < currB) && (prevB < prevA))
-    return korrelator::trade_action_e::buy;
-  else if ((prevA < prevB) && (currB < currA))
-    return korrelator::trade_action_e::sell;
-  return korrelator::trade_action_e::nothing;
+  std::lock_guard<std::mutex> lock_g(m_signalMutex);
+  m_engine.updatePriceDeltaAverage();
 }
 
 void calculateGraphMinMax(QCPGraph *graph, QCPRange const &range,
@@ -2102,242 +2386,179 @@ void calculateGraphMinMax(QCPGraph *graph, QCPRange const &range,
   }
 }
 
-korrelator::ref_calculation_data_t
-MainDialog::updateRefGraph(double const keyStart, double const keyEnd,
-                           bool const updatingMinMax) {
-  using korrelator::tick_line_type_e;
-
-  korrelator::ref_calculation_data_t refResult;
-
-  auto &value = m_tokens[0];
-  ++value.graphPointsDrawnCount;
-
-  if (!m_doingManualLDClosure) {
-    refResult.isResettingRef =
-        m_restartTickValues.refLines &&
-        value.graphPointsDrawnCount >=
-            (qint64)m_restartTickValues.refLines->restartOnTickEntry;
-  } else {
-    auto const &specialTickValue = m_restartTickValues.special;
-    refResult.eachTickNormalize =
-        specialTickValue.has_value() &&
-        value.graphPointsDrawnCount >= specialTickValue->restartOnTickEntry;
-  }
-
-  if (refResult.isResettingRef || refResult.eachTickNormalize)
-    value.graphPointsDrawnCount = 0;
-
-  // get the normalizedValue
-  double normalizedPrice = 0.0;
-  for (auto const &v : m_refs)
-    normalizedPrice += v.normalizedPrice;
-  normalizedPrice /= ((double)m_refs.size());
-  value.normalizedPrice = normalizedPrice * value.alpha;
+// a silent feed leaves a stale price in the slot, which would read as a
+// spread that isn't there
+bool MainDialog::ordersHeldByStaleFeed() const {
+  return m_staleFeedGate && m_feedWatchdog && m_feedWatchdog->anyStale();
+}
 
-  if (updatingMinMax) {
-    QCPRange const range(keyStart, keyEnd);
-    calculateGraphMinMax(value.graph, range, value.normalizedPrice,
-                         refResult.minValue, refResult.maxValue);
-  }
+// a replay stamps signals with the time they were recorded at
+QString MainDialog::signalTime() const {
+  auto const now =
+      m_replay ? QDateTime::fromMSecsSinceEpoch(m_replay->wallTimeNs() /
+                                                1'000'000)
+               : QDateTime::currentDateTime();
+  return now.toString("yyyy-MM-dd hh:mm:ss");
+}
 
-  value.prevNormalizedPrice = value.normalizedPrice;
+void MainDialog::onCrossOverSignal(korrelator::token_t const &value,
+                                   korrelator::cross_over_data_t crossOver) {
+  // drop it rather than send it late once the feed is back
+  if (ordersHeldByStaleFeed())
+    return;
 
-  {
-    std::lock_guard<std::mutex> lock_g(m_graphPlotter.mutex);
-    value.graph->setName(QString("%1(%2)").arg(value.legendName).arg(value.graphPointsDrawnCount));
-    value.graph->addData(keyEnd, value.normalizedPrice);
-  }
+  korrelator::model_data_t data;
+  data.marketType =
+      (value.tradeType == trade_type_e::spot ? "SPOT" : "FUTURES");
+  data.signalPrice = crossOver.signalPrice;
+  data.openPrice = value.realPrice->price();
+  data.symbol = value.symbolName;
+  data.openTime = signalTime();
+  data.signalTime = crossOver.time;
 
-  return refResult;
+  emit newOrderDetected(std::move(crossOver), std::move(data), value.exchange,
+                        value.tradeType);
 }
 
-void MainDialog::updateGraphData(double const key, bool const updatingMinMax) {
-  using korrelator::tick_line_type_e;
-  using korrelator::trade_action_e;
-
+void MainDialog::onNormalizedPoint(double const key,
+                                   korrelator::token_t const &ref,
+                                   korrelator::token_t const &value,
+                                   bool const updatingMinMax) {
   static char const *const legendDisplayFormat = "%1(%2)";
   double const keyStart =
       (key >= m_maxVisiblePlot ? (key - m_maxVisiblePlot) : 0.0);
-  auto &refSymbol = m_tokens[0];
-  double const prevRef =
-      (m_hasReferences) ? refSymbol.normalizedPrice : CMAX_DOUBLE_VALUE;
-
-  // update ref symbol data on the graph
-  auto refResult = (!m_hasReferences)
-                       ? korrelator::ref_calculation_data_t()
-                       : updateRefGraph(keyStart, key, updatingMinMax);
-  if (!m_hasReferences)
-    return;
-
-  double currentRef = refSymbol.normalizedPrice;
-  bool isResettingSymbols = false;
-
-  // update the real symbols
-  auto &value = m_tokens[1];
-  ++value.graphPointsDrawnCount;
-  if (value.prevNormalizedPrice == CMAX_DOUBLE_VALUE)
-    value.prevNormalizedPrice = value.normalizedPrice;
-
-  isResettingSymbols =
-      !m_doingManualLDClosure && m_restartTickValues.normalLines.has_value() &&
-      (value.graphPointsDrawnCount >=
-       (qint64)m_restartTickValues.normalLines->restartOnTickEntry);
-
-  if (isResettingSymbols)
-    value.graphPointsDrawnCount = 0;
-
-  auto const crossOverDecision = lineCrossedOver(
-      prevRef, currentRef, value.prevNormalizedPrice, value.normalizedPrice);
-
-  if (crossOverDecision != trade_action_e::nothing) {
-    auto &crossOver = value.crossOver.emplace();
-    crossOver.signalPrice = *value.realPrice;
-    crossOver.action = crossOverDecision;
-    crossOver.time =
-        QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-    value.crossedOver = true;
-  }
-
-  if (value.crossedOver) {
-    double amp = 0.0;
-    auto &crossOverValue = *value.crossOver;
-    if (crossOverValue.action == trade_action_e::buy)
-      amp = (value.normalizedPrice / currentRef) - 1.0;
-    else
-      amp = (currentRef / value.normalizedPrice) - 1.0;
-
-    if (m_findingUmbral && amp >= m_threshold) {
-      korrelator::model_data_t data;
-      data.marketType =
-          (value.tradeType == trade_type_e::spot ? "SPOT" : "FUTURES");
-      data.signalPrice = crossOverValue.signalPrice;
-      data.openPrice = *value.realPrice;
-      data.symbol = value.symbolName;
-      data.openTime =
-          QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-      data.signalTime = crossOverValue.time;
-
-      emit newOrderDetected(std::move(crossOverValue), std::move(data),
-                            value.exchange, value.tradeType);
-      value.crossedOver = false;
-      value.crossOver.reset();
-    }
-  }
 
-  if (refResult.eachTickNormalize || m_doingAutoLDClosure) {
-    currentRef /= refSymbol.alpha;
-    auto const distanceFromRefToSymbol = // a
-        ((value.normalizedPrice > currentRef)
-             ? (value.normalizedPrice / currentRef)
-             : (currentRef / value.normalizedPrice)) -
-        1.0;
-    auto const distanceThreshold =
-        m_restartTickValues.special->afterDivisionSpecialEntry; // b
-    bool const resettingRef =
-        m_doingAutoLDClosure &&
-        distanceFromRefToSymbol >
-            m_restartTickValues.special->afterDivisionPercentageEntry;
-
-    if (refResult.eachTickNormalize || resettingRef) {
-      if (value.normalizedPrice > currentRef) {
-        refSymbol.alpha =
-            ((distanceFromRefToSymbol + 1.0) / (distanceThreshold + 1.0));
-      } else {
-        refSymbol.alpha =
-            ((distanceThreshold + 1.0) / (distanceFromRefToSymbol + 1.0));
-      }
-      if (resettingRef)
-        refResult.isResettingRef = true;
-    }
-  }
+  std::lock_guard<std::mutex> lock_g(m_graphPlotter.mutex);
+  ref.graph->setName(QString(legendDisplayFormat)
+                         .arg(ref.legendName)
+                         .arg(ref.graphPointsDrawnCount));
+  ref.graph->addData(key, ref.normalizedPrice);
+  value.graph->addData(key, value.normalizedPrice);
+  value.graph->setName(QString(legendDisplayFormat)
+                           .arg(value.legendName)
+                           .arg(value.graphPointsDrawnCount));
+
+  if (!updatingMinMax)
+    return;
+  QCPRange const range(keyStart, key);
+  double minValue = CMAX_DOUBLE_VALUE;
+  double maxValue = -(CMAX_DOUBLE_VALUE);
+  calculateGraphMinMax(ref.graph, range, ref.normalizedPrice, minValue,
+                       maxValue);
+  calculateGraphMinMax(value.graph, range, value.normalizedPrice, minValue,
+                       maxValue);
+  auto const diff = (maxValue - minValue) / 19.0;
+  ui->customPlot->yAxis->setRange(minValue - diff, maxValue + diff);
+}
+
+void MainDialog::onPriceDeltaPoint(double const key, double const delta,
+                                   bool const updatingMinMax) {
+  QCPGraph *const graph = m_priceDeltas[0].graph;
+  double const keyStart =
+      (key >= m_maxVisiblePlot ? (key - m_maxVisiblePlot) : 0.0);
 
+  std::lock_guard<std::mutex> lock_g(m_graphPlotter.mutex);
   if (updatingMinMax) {
     QCPRange const range(keyStart, key);
-    calculateGraphMinMax(value.graph, range, value.normalizedPrice,
-                         refResult.minValue, refResult.maxValue);
-  }
-
-  value.prevNormalizedPrice = value.normalizedPrice;
-  {
-    std::lock_guard<std::mutex> lock_g(m_graphPlotter.mutex);
-    value.graph->addData(key, value.normalizedPrice);
-    value.graph->setName(QString(legendDisplayFormat)
-                             .arg(value.legendName)
-                             .arg(value.graphPointsDrawnCount));
-  }
-
-  if (refResult.isResettingRef || isResettingSymbols)
-    resetTickerData(refResult.isResettingRef, isResettingSymbols);
-
-  if (updatingMinMax) {
-    auto const diff = (refResult.maxValue - refResult.minValue) / 19.0;
-    refResult.minValue -= diff;
-    refResult.maxValue += diff;
-    {
-      std::lock_guard<std::mutex> lock_g(m_graphPlotter.mutex);
-      ui->customPlot->yAxis->setRange(refResult.minValue, refResult.maxValue);
+    double minValue = 0.0, maxValue = 0.0;
+    if (calculateSimpleGraphMinMax(graph, range, minValue, maxValue)) {
+      auto const diff = (maxValue - minValue) / 11.0;
+      ui->priceDeltaPlot->yAxis->setRange(minValue - diff, maxValue + diff);
     }
   }
+  graph->addData(key, delta);
 }
 
-void MainDialog::onNormalizedGraphTimerTick(bool const updatingMinMax) {
-  calculatePriceNormalization();
-  updateGraphData(m_lastKeyUsed, updatingMinMax);
+void MainDialog::onPriceDeltaSignal(
+    korrelator::trade_action_e const futuresAction) {
+  using korrelator::trade_action_e;
+  if (ordersHeldByStaleFeed())
+    return;
+  auto const spotAction = futuresAction == trade_action_e::sell
+                              ? trade_action_e::buy
+                              : trade_action_e::sell;
+  makePriceAverageOrder(futuresAction, trade_type_e::futures);
+  makePriceAverageOrder(spotAction, trade_type_e::spot);
 }
 
-void MainDialog::onPriceDeltaGraphTimerTick(bool const minMaxNeedsUpdate) {
-  if (m_priceDeltas.empty())
+void MainDialog::attachSignalNotifier() {
+  if (!m_settings.eventDrivenSignals)
     return;
 
-  double const a = *m_priceDeltas[0].realPrice;
-  double const b = *m_priceDeltas[1].realPrice;
-  if (a == 0.0 || b == 0.0)
+  auto notifier = std::make_shared<korrelator::tick_notifier_t>();
+  auto const watch = [&notifier](korrelator::token_list_t &list) {
+    for (auto &token : list) {
+      if (token.realPrice)
+        token.realPrice->setNotifier(notifier);
+    }
+  };
+  watch(m_refs);
+  watch(m_tokens);
+  watch(m_priceDeltas);
+  m_signalEvaluator.notifier = std::move(notifier);
+}
+
+void MainDialog::startSignalEvaluator() {
+  m_engine.startSignals(m_startRequestedNs);
+  if (!m_signalEvaluator.notifier)
     return;
 
-  auto const key = m_lastKeyUsed;
-  double const result = (a + b) / (b == 0.0 ? 1.0 : b);
-  double const keyStart =
-      (key >= m_maxVisiblePlot ? (key - m_maxVisiblePlot) : 0.0);
+  m_signalEvaluator.stopRequested = false;
+  m_signalEvaluator.worker = std::make_unique<korrelator::Worker>(
+      [this] { evaluateSignalsOnTick(); });
+  m_signalEvaluator.thread.reset(new QThread);
+  QObject::connect(m_signalEvaluator.thread.get(), &QThread::started,
+                   m_signalEvaluator.worker.get(),
+                   &korrelator::Worker::startWork);
+  m_signalEvaluator.worker->moveToThread(m_signalEvaluator.thread.get());
+  m_signalEvaluator.thread->start();
+}
 
-  korrelator::token_t &value = m_priceDeltas[0];
-  if (value.calculatingNewMinMax) {
-    value.minPrice = result * 0.95;
-    value.maxPrice = result * 1.05;
-    value.calculatingNewMinMax = false;
-  }
+void MainDialog::stopSignalEvaluator() {
+  if (!m_signalEvaluator.notifier)
+    return;
 
-  QCPGraph *const graph = value.graph;
-  if (minMaxNeedsUpdate) {
-    QCPRange const range(keyStart, key);
-    double minValue = 0.0, maxValue = 0.0;
-    if (calculateSimpleGraphMinMax(graph, range, minValue, maxValue)) {
-      auto const diff = (maxValue - minValue) / 11.0;
-      minValue -= diff;
-      maxValue += diff;
+  m_signalEvaluator.stopRequested = true;
+  m_signalEvaluator.notifier->stop();
+  // the worker is still inside its loop until the thread is joined
+  m_signalEvaluator.thread.reset();
+  m_signalEvaluator.worker.reset();
+}
 
-      {
-        std::lock_guard<std::mutex> lock_g(m_graphPlotter.mutex);
-        ui->priceDeltaPlot->yAxis->setRange(minValue, maxValue);
-      }
-    }
-  }
+// the io threads call notify() from store(), so only once they're joined
+void MainDialog::detachSignalNotifier() {
+  if (!m_signalEvaluator.notifier)
+    return;
 
-  {
-    std::lock_guard<std::mutex> lock_g(m_graphPlotter.mutex);
-    graph->addData(key, result);
+  auto const unwatch = [](korrelator::token_list_t &list) {
+    for (auto &token : list) {
+      if (token.realPrice)
+        token.realPrice->setNotifier(nullptr);
+    }
+  };
+  unwatch(m_refs);
+  unwatch(m_tokens);
+  unwatch(m_priceDeltas);
+  m_signalEvaluator.notifier.reset();
+}
+
+void MainDialog::evaluateSignalsOnTick() {
+  auto const notifier = m_signalEvaluator.notifier;
+  std::uint64_t generation = 0;
+  while (!m_signalEvaluator.stopRequested) {
+    generation = notifier->wait(generation, std::chrono::milliseconds(100));
+    if (m_signalEvaluator.stopRequested)
+      break;
+    evaluatePendingSignals();
   }
+}
 
-  if (m_maxAverageThreshold == 0.0 || m_lastPriceAverage == 0.0)
-    return;
-  if (result > m_averageUp) {
-    makePriceAverageOrder(korrelator::trade_action_e::sell,
-                          trade_type_e::futures);
-    makePriceAverageOrder(korrelator::trade_action_e::buy, trade_type_e::spot);
-  } else if (result < m_averageDown) {
-    makePriceAverageOrder(korrelator::trade_action_e::buy,
-                          trade_type_e::futures);
-    makePriceAverageOrder(korrelator::trade_action_e::sell, trade_type_e::spot);
-  }
+void MainDialog::evaluatePendingSignals() {
+  std::lock_guard<std::mutex> lock_g(m_signalMutex);
+  if (m_calculatingNormalPrice)
+    m_engine.drainTickRings();
+  if (m_calculatingPriceAverage)
+    m_engine.evaluatePriceDeltaTick();
 }
 
 void MainDialog::makePriceAverageOrder(
@@ -2350,10 +2571,10 @@ void MainDialog::makePriceAverageOrder(
   auto const &info = m_priceDeltas[0].tradeType == tradeType ? m_priceDeltas[0]
                                                              : m_priceDeltas[1];
   if (info.realPrice)
-    openPrice = *info.realPrice;
+    openPrice = info.realPrice->price();
 
   crossOver.signalPrice = openPrice;
-  crossOver.time = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
+  crossOver.time = signalTime();
 
   korrelator::model_data_t data;
   data.symbol = info.symbolName;
@@ -2393,19 +2614,6 @@ void MainDialog::updatePlottingKey() {
   }
 }
 
-void MainDialog::resetTickerData(const bool resetRefs,
-                                 const bool resetSymbols) {
-  static auto resetMap = [](auto &map) {
-    for (auto &value : map)
-      value.calculatingNewMinMax = true;
-  };
-
-  if (resetRefs)
-    resetMap(m_refs);
-  if (resetSymbols)
-    resetMap(m_tokens);
-}
-
 void MainDialog::generateJsonFile(korrelator::model_data_t const &modelData) {
   static auto const path =
       QDir::currentPath() + "/correlator/" +
@@ -2759,3 +2967,66 @@ void MainDialog::onExportButtonClicked() {
   QMessageBox::information(
       this, tr("Done"), tr("File successfully exported into %1").arg(fileName));
 }
+
+static QString latencyReportToString(
+    std::vector<korrelator::feed_latency_report_t> const &reports) {
+  QString result;
+  QTextStream textStream(&result);
+  auto const formatSummary = [&textStream](
+                                 char const *label,
+                                 korrelator::latency_summary_t const &s) {
+    textStream << "  " << label << " (us): count " << s.count << ", p50 "
+               << s.p50 << ", p99 " << s.p99 << ", p99.9 " << s.p999
+               << ", max " << s.max << ", mean "
+               << QString::number(s.mean, 'f', 1) << "\n";
+  };
+  for (auto const &report : reports) {
+    textStream << report.name << "\n";
+    formatSummary("latency", report.latency);
+    formatSummary("gaps   ", report.gaps);
+    if (report.aheadOfLocalClock != 0)
+      textStream << "  ticks ahead of local clock: " << report.aheadOfLocalClock
+                 << "\n";
+    if (report.conflatedFrames != 0)
+      textStream << "  prices conflated: " << report.conflatedFrames << "\n";
+  }
+  auto const tls = korrelator::tls_session_cache_t::instance().report();
+  textStream << "TLS handshakes, " << tls.resumed << " resumed of "
+             << (tls.full + tls.resumed) << "\n";
+  formatSummary("full   ", tls.fullUs);
+  formatSummary("resumed", tls.resumedUs);
+  return result;
+}
+
+void MainDialog::onFeedLatencyButtonClicked() {
+  if (!m_websocket) {
+    QMessageBox::information(this, "Feed latency", "No feed is running");
+    return;
+  }
+  auto const report = latencyReportToString(m_websocket->latencyReports());
+  QMessageBox box(QMessageBox::Information, "Feed latency",
+                  "Latency: local receive time minus exchange event time.\n"
+                  "Gaps: time between consecutive frames.",
+                  QMessageBox::Close, this);
+  box.setDetailedText(report);
+  auto saveButton = box.addButton("Save...", QMessageBox::ActionRole);
+  box.exec();
+  if (box.clickedButton() != saveButton)
+    return;
+
+  auto const fileName =
+      QFileDialog::getSaveFileName(this, "Save as", "", "Text Files(*.txt)");
+  if (fileName.isEmpty())
+    return;
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly)) {
+    QMessageBox::critical(
+        this, tr("Error"),
+        tr("Unable to open file because %1").arg(file.errorString()));
+    return;
+  }
+  QTextStream(&file) << report;
+  file.close();
+  QMessageBox::information(
+      this, tr("Done"), tr("File successfully saved into %1").arg(fileName));
+}
@@ -0,0 +1,143 @@
+#include "order_book.hpp"
+
+#include <algorithm>
+
+namespace korrelator {
+
+void order_book_t::applySnapshot(std::vector<price_level_t> bids,
+                                 std::vector<price_level_t> asks,
+                                 std::int64_t const sequence,
+                                 std::size_t const depthLimit) {
+  // exchanges send them sorted already, but don't rely on it
+  std::sort(bids.begin(), bids.end(),
+            [](price_level_t const &a, price_level_t const &b) {
+              return a.price > b.price;
+            });
+  std::sort(asks.begin(), asks.end(),
+            [](price_level_t const &a, price_level_t const &b) {
+              return a.price < b.price;
+            });
+  auto const isEmpty = [](price_level_t const &level) {
+    return level.quantity <= 0.0;
+  };
+  bids.erase(std::remove_if(bids.begin(), bids.end(), isEmpty), bids.end());
+  asks.erase(std::remove_if(asks.begin(), asks.end(), isEmpty), asks.end());
+
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  m_bids = std::move(bids);
+  m_asks = std::move(asks);
+  m_sequence = sequence;
+  m_depthLimit = depthLimit;
+  m_synced = true;
+}
+
+void order_book_t::applyUpdates(std::vector<level_update_t> const &updates,
+                                std::int64_t const sequence) {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  for (auto const &update : updates) {
+    if (update.side == book_side_e::bid)
+      applyLevel(m_bids, true, update.price, update.quantity);
+    else
+      applyLevel(m_asks, false, update.price, update.quantity);
+  }
+  if (m_depthLimit != 0) {
+    m_bids.resize(std::min(m_bids.size(), m_depthLimit));
+    m_asks.resize(std::min(m_asks.size(), m_depthLimit));
+  }
+  m_sequence = sequence;
+}
+
+void order_book_t::applyLevel(std::vector<price_level_t> &levels,
+                              bool const descending, double const price,
+                              double const quantity) {
+  // updates cluster around the top of book, so the binary search is short
+  // and the insert/erase moves only a few levels
+  auto iter = std::lower_bound(
+      levels.begin(), levels.end(), price,
+      [descending](price_level_t const &level, double const p) {
+        return descending ? level.price > p : level.price < p;
+      });
+  bool const exists = iter != levels.end() && iter->price == price;
+  if (quantity <= 0.0) {
+    if (exists)
+      levels.erase(iter);
+  } else if (exists) {
+    iter->quantity = quantity;
+  } else {
+    levels.insert(iter, price_level_t{price, quantity});
+  }
+}
+
+void order_book_t::invalidate() {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  if (m_synced)
+    ++m_resyncCount;
+  m_synced = false;
+  m_bids.clear();
+  m_asks.clear();
+  m_sequence = 0;
+}
+
+bool order_book_t::isSynced() const {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  return m_synced;
+}
+
+std::int64_t order_book_t::sequence() const {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  return m_sequence;
+}
+
+std::uint64_t order_book_t::resyncCount() const {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  return m_resyncCount;
+}
+
+double order_book_t::bestBid() const {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  return (m_synced && !m_bids.empty()) ? m_bids.front().price : 0.0;
+}
+
+double order_book_t::bestAsk() const {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  return (m_synced && !m_asks.empty()) ? m_asks.front().price : 0.0;
+}
+
+double order_book_t::mid() const {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  if (!m_synced || m_bids.empty() || m_asks.empty())
+    return 0.0;
+  return (m_bids.front().price + m_asks.front().price) / 2.0;
+}
+
+double order_book_t::vwap(book_side_e const side,
+                          double const quantity) const {
+  if (quantity <= 0.0)
+    return 0.0;
+
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  if (!m_synced)
+    return 0.0;
+
+  auto const &levels = side == book_side_e::bid ? m_bids : m_asks;
+  double remaining = quantity;
+  double notional = 0.0;
+  for (auto const &level : levels) {
+    auto const taken = std::min(remaining, level.quantity);
+    notional += taken * level.price;
+    remaining -= taken;
+    if (remaining <= 0.0)
+      return notional / quantity;
+  }
+  return 0.0;
+}
+
+std::vector<price_level_t>
+order_book_t::topLevels(book_side_e const side, std::size_t const count) const {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  auto const &levels = side == book_side_e::bid ? m_bids : m_asks;
+  auto const size = m_synced ? std::min(count, levels.size()) : 0;
+  return std::vector<price_level_t>(levels.begin(), levels.begin() + size);
+}
+
+} // namespace korrelator
@@ -0,0 +1,85 @@
+#include "tls_session_cache.hpp"
+
+#include <openssl/ssl.h>
+
+namespace korrelator {
+
+// the SNI name, binance connections append the port to it
+static std::string sessionKey(SSL *ssl) {
+  auto const name = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+  return name ? std::string(name) : std::string();
+}
+
+tls_session_cache_t &tls_session_cache_t::instance() {
+  static tls_session_cache_t cache;
+  return cache;
+}
+
+void tls_session_cache_t::enable(SSL_CTX *context) {
+  // sessions live in `m_sessions` only, OpenSSL's own cache is server-side
+  SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT |
+                                              SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(context, &tls_session_cache_t::onNewSession);
+}
+
+void tls_session_cache_t::setPeerVerification(bool const verify) {
+  if (m_verifyPeer.exchange(verify) == verify)
+    return;
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  m_sessions.clear();
+}
+
+tls_session_cache_t::time_point_t
+tls_session_cache_t::beforeHandshake(SSL *ssl) {
+  auto const key = sessionKey(ssl);
+  if (m_verifyPeer.load(std::memory_order_relaxed)) {
+    auto const host = key.substr(0, key.find(':'));
+    SSL_set_verify(ssl, SSL_VERIFY_PEER, nullptr);
+    SSL_set1_host(ssl, host.c_str());
+  }
+
+  if (!key.empty()) {
+    std::lock_guard<std::mutex> lock_g(m_mutex);
+    if (auto iter = m_sessions.find(key);
+        iter != m_sessions.end() && SSL_SESSION_is_resumable(iter->second.get()))
+      SSL_set_session(ssl, iter->second.get());
+  }
+  return std::chrono::steady_clock::now();
+}
+
+void tls_session_cache_t::afterHandshake(SSL *ssl,
+                                         time_point_t const started) {
+  auto const elapsedUs = static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - started)
+          .count());
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  if (SSL_session_reused(ssl))
+    m_resumedHandshakes.record(elapsedUs);
+  else
+    m_fullHandshakes.record(elapsedUs);
+}
+
+tls_handshake_report_t tls_session_cache_t::report() const {
+  tls_handshake_report_t result;
+  result.fullUs = m_fullHandshakes.summary();
+  result.resumedUs = m_resumedHandshakes.summary();
+  result.full = result.fullUs.count;
+  result.resumed = result.resumedUs.count;
+  return result;
+}
+
+// also called for TLS 1.3 tickets, which arrive after the handshake
+int tls_session_cache_t::onNewSession(SSL *ssl, SSL_SESSION *session) {
+  auto key = sessionKey(ssl);
+  if (key.empty())
+    return 0;
+  auto &cache = instance();
+  std::lock_guard<std::mutex> lock_g(cache.m_mutex);
+  // returning 1 hands our reference over to the shared_ptr
+  cache.m_sessions[std::move(key)] =
+      std::shared_ptr<SSL_SESSION>(session, &SSL_SESSION_free);
+  return 1;
+}
+
+} // namespace korrelator
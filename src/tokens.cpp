@@ -0,0 +1,28 @@
+#include "tokens.hpp"
+
+namespace korrelator {
+
+void token_t::reset() {
+  crossedOver = false;
+  calculatingNewMinMax = true;
+  pricePrecision = quantityPrecision = baseAssetPrecision = quotePrecision = -1;
+  minPrice = prevNormalizedPrice = std::numeric_limits<double>::max();
+  maxPrice = -(std::numeric_limits<double>::max());
+  alpha = 1.0;
+  baseMinSize = 0.0;
+  quoteMinSize = 0.0;
+  normalizedPrice = 0.0;
+  multiplier = 1.0;
+  tickSize = 0.0;
+  graphPointsDrawnCount = 0;
+  graph = nullptr;
+  baseCurrency = quoteCurrency = legendName = "";
+  crossOver.reset();
+
+  if (realPrice)
+    realPrice->clear();
+  if (orderBook)
+    orderBook->invalidate();
+}
+
+} // namespace korrelator
@@ -14,6 +14,8 @@ std::string uri::path() const { return m_path; }
 
 std::string uri::host() const { return m_host; }
 
+std::string uri::port() const { return m_port; }
+
 void uri::parse(std::string const &url_s) {
   std::string const prot_end{"://"};
   std::string::const_iterator prot_i =
@@ -32,6 +34,10 @@ void uri::parse(std::string const &url_s) {
   m_host.reserve(static_cast<std::size_t>(std::distance(prot_i, path_i)));
   std::transform(prot_i, path_i, std::back_inserter(m_host),
                  [](int c) { return std::tolower(c); });
+  if (auto const colon = m_host.find(':'); colon != std::string::npos) {
+    m_port = m_host.substr(colon + 1);
+    m_host.resize(colon);
+  }
   std::string::const_iterator query_i = std::find(path_i, url_s.end(), '?');
   m_path.assign(path_i, query_i);
   if (query_i != url_s.end())
@@ -0,0 +1,54 @@
+#include "utils.hpp"
+
+namespace korrelator {
+
+QString exchangeNameToString(exchange_name_e const ex) {
+  if (ex == exchange_name_e::binance)
+    return "Binance";
+  else if (ex == exchange_name_e::kucoin)
+    return "KuCoin";
+  return QString();
+}
+
+exchange_name_e stringToExchangeName(QString const &name) {
+  auto const name_ = name.trimmed();
+  if (name_.compare("binance", Qt::CaseInsensitive) == 0)
+    return exchange_name_e::binance;
+  else if (name_.compare("kucoin", Qt::CaseInsensitive) == 0)
+    return exchange_name_e::kucoin;
+  return exchange_name_e::none;
+}
+
+QString marketTypeToString(market_type_e const m) {
+  if (m == market_type_e::market)
+    return "market";
+  else if (m == market_type_e::limit)
+    return "limit";
+  return "unknown";
+}
+
+market_type_e stringToMarketType(QString const &m) {
+  if (m.compare("market") == 0)
+    return market_type_e::market;
+  else if (m.compare("limit") == 0)
+    return market_type_e::limit;
+  return market_type_e::unknown;
+}
+
+price_source_e stringToPriceSource(QString const &name) {
+  if (name.compare("bookTickerMid", Qt::CaseInsensitive) == 0)
+    return price_source_e::book_ticker_mid;
+  else if (name.compare("microPrice", Qt::CaseInsensitive) == 0)
+    return price_source_e::micro_price;
+  return price_source_e::last_trade;
+}
+
+QString priceSourceToString(price_source_e const p) {
+  if (p == price_source_e::book_ticker_mid)
+    return "bookTickerMid";
+  else if (p == price_source_e::micro_price)
+    return "microPrice";
+  return "lastTrade";
+}
+
+} // namespace korrelator
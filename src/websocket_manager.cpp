@@ -1,85 +1,486 @@
 #include "websocket_manager.hpp"
 
 #include "binance_websocket.hpp"
+#include "feed_arbiter.hpp"
+#include "feed_watchdog.hpp"
+#include "frame_journal.hpp"
+#include "io_context_pool.hpp"
 #include "kucoin_websocket.hpp"
+#include "tls_session_cache.hpp"
 
-#include <thread>
+#include <QDebug>
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <condition_variable>
+#include <utility>
 
 namespace korrelator {
 
+static constexpr auto watchdogCheckInterval = std::chrono::seconds(1);
+static constexpr auto closeTimeout = std::chrono::milliseconds(500);
+
+struct websocket_manager::watchdog_runner_t {
+  explicit watchdog_runner_t(net::io_context &ioContext) : timer(ioContext) {}
+  net::steady_timer timer;
+};
+
 net::ssl::context &getSSLContext() {
   static std::unique_ptr<net::ssl::context> ssl_context = nullptr;
   if (!ssl_context) {
     ssl_context =
         std::make_unique<net::ssl::context>(net::ssl::context::tlsv12_client);
     ssl_context->set_default_verify_paths();
+    // verification is per connection, see `setPeerVerification`
     ssl_context->set_verify_mode(boost::asio::ssl::verify_none);
+    tls_session_cache_t::instance().enable(ssl_context->native_handle());
   }
   return *ssl_context;
 }
 
-websocket_manager::websocket_manager() : m_sslContext(getSSLContext()),
-  m_ioContext(new net::io_context(std::thread::hardware_concurrency()))
-{
-}
+websocket_manager::websocket_manager(std::size_t const ioThreadCount,
+                                     std::vector<int> cpuAffinity,
+                                     bool const dualFeed)
+    : m_sslContext(getSSLContext()),
+      m_ioContextPool(std::make_unique<io_context_pool_t>(
+          ioThreadCount, std::move(cpuAffinity))),
+      m_dualFeed(dualFeed) {}
 
-websocket_manager::~websocket_manager() {
-  m_ioContext->stop();
+// the connections still closing, see `stop`
+struct close_latch_t {
+  std::mutex mutex;
+  std::condition_variable allClosed;
+  std::size_t pending = 0;
 
-  for (auto &sock : m_sockets) {
-    std::visit([](auto &&v) { v->requestStop(); }, sock);
+  void countDown() {
+    std::lock_guard<std::mutex> lock_g(mutex);
+    if (--pending == 0)
+      allClosed.notify_all();
   }
+};
 
-  std::this_thread::sleep_for(std::chrono::seconds(2));
+websocket_manager::~websocket_manager() { stop(); }
+
+void websocket_manager::stop() {
+  auto const started = std::chrono::steady_clock::now();
+  std::vector<socket_variant> sockets;
+  bool wasWatching = false;
+  {
+    std::lock_guard<std::mutex> lock_g(m_mutex);
+    if (!m_ioContextPool)
+      return;
+    // no runtime subscription from here on
+    wasWatching = std::exchange(m_isWatching, false);
+    sockets = m_sockets;
+  }
+
+  // the io threads run the closes, so they are only joined afterwards
+  if (wasWatching && !sockets.empty()) {
+    auto latch = std::make_shared<close_latch_t>();
+    latch->pending = sockets.size();
+    for (auto const &sock : sockets) {
+      std::visit(
+          [&latch](auto *v) { v->close([latch] { latch->countDown(); }); },
+          sock);
+    }
+    std::unique_lock<std::mutex> lock(latch->mutex);
+    if (!latch->allClosed.wait_for(lock, closeTimeout,
+                                   [&latch] { return latch->pending == 0; }))
+      qDebug() << latch->pending << "connection(s) didn't close in time";
+  }
+
+  // once the threads are joined no handler can touch the sockets anymore.
+  // Operations still pending (a close that missed the timeout, a reconnect)
+  // are only destroyed with the pool, after the sockets; they own the
+  // handler memory they give back, see `handler_memory_t`.
+  m_ioContextPool->stop();
   for (auto &sock : m_sockets) {
     std::visit([](auto &&v) { delete v; }, sock);
   }
 
   m_sockets.clear();
-  m_ioContext.reset();
+  // they point into the deleted sockets
+  m_priceSubscriptions.clear();
+  m_watchdogRunner.reset();
+  m_ioContextPool.reset();
+  // the sockets are gone, so nothing appends while the journals are closed
+  m_frameCapture.reset();
+
+  for (auto const &stats : feedStatistics()) {
+    qDebug() << stats.name << "wins(primary/standby):" << stats.wins[0] << "/"
+             << stats.wins[1] << "duplicates:" << stats.duplicates[0] << "/"
+             << stats.duplicates[1];
+  }
+  m_feedPairs.clear();
+  qDebug() << "Feeds stopped in"
+           << std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - started)
+                  .count()
+           << "ms";
+}
+
+std::vector<feed_statistics_t> websocket_manager::feedStatistics() const {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  std::vector<feed_statistics_t> result;
+  result.reserve(m_feedPairs.size());
+  for (auto const &pair : m_feedPairs) {
+    feed_statistics_t stats;
+    stats.name = QString::fromStdString(pair.arbiter->name());
+    for (int i = 0; i < feed_arbiter_t::feedCount; ++i) {
+      stats.wins[i] = pair.arbiter->wins(i);
+      stats.duplicates[i] = pair.arbiter->duplicates(i);
+    }
+    result.push_back(std::move(stats));
+  }
+  return result;
+}
+
+std::vector<QString> websocket_manager::connectionNames() const {
+  std::vector<QString> result;
+  result.reserve(m_sockets.size());
+  int binanceCount[2] = {0, 0}, kucoinCount[2] = {0, 0};
+  auto makeName = [&result](auto const *sock, char const *exchangeName,
+                            int(&counts)[2]) {
+    auto const isSpot = sock->tradeType() == trade_type_e::spot;
+    if (sock->feedIndex() == 0)
+      ++counts[isSpot ? 0 : 1];
+    auto name = QString("%1 %2 #%3")
+                    .arg(exchangeName, isSpot ? "spot" : "futures")
+                    .arg(counts[isSpot ? 0 : 1]);
+    if (sock->feedIndex() != 0)
+      name += " (standby)";
+    result.push_back(std::move(name));
+  };
+
+  for (auto const &sock : m_sockets) {
+    if (auto binanceSock = std::get_if<binance_ws *>(&sock))
+      makeName(*binanceSock, "Binance", binanceCount);
+    else if (auto kucoinSock = std::get_if<kucoin_ws *>(&sock))
+      makeName(*kucoinSock, "KuCoin", kucoinCount);
+  }
+  return result;
+}
+
+// a journal for every connection from `firstSocket` on, before it starts
+void websocket_manager::addJournals(std::size_t const firstSocket) {
+  if (!m_frameCapture)
+    return;
+  auto const names = connectionNames();
+  for (auto i = firstSocket; i < m_sockets.size(); ++i) {
+    auto journal = m_frameCapture->addJournal(names[i].toStdString());
+    std::visit([journal](auto *sock) { sock->setJournal(journal); },
+               m_sockets[i]);
+  }
+}
+
+std::vector<feed_latency_report_t> websocket_manager::latencyReports() const {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  auto const names = connectionNames();
+  std::vector<feed_latency_report_t> result;
+  result.reserve(m_sockets.size());
+  for (std::size_t i = 0; i < m_sockets.size(); ++i) {
+    feed_latency_report_t report;
+    report.name = names[i];
+    std::visit(
+        [&report](auto const *sock) {
+          auto const &latency = sock->latency();
+          report.latency = latency.latency().summary();
+          report.gaps = latency.gaps().summary();
+          report.aheadOfLocalClock = latency.aheadOfLocalClock();
+          report.conflatedFrames = sock->conflatedFrames();
+        },
+        m_sockets[i]);
+    result.push_back(std::move(report));
+  }
+  return result;
+}
+
+template <typename Socket>
+Socket *websocket_manager::addSocket(trade_type_e const tradeType,
+                                     net::ssl::context &sslContext,
+                                     char const *exchangeName) {
+  auto &ioContext = m_ioContextPool->nextIOContext();
+  if (!m_dualFeed) {
+    auto sock = new Socket(ioContext, sslContext, tradeType);
+    sock->setConflation(m_conflateFrames);
+    m_sockets.push_back(sock);
+    return sock;
+  }
+
+  // both feeds share an io_context, so the arbiter needs no locking
+  feed_pair_t pair;
+  pair.arbiter = std::make_unique<feed_arbiter_t>(
+      std::string(exchangeName) +
+      (tradeType == trade_type_e::spot ? " spot #" : " futures #") +
+      std::to_string(m_feedPairs.size() + 1));
+  auto primary = new Socket(ioContext, sslContext, tradeType,
+                            pair.arbiter.get(), 0);
+  auto standby = new Socket(ioContext, sslContext, tradeType,
+                            pair.arbiter.get(), 1);
+  primary->setConflation(m_conflateFrames);
+  standby->setConflation(m_conflateFrames);
+  pair.primary = primary;
+  pair.standby = standby;
+  m_sockets.push_back(primary);
+  m_sockets.push_back(standby);
+  m_feedPairs.push_back(std::move(pair));
+  return primary;
+}
+
+template <typename Socket>
+Socket *websocket_manager::standbyOf(Socket *primary) const {
+  for (auto const &pair : m_feedPairs) {
+    if (auto sock = std::get_if<Socket *>(&pair.primary);
+        sock && *sock == primary)
+      return std::get<Socket *>(pair.standby);
+  }
+  return nullptr;
 }
 
 void websocket_manager::addSubscription(QString const &tokenName,
                                         trade_type_e const tradeType,
                                         exchange_name_e const exchange,
-                                        double &result) {
+                                        tick_slot_t &result,
+                                        price_source_e const priceSource) {
+  auto subscription = makeSubscription(tokenName, tradeType, exchange, result,
+                                       priceSource, false);
+  if (!subscription.sockets.empty())
+    m_priceSubscriptions.push_back(std::move(subscription));
+}
+
+// with `m_mutex` held once running. A running connection takes the symbol
+// on its strand, one created just now gets it before it starts.
+websocket_manager::price_subscription_t websocket_manager::makeSubscription(
+    QString const &tokenName, trade_type_e const tradeType,
+    exchange_name_e const exchange, tick_slot_t &result,
+    price_source_e const priceSource, bool const isRunning) {
+  auto const socketCount = m_sockets.size();
+  auto const isLive = [isRunning, socketCount, this](auto *sock) {
+    return isRunning && std::find(m_sockets.begin(),
+                                  m_sockets.begin() + socketCount,
+                                  socket_variant(sock)) !=
+                            m_sockets.begin() + socketCount;
+  };
+
+  price_subscription_t subscription;
+  subscription.slot = &result;
+  subscription.connectionName =
+      QString("%1 %2")
+          .arg(exchange == exchange_name_e::binance ? "Binance" : "KuCoin",
+               tradeType == trade_type_e::spot ? "spot" : "futures");
   if (exchange == exchange_name_e::binance) {
-    auto sock = new binance_ws(*m_ioContext, m_sslContext, result, tradeType);
-    sock->addSubscription(tokenName.toLower());
-    m_sockets.push_back(std::move(sock));
+    subscription.tokenName = tokenName.toLower();
+    auto const add = [&](binance_ws *sock) {
+      if (isLive(sock))
+        sock->subscribe(subscription.tokenName, result, priceSource);
+      else
+        sock->addSubscription(subscription.tokenName, result, priceSource);
+      subscription.sockets.push_back(sock);
+    };
+    auto sock = getBinanceSocket(tradeType);
+    add(sock);
+    if (auto standby = standbyOf(sock))
+      add(standby);
   } else if (exchange == exchange_name_e::kucoin) {
+    // futures tickers are already a mid price, spot ones the last trade
+    subscription.tokenName = tokenName.toUpper();
+    auto const add = [&](kucoin_ws *sock) {
+      if (isLive(sock))
+        sock->subscribe(subscription.tokenName, result);
+      else
+        sock->addSubscription(subscription.tokenName, result);
+      subscription.sockets.push_back(sock);
+    };
+    auto sock = getKuCoinSocket(tradeType);
+    add(sock);
+    if (auto standby = standbyOf(sock))
+      add(standby);
+  }
+
+  // the io threads run already, but nothing of these sockets is queued yet
+  if (isRunning) {
+    addJournals(socketCount);
+    for (auto i = socketCount; i < m_sockets.size(); ++i)
+      std::visit([](auto *sock) { sock->startFetching(); }, m_sockets[i]);
+  }
+  return subscription;
+}
+
+void websocket_manager::subscribe(QString const &tokenName,
+                                  trade_type_e const tradeType,
+                                  exchange_name_e const exchange,
+                                  tick_slot_t &result,
+                                  price_source_e const priceSource) {
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  if (!m_isWatching)
+    return;
+  auto subscription = makeSubscription(tokenName, tradeType, exchange, result,
+                                       priceSource, true);
+  if (subscription.sockets.empty())
+    return;
+  m_priceSubscriptions.push_back(std::move(subscription));
+  if (m_watchdogRunner)
+    watchSubscription(m_priceSubscriptions.size() - 1);
+}
+
+void websocket_manager::unsubscribe(QString const &tokenName,
+                                    trade_type_e const tradeType,
+                                    exchange_name_e const exchange,
+                                    tick_slot_t &result) {
+  auto const name = exchange == exchange_name_e::binance ? tokenName.toLower()
+                                                         : tokenName.toUpper();
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  if (!m_isWatching)
+    return;
+  for (std::size_t i = 0; i < m_priceSubscriptions.size(); ++i) {
+    auto &subscription = m_priceSubscriptions[i];
+    if (subscription.sockets.empty() || subscription.slot != &result ||
+        subscription.tokenName != name)
+      continue;
+    auto const matches = std::visit(
+        [tradeType](auto const *sock) { return sock->tradeType() == tradeType; },
+        subscription.sockets.front());
+    bool const isBinance =
+        std::holds_alternative<binance_ws *>(subscription.sockets.front());
+    if (!matches || isBinance != (exchange == exchange_name_e::binance))
+      continue;
+
+    for (auto const &sock : subscription.sockets)
+      std::visit([&name, &result](auto *v) { v->unsubscribe(name, result); },
+                 sock);
+    // the index stays, the watchdog knows the symbol by it
+    subscription.sockets.clear();
+    if (m_watchdogRunner)
+      m_feedWatchdog->removeSymbol(i);
+    return;
+  }
+}
+
+void websocket_manager::addOrderBook(QString const &tokenName,
+                                     trade_type_e const tradeType,
+                                     exchange_name_e const exchange,
+                                     order_book_t &book) {
+  // depth streams are sequenced per connection, only the primary keeps them
+  if (exchange == exchange_name_e::binance) {
+    getBinanceSocket(tradeType)->addOrderBook(tokenName.toLower(), book);
+  } else if (exchange == exchange_name_e::kucoin) {
+    getKuCoinSocket(tradeType)->addOrderBook(tokenName.toUpper(), book);
+  }
+}
+
+binance_ws *websocket_manager::getBinanceSocket(trade_type_e const tradeType) {
+  // all symbols of a market share one combined-stream connection
+  for (auto &sock : m_sockets) {
+    if (auto binanceSock = std::get_if<binance_ws *>(&sock);
+        binanceSock && (*binanceSock)->tradeType() == tradeType &&
+        (*binanceSock)->feedIndex() == 0)
+      return *binanceSock;
+  }
+  return addSocket<binance_ws>(tradeType, m_sslContext, "Binance");
+}
+
+kucoin_ws *websocket_manager::getKuCoinSocket(trade_type_e const tradeType) {
+  // topics share a connection until it reaches KuCoin's per-connection limit
+  for (auto iter = m_sockets.rbegin(); iter != m_sockets.rend(); ++iter) {
+    if (auto kucoinSock = std::get_if<kucoin_ws *>(&(*iter));
+        kucoinSock && (*kucoinSock)->tradeType() == tradeType &&
+        (*kucoinSock)->feedIndex() == 0 &&
+        (*kucoinSock)->canAddSubscription())
+      return *kucoinSock;
+  }
 #ifdef TESTNET
-    static std::unique_ptr<net::ssl::context> sslContext = nullptr;
-    if (!sslContext) {
-      sslContext =
-          std::make_unique<net::ssl::context>(net::ssl::context::sslv23_client);
-      sslContext->set_default_verify_paths();
-      sslContext->set_verify_mode(boost::asio::ssl::verify_none);
-    }
+  static std::unique_ptr<net::ssl::context> sslContext = nullptr;
+  if (!sslContext) {
+    sslContext =
+        std::make_unique<net::ssl::context>(net::ssl::context::sslv23_client);
+    sslContext->set_default_verify_paths();
+    sslContext->set_verify_mode(boost::asio::ssl::verify_none);
+    tls_session_cache_t::instance().enable(sslContext->native_handle());
+  }
 #endif
-    auto sock = new kucoin_ws(*m_ioContext,
+  return addSocket<kucoin_ws>(tradeType,
 #ifndef TESTNET
                               m_sslContext,
 #else
                               *sslContext,
 #endif
-                              result, tradeType);
-    sock->addSubscription(tokenName.toUpper());
-    m_sockets.push_back(std::move(sock));
-  }
+                              "KuCoin");
 }
 
-void websocket_manager::startWatch() {
-  for (auto &sock : m_sockets) {
+void websocket_manager::enableFrameCapture(std::filesystem::path rootDirectory,
+                                           std::size_t const segmentSize) {
+  m_frameCaptureConfig.emplace(std::move(rootDirectory), segmentSize);
+}
+
+void websocket_manager::setFeedWatchdog(
+    std::shared_ptr<feed_watchdog_t> watchdog) {
+  m_feedWatchdog = std::move(watchdog);
+}
+
+void websocket_manager::scheduleWatchdogCheck() {
+  m_watchdogRunner->timer.expires_after(watchdogCheckInterval);
+  m_watchdogRunner->timer.async_wait([this](boost::system::error_code const ec) {
+    if (ec)
+      return;
+    std::lock_guard<std::mutex> lock_g(m_mutex);
+    m_feedWatchdog->check(
+        steadyNowNs(), [this](std::size_t const index,
+                              feed_watchdog_t::action_e const action) {
+          onSilentFeed(index, action == feed_watchdog_t::action_e::reconnect);
+        });
+    scheduleWatchdogCheck();
+  });
+}
+
+// with `m_mutex` held
+void websocket_manager::watchSubscription(std::size_t const subscriptionIndex) {
+  auto const &subscription = m_priceSubscriptions[subscriptionIndex];
+  m_feedWatchdog->addSymbol(
+      (subscription.connectionName + " " + subscription.tokenName)
+          .toStdString(),
+      *subscription.slot);
+}
+
+// runs on the watchdog's io thread, the sockets pick the request up on theirs
+void websocket_manager::onSilentFeed(std::size_t const subscriptionIndex,
+                                     bool const reconnect) {
+  auto const &subscription = m_priceSubscriptions[subscriptionIndex];
+  for (auto const &sock : subscription.sockets) {
     std::visit(
-        [this](auto &&v) mutable {
-          std::thread([this, &v]() mutable {
-            v->startFetching();
-            m_ioContext->run();
-          }).detach();
+        [&subscription, reconnect](auto *v) {
+          if (reconnect)
+            v->forceReconnect();
+          else
+            v->resubscribe(subscription.tokenName);
         },
         sock);
   }
 }
 
+void websocket_manager::startWatch() {
+  if (m_frameCaptureConfig && !m_frameCapture) {
+    m_frameCapture = std::make_unique<frame_capture_t>(
+        m_frameCaptureConfig->first, m_frameCaptureConfig->second);
+    addJournals(0);
+    m_frameCapture->start();
+  }
+
+  if (m_feedWatchdog && !m_watchdogRunner && !m_priceSubscriptions.empty()) {
+    // indices match `m_priceSubscriptions`, see `onSilentFeed`
+    for (std::size_t i = 0; i < m_priceSubscriptions.size(); ++i)
+      watchSubscription(i);
+    m_watchdogRunner = std::make_unique<watchdog_runner_t>(
+        m_ioContextPool->nextIOContext());
+    scheduleWatchdogCheck();
+  }
+
+  // the io threads aren't running yet, so this can't race their handlers
+  for (auto &sock : m_sockets) {
+    std::visit([](auto &&v) { v->startFetching(); }, sock);
+  }
+  m_ioContextPool->run();
+  std::lock_guard<std::mutex> lock_g(m_mutex);
+  m_isWatching = true;
+}
+
 } // namespace korrelator